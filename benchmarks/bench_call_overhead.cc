@@ -0,0 +1,379 @@
+// Per-call latency of put, get and create on small tensors through the three
+// ways into libvovp: the C++ API (VovpPlasmaManager), the C API and the
+// Python binding. The binding is loaded from the build tree into an embedded
+// interpreter and called from C++, so its rows add exactly the argument
+// conversion, GIL hand-off and capsule wrapping a Python caller pays on top
+// of the native call, without the cost of the Python code around it. Starts
+// its own plasma-store-server unless --socket is given.
+//
+//   bench_call_overhead [--store PATH] [--socket PATH] [--module-dir DIR]
+//                       [--sizes 64,4096] [--iters N]
+//
+// Each sample times one call and dropping its result.
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <pybind11/embed.h>
+#include <pybind11/stl.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <vovp/c_api.h>
+#include <vovp/ndarray_utils.h>
+#include <vovp/plasma_manager.h>
+
+#ifndef VOVP_PLASMA_STORE_SERVER
+#define VOVP_PLASMA_STORE_SERVER "plasma-store-server"
+#endif
+#ifndef VOVP_MODULE_DIR
+#define VOVP_MODULE_DIR "."
+#endif
+
+namespace py = pybind11;
+using namespace vovp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+  std::string store = VOVP_PLASMA_STORE_SERVER;
+  std::string socket;
+  std::string module_dir = VOVP_MODULE_DIR;
+  int64_t memory = 1LL << 30;
+  std::vector<int64_t> sizes = {64, 4096, 1 << 16};
+  int64_t iters = 20000;
+};
+
+double ElapsedNs(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+      .count();
+}
+
+class Caller {
+public:
+  virtual ~Caller() = default;
+  virtual double TimedPut(DLManagedTensor *source) = 0;
+  // Leaves the object in the store, so every get reads the one put before
+  virtual double TimedGet() = 0;
+  virtual double TimedCreate(DLManagedTensor *source) = 0;
+};
+
+class CppCaller : public Caller {
+public:
+  CppCaller(const std::string &socket, const std::string &name)
+      : manager(socket, 1), object_id(ToObjectID(name)) {}
+
+  ~CppCaller() override {
+    manager.Flush();
+    manager.Delete(object_id);
+  }
+
+  double TimedPut(DLManagedTensor *source) override {
+    auto start = Clock::now();
+    auto view = manager.PutDlpackTensor(source, object_id, false, true);
+    view->deleter(view);
+    double ns = ElapsedNs(start);
+    manager.Flush();
+    return ns;
+  }
+
+  double TimedGet() override {
+    auto start = Clock::now();
+    auto view = manager.GetDlpackTensor(object_id, 1000, false);
+    view->deleter(view);
+    double ns = ElapsedNs(start);
+    manager.Flush();
+    return ns;
+  }
+
+  double TimedCreate(DLManagedTensor *source) override {
+    auto &dl_tensor = source->dl_tensor;
+    auto start = Clock::now();
+    auto view = manager.CreateTensor(object_id, dl_tensor.shape,
+                                     dl_tensor.ndim, dl_tensor.dtype,
+                                     dl_tensor.ctx);
+    view->deleter(view);
+    double ns = ElapsedNs(start);
+    manager.Flush();
+    manager.Delete(object_id);
+    return ns;
+  }
+
+private:
+  VovpPlasmaManager manager;
+  ObjectID object_id;
+};
+
+class CCaller : public Caller {
+public:
+  CCaller(const std::string &socket, const std::string &name) {
+    CHECK_EQ(vovp_client_create(socket.c_str(), 1, &client), VOVP_OK)
+        << vovp_last_error();
+    CHECK_EQ(vovp_object_id_from_name(name.data(), name.size(), &object_id),
+             VOVP_OK);
+  }
+
+  ~CCaller() override {
+    vovp_flush(client);
+    vovp_delete(client, &object_id);
+    vovp_client_destroy(client);
+  }
+
+  double TimedPut(DLManagedTensor *source) override {
+    DLManagedTensor *view;
+    auto start = Clock::now();
+    CHECK_EQ(vovp_put(client, &object_id, source, &view), VOVP_OK)
+        << vovp_last_error();
+    view->deleter(view);
+    double ns = ElapsedNs(start);
+    vovp_flush(client);
+    return ns;
+  }
+
+  double TimedGet() override {
+    DLManagedTensor *view;
+    auto start = Clock::now();
+    CHECK_EQ(vovp_get_ex(client, &object_id, 1000, 0, &view), VOVP_OK)
+        << vovp_last_error();
+    view->deleter(view);
+    double ns = ElapsedNs(start);
+    vovp_flush(client);
+    return ns;
+  }
+
+  double TimedCreate(DLManagedTensor *source) override {
+    auto &dl_tensor = source->dl_tensor;
+    DLManagedTensor *view;
+    auto start = Clock::now();
+    CHECK_EQ(vovp_create(client, &object_id, dl_tensor.shape, dl_tensor.ndim,
+                         dl_tensor.dtype, dl_tensor.ctx, 1, &view),
+             VOVP_OK)
+        << vovp_last_error();
+    view->deleter(view);
+    double ns = ElapsedNs(start);
+    vovp_flush(client);
+    vovp_delete(client, &object_id);
+    return ns;
+  }
+
+private:
+  vovp_client_t *client = nullptr;
+  vovp_object_id_t object_id;
+};
+
+// The capsule a framework's to_dlpack would hand to put_tensor: the binding
+// calls its deleter once the data is copied
+py::capsule BorrowedCapsule(DLManagedTensor *source) {
+  auto *borrowed = new DLManagedTensor(*source);
+  borrowed->manager_ctx = nullptr;
+  borrowed->deleter = [](DLManagedTensor *self) { delete self; };
+  return py::capsule(borrowed, "dltensor");
+}
+
+class PythonCaller : public Caller {
+public:
+  PythonCaller(const std::string &socket, const std::string &name)
+      : object_id(py::bytes(name)) {
+    auto module = py::module::import("_vovp");
+    client = module.attr("VovpPlasmaClient")(socket, 1);
+    put_tensor = client.attr("put_tensor");
+    get_tensor = client.attr("get_tensor");
+    create_tensor = client.attr("create_tensor");
+    flush = client.attr("flush");
+  }
+
+  ~PythonCaller() override {
+    flush();
+    client.attr("delete")(object_id);
+  }
+
+  double TimedPut(DLManagedTensor *source) override {
+    py::capsule capsule = BorrowedCapsule(source);
+    auto start = Clock::now();
+    put_tensor(capsule, object_id, false, true);
+    double ns = ElapsedNs(start);
+    flush();
+    return ns;
+  }
+
+  double TimedGet() override {
+    auto start = Clock::now();
+    get_tensor(object_id, 1000, false);
+    double ns = ElapsedNs(start);
+    flush();
+    return ns;
+  }
+
+  double TimedCreate(DLManagedTensor *source) override {
+    auto &dl_tensor = source->dl_tensor;
+    std::vector<int64_t> shape(dl_tensor.shape,
+                               dl_tensor.shape + dl_tensor.ndim);
+    auto start = Clock::now();
+    create_tensor(object_id, shape, dl_tensor.dtype.code,
+                  dl_tensor.dtype.bits, "cpu", 0, true);
+    double ns = ElapsedNs(start);
+    flush();
+    client.attr("delete")(object_id);
+    return ns;
+  }
+
+private:
+  py::bytes object_id;
+  py::object client;
+  py::object put_tensor;
+  py::object get_tensor;
+  py::object create_tensor;
+  py::object flush;
+};
+
+double Percentile(const std::vector<double> &sorted, double q) {
+  size_t index = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// Median latency of `iters` calls of `op`, after a warm-up of a tenth of them
+double MedianNs(Caller *caller, const std::string &op, DLManagedTensor *source,
+                int64_t iters) {
+  if (op == "get") {
+    caller->TimedPut(source);
+  }
+  std::vector<double> samples;
+  for (int64_t i = 0; i < iters + iters / 10; i++) {
+    double ns = op == "put"   ? caller->TimedPut(source)
+                : op == "get" ? caller->TimedGet()
+                              : caller->TimedCreate(source);
+    if (i >= iters / 10) {
+      samples.push_back(ns);
+    }
+  }
+  std::sort(samples.begin(), samples.end());
+  return Percentile(samples, 0.5);
+}
+
+pid_t StartStore(const Options &opts) {
+  unlink(opts.socket.c_str());
+  pid_t pid = fork();
+  CHECK_GE(pid, 0) << "fork failed";
+  if (pid == 0) {
+    std::string memory = std::to_string(opts.memory);
+    execlp(opts.store.c_str(), opts.store.c_str(), "-m", memory.c_str(), "-s",
+           opts.socket.c_str(), static_cast<char *>(nullptr));
+    std::fprintf(stderr, "Failed to start %s: %s\n", opts.store.c_str(),
+                 std::strerror(errno));
+    _exit(127);
+  }
+  struct stat st;
+  for (int i = 0; i < 100 && stat(opts.socket.c_str(), &st) != 0; i++) {
+    int status;
+    CHECK_EQ(waitpid(pid, &status, WNOHANG), 0)
+        << opts.store << " exited during startup";
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  CHECK_EQ(stat(opts.socket.c_str(), &st), 0)
+      << "Plasma store did not create " << opts.socket;
+  return pid;
+}
+
+std::vector<int64_t> SplitSizes(const std::string &value) {
+  std::vector<int64_t> sizes;
+  size_t start = 0;
+  while (start < value.size()) {
+    size_t end = value.find(',', start);
+    if (end == std::string::npos) {
+      end = value.size();
+    }
+    if (end > start) {
+      sizes.push_back(std::atoll(value.substr(start, end - start).c_str()));
+    }
+    start = end + 1;
+  }
+  return sizes;
+}
+
+Options ParseOptions(int argc, char **argv) {
+  Options opts;
+  for (int i = 1; i < argc; i++) {
+    std::string flag = argv[i];
+    CHECK_LT(i + 1, argc) << "Missing value for " << flag;
+    std::string value = argv[++i];
+    if (flag == "--store") {
+      opts.store = value;
+    } else if (flag == "--socket") {
+      opts.socket = value;
+    } else if (flag == "--module-dir") {
+      opts.module_dir = value;
+    } else if (flag == "--sizes") {
+      opts.sizes = SplitSizes(value);
+    } else if (flag == "--iters") {
+      opts.iters = std::atoll(value.c_str());
+    } else {
+      LOG(FATAL) << "Unknown flag " << flag;
+    }
+  }
+  return opts;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opts = ParseOptions(argc, argv);
+  pid_t store_pid = 0;
+  if (opts.socket.empty()) {
+    opts.socket = "/tmp/vovp_bench_" + std::to_string(getpid()) + ".sock";
+    store_pid = StartStore(opts);
+  }
+
+  int failures = 0;
+  {
+    py::scoped_interpreter interpreter;
+    py::module::import("sys").attr("path").attr("insert")(0, opts.module_dir);
+
+    std::vector<std::pair<std::string, std::unique_ptr<Caller>>> callers;
+    callers.emplace_back("cpp", new CppCaller(opts.socket, "overhead_cpp"));
+    callers.emplace_back("c", new CCaller(opts.socket, "overhead_c"));
+    callers.emplace_back("python",
+                         new PythonCaller(opts.socket, "overhead_python"));
+
+    std::printf("%-6s %10s %12s %12s %12s %14s\n", "op", "size", "cpp us",
+                "c us", "python us", "saved/call us");
+    for (int64_t size : opts.sizes) {
+      int64_t shape[] = {size};
+      DLManagedTensor *source = NewHostTensor(shape, 1, {kDLUInt, 8, 1});
+      std::memset(source->dl_tensor.data, 1, size);
+      for (std::string op : {"put", "get", "create"}) {
+        std::vector<double> medians;
+        try {
+          for (auto &caller : callers) {
+            medians.push_back(
+                MedianNs(caller.second.get(), op, source, opts.iters));
+          }
+        } catch (const std::exception &e) {
+          std::fprintf(stderr, "%s %lld B failed: %s\n", op.c_str(),
+                       static_cast<long long>(size), e.what());
+          failures++;
+          continue;
+        }
+        // What a native caller saves over the binding on every call
+        std::printf("%-6s %10lld %12.2f %12.2f %12.2f %14.2f\n", op.c_str(),
+                    static_cast<long long>(size), medians[0] / 1e3,
+                    medians[1] / 1e3, medians[2] / 1e3,
+                    (medians[2] - medians[0]) / 1e3);
+      }
+      source->deleter(source);
+    }
+  }
+
+  if (store_pid > 0) {
+    kill(store_pid, SIGTERM);
+    waitpid(store_pid, nullptr, 0);
+    unlink(opts.socket.c_str());
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+# Compression ratio, put and decode throughput of client.put_compressed
+# against the raw put_tensor/get_tensor path.
+# Needs a running store: plasma-store-server -m 8000000000 -s /tmp/dgl_socket
+import argparse
+import time
+import torch as th
+import vovp
+
+
+def timeit(fn, repeat):
+    fn()
+    start = time.perf_counter()
+    for _ in range(repeat):
+        fn()
+    return (time.perf_counter() - start) / repeat
+
+
+def make_tensor(kind, rows, dim):
+    if kind == "sparse":
+        # Mostly zero features, e.g. one-hot or pruned embeddings
+        t = th.zeros(rows, dim)
+        mask = th.rand(rows, dim) < 0.1
+        t[mask] = th.rand(int(mask.sum()))
+        return t
+    if kind == "lowbits":
+        # Quantized values stored as float32
+        return th.randint(0, 16, (rows, dim)).float()
+    return th.rand(rows, dim)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--socket", default="/tmp/dgl_socket")
+    parser.add_argument("--rows", type=int, default=1000000)
+    parser.add_argument("--dim", type=int, default=128)
+    parser.add_argument("--data", default="sparse,lowbits,random")
+    parser.add_argument("--codecs", default="lz4,zstd")
+    parser.add_argument("--block-size", type=int, default=1 << 20)
+    parser.add_argument("--range-rows", type=int, default=1000)
+    parser.add_argument("--repeat", type=int, default=5)
+    args = parser.parse_args()
+
+    client = vovp.init_client(args.socket)
+    print("%-8s %-5s %7s %10s %10s %10s" %
+          ("data", "codec", "ratio", "put GB/s", "get GB/s", "range ms"))
+    for kind in args.data.split(","):
+        tensor = make_tensor(kind, args.rows, args.dim)
+        nbytes = tensor.numel() * tensor.element_size()
+        name = "bench_compression_" + kind
+
+        def raw_put():
+            client.put_tensor(name, tensor)
+
+        # Freeing a deleting view would drop the object after the first get
+        def raw_get():
+            client.get_tensor(name, delete_on_free=False).clone()
+
+        put_t = timeit(raw_put, args.repeat)
+        get_t = timeit(raw_get, args.repeat)
+        print("%-8s %-5s %7.2f %10.2f %10.2f %10s" %
+              (kind, "raw", 1.0, nbytes / put_t / 1e9, nbytes / get_t / 1e9, "-"))
+        client.delete(name)
+        for codec in args.codecs.split(","):
+            def put():
+                client.put_compressed(name, tensor, codec, args.block_size)
+
+            def get():
+                client.get_tensor(name, delete_on_free=False)
+
+            def get_range():
+                client.get_tensor_rows(name, args.rows // 2,
+                                       args.rows // 2 + args.range_rows)
+
+            put_t = timeit(put, args.repeat)
+            get_t = timeit(get, args.repeat)
+            range_t = timeit(get_range, args.repeat)
+            info = client.compression_info(name)
+            ratio = info["raw_size"] / max(info["compressed_size"], 1)
+            print("%-8s %-5s %7.2f %10.2f %10.2f %10.3f" %
+                  (kind, codec, ratio, nbytes / put_t / 1e9,
+                   nbytes / get_t / 1e9, range_t * 1e3))
+            client.delete(name)
+
+
+if __name__ == "__main__":
+    main()
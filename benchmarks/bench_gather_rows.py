@@ -0,0 +1,47 @@
+# Compare client.gather_rows with get_tensor + torch.index_select.
+# Needs a running store: plasma-store-server -m 8000000000 -s /tmp/dgl_socket
+import argparse
+import time
+import torch as th
+import vovp
+
+
+def timeit(fn, repeat):
+    fn()
+    start = time.perf_counter()
+    for _ in range(repeat):
+        fn()
+    return (time.perf_counter() - start) / repeat
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--socket", default="/tmp/dgl_socket")
+    parser.add_argument("--rows", type=int, default=2000000)
+    parser.add_argument("--dim", type=int, default=128)
+    parser.add_argument("--batch", type=int, default=100000)
+    parser.add_argument("--repeat", type=int, default=20)
+    args = parser.parse_args()
+
+    client = vovp.init_client(args.socket)
+    feat = client.put_tensor("bench_gather_feat", th.rand(args.rows, args.dim))
+    index = th.randint(0, args.rows, (args.batch,))
+    out = th.empty(args.batch, args.dim)
+    nbytes = args.batch * args.dim * 4
+
+    table = client.get_tensor("bench_gather_feat")
+
+    def torch_baseline():
+        th.index_select(table, 0, index, out=out)
+
+    def native():
+        client.gather_rows("bench_gather_feat", index, out=out)
+
+    for name, fn in [("torch", torch_baseline), ("gather_rows", native)]:
+        t = timeit(fn, args.repeat)
+        print("%-12s %8.3f ms %8.2f GB/s" % (name, t * 1e3, nbytes / t / 1e9))
+    del feat, table
+
+
+if __name__ == "__main__":
+    main()
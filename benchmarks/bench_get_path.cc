@@ -0,0 +1,85 @@
+// Microbenchmark of the get-side metadata decode and DLPack context setup.
+// "legacy" decodes dmlc-serialized metadata into a freshly allocated context,
+// "header" decodes the binary TensorHeader into a pooled one. No store is
+// needed: the buffers are plain host memory.
+#include <arrow/buffer.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <dmlc/memory_io.h>
+#include <new>
+#include <vector>
+#include <vovp/ndarray_utils.h>
+#include <vovp/serializer.h>
+#include <vovp/tensor_header.h>
+
+static std::atomic<int64_t> num_allocs(0);
+
+void *operator new(size_t size) {
+  num_allocs++;
+  void *ptr = std::malloc(size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+using namespace vovp;
+
+static std::string EncodeLegacyMetadata(const DLContext &ctx,
+                                        const DLDataType &dtype, int ndim,
+                                        const int64_t *shape) {
+  std::string metadata;
+  dmlc::MemoryStringStream strm_(&metadata);
+  auto strm = static_cast<dmlc::Stream *>(&strm_);
+  strm->Write(ctx);
+  strm->Write(dtype);
+  strm->Write(ndim);
+  strm->WriteArray(shape, ndim);
+  return metadata;
+}
+
+static void Run(const char *name, const std::string &metadata,
+                const std::shared_ptr<PlasmaTensorCtxPool> &pool,
+                int64_t iters) {
+  std::vector<uint8_t> data(4096);
+  auto buffer = std::make_shared<Buffer>(data.data(), data.size());
+  auto metadata_buffer = std::make_shared<Buffer>(
+      reinterpret_cast<const uint8_t *>(metadata.data()), metadata.size());
+  std::shared_ptr<PlasmaClient> client;
+  ObjectID object_id = ToObjectID("bench");
+
+  // Warm up the pool so the steady state is measured
+  for (int i = 0; i < 16; i++) {
+    auto dlm = GetPlasmaBufferToDlpack(buffer, metadata_buffer, client,
+                                       object_id, false, pool);
+    dlm->deleter(dlm);
+  }
+  int64_t allocs_before = num_allocs;
+  auto start = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < iters; i++) {
+    auto dlm = GetPlasmaBufferToDlpack(buffer, metadata_buffer, client,
+                                       object_id, false, pool);
+    dlm->deleter(dlm);
+  }
+  auto end = std::chrono::steady_clock::now();
+  double ns =
+      std::chrono::duration<double, std::nano>(end - start).count() / iters;
+  double allocs = static_cast<double>(num_allocs - allocs_before) / iters;
+  std::printf("%-8s %10.1f ns/get %6.2f allocs/get\n", name, ns, allocs);
+}
+
+int main(int argc, char **argv) {
+  int64_t iters = argc > 1 ? std::atoll(argv[1]) : 1000000;
+  DLContext ctx = {kDLCPU, 0};
+  DLDataType dtype = {kDLFloat, 32, 1};
+  int64_t shape[] = {1024, 16, 4};
+
+  Run("legacy", EncodeLegacyMetadata(ctx, dtype, 3, shape), nullptr, iters);
+  Run("header", EncodeTensorHeader(ctx, dtype, 3, shape),
+      std::make_shared<PlasmaTensorCtxPool>(), iters);
+  return 0;
+}
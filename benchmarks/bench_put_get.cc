@@ -0,0 +1,517 @@
+// End-to-end put/get/create benchmark against a real plasma store, with a raw
+// /dev/shm mmap baseline. Starts its own plasma-store-server on a temporary
+// socket unless --socket is given, sweeps tensor sizes, client threads and
+// client processes, and writes one JSON object per line to --out so results
+// of two runs can be compared with benchmarks/compare_bench.py.
+//
+//   bench_put_get [--store PATH] [--socket PATH] [--memory BYTES]
+//                 [--min-size BYTES] [--max-size BYTES] [--threads 1,2,4]
+//                 [--processes 1,2] [--iters N]
+//                 [--backends vovp,vovp_shared,shm] [--connections N]
+//                 [--ops put,get,create] [--out FILE]
+//
+// "vovp" gives every client thread its own manager, "vovp_shared" shares one
+// manager per process between its threads, with --connections connections
+// (default: one per thread).
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <vovp/ndarray_utils.h>
+#include <vovp/plasma_manager.h>
+
+#ifndef VOVP_PLASMA_STORE_SERVER
+#define VOVP_PLASMA_STORE_SERVER "plasma-store-server"
+#endif
+
+using namespace vovp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+  std::string store = VOVP_PLASMA_STORE_SERVER;
+  std::string socket;
+  int64_t memory = 4LL << 30;
+  int64_t min_size = 64;
+  int64_t max_size = 1LL << 30;
+  std::vector<int> threads = {1, 2, 4};
+  std::vector<int> processes = {1, 2};
+  int64_t iters = 1000;
+  // Bytes moved per worker and config, bounds the iterations of large sizes
+  int64_t bytes_budget = 2LL << 30;
+  std::vector<std::string> backends = {"vovp", "vovp_shared", "shm"};
+  int connections = 0;
+  std::vector<std::string> ops = {"put", "get", "create"};
+  std::string out = "bench_put_get.jsonl";
+};
+
+double ElapsedNs(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+      .count();
+}
+
+// One client thread of one backend. Each Timed* call runs a single operation
+// on an object private to the worker and returns its latency; setup and
+// teardown around it are not timed.
+class Worker {
+public:
+  virtual ~Worker() = default;
+  virtual double TimedPut() = 0;
+  virtual double TimedGet() = 0;
+  virtual double TimedCreate() = 0;
+};
+
+class VovpWorker : public Worker {
+public:
+  VovpWorker(std::shared_ptr<VovpPlasmaManager> manager_ptr, int64_t size,
+             const std::string &name)
+      : manager_ptr(manager_ptr), manager(*manager_ptr),
+        object_id(ToObjectID(name)) {
+    int64_t shape[] = {size};
+    source = NewHostTensor(shape, 1, {kDLUInt, 8, 1});
+    std::memset(source->dl_tensor.data, 1, size);
+  }
+
+  ~VovpWorker() override {
+    manager.Flush();
+    manager.Delete(object_id);
+    source->deleter(source);
+  }
+
+  double TimedPut() override {
+    auto start = Clock::now();
+    auto view = manager.PutDlpackTensor(source, object_id, false, true);
+    double ns = ElapsedNs(start);
+    view->deleter(view);
+    manager.Flush();
+    return ns;
+  }
+
+  double TimedGet() override {
+    auto view = manager.PutDlpackTensor(source, object_id, false, true);
+    view->deleter(view);
+    manager.Flush();
+    auto start = Clock::now();
+    view = manager.GetDlpackTensor(object_id);
+    double ns = ElapsedNs(start);
+    view->deleter(view);
+    manager.Flush();
+    return ns;
+  }
+
+  double TimedCreate() override {
+    auto &dl_tensor = source->dl_tensor;
+    auto start = Clock::now();
+    auto view = manager.CreateTensor(object_id, dl_tensor.shape, 1,
+                                     dl_tensor.dtype, dl_tensor.ctx);
+    double ns = ElapsedNs(start);
+    view->deleter(view);
+    manager.Flush();
+    manager.Delete(object_id);
+    return ns;
+  }
+
+private:
+  std::shared_ptr<VovpPlasmaManager> manager_ptr;
+  VovpPlasmaManager &manager;
+  ObjectID object_id;
+  DLManagedTensor *source;
+};
+
+// The same operations on a POSIX shared memory file per object
+class ShmWorker : public Worker {
+public:
+  ShmWorker(int64_t size, const std::string &name)
+      : size(size), name("/" + name), source(size, 1) {}
+
+  ~ShmWorker() override { shm_unlink(name.c_str()); }
+
+  double TimedPut() override {
+    auto start = Clock::now();
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+    CHECK_GE(fd, 0) << "shm_open failed: " << std::strerror(errno);
+    CHECK_EQ(ftruncate(fd, size), 0);
+    void *ptr = Map(fd, PROT_READ | PROT_WRITE);
+    std::memcpy(ptr, source.data(), size);
+    double ns = ElapsedNs(start);
+    munmap(ptr, size);
+    close(fd);
+    return ns;
+  }
+
+  double TimedGet() override {
+    TimedPut();
+    auto start = Clock::now();
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    CHECK_GE(fd, 0) << "shm_open failed: " << std::strerror(errno);
+    struct stat st;
+    CHECK_EQ(fstat(fd, &st), 0);
+    void *ptr = Map(fd, PROT_READ);
+    double ns = ElapsedNs(start);
+    munmap(ptr, st.st_size);
+    close(fd);
+    return ns;
+  }
+
+  double TimedCreate() override {
+    auto start = Clock::now();
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+    CHECK_GE(fd, 0) << "shm_open failed: " << std::strerror(errno);
+    CHECK_EQ(ftruncate(fd, size), 0);
+    void *ptr = Map(fd, PROT_READ | PROT_WRITE);
+    double ns = ElapsedNs(start);
+    munmap(ptr, size);
+    close(fd);
+    shm_unlink(name.c_str());
+    return ns;
+  }
+
+private:
+  void *Map(int fd, int prot) {
+    void *ptr = mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+    CHECK(ptr != MAP_FAILED) << "mmap failed: " << std::strerror(errno);
+    return ptr;
+  }
+
+  int64_t size;
+  std::string name;
+  std::vector<uint8_t> source;
+};
+
+struct Config {
+  std::string backend;
+  std::string op;
+  int64_t size;
+  int threads;
+  int processes;
+  int64_t iters;
+};
+
+// One client thread: a fresh worker, one untimed warm-up operation that maps
+// the store and faults the source, then `iters` timed operations
+void RunThread(const Options &opts, const Config &config, int proc_id,
+               int thread_id,
+               const std::shared_ptr<VovpPlasmaManager> &shared_manager,
+               std::vector<double> *samples) {
+  std::string name = "vb" + std::to_string(getpid()) + "_" +
+                     std::to_string(proc_id) + "_" + std::to_string(thread_id);
+  std::unique_ptr<Worker> worker;
+  if (config.backend == "vovp") {
+    worker.reset(new VovpWorker(
+        std::make_shared<VovpPlasmaManager>(opts.socket, 1), config.size,
+        name));
+  } else if (config.backend == "vovp_shared") {
+    worker.reset(new VovpWorker(shared_manager, config.size, name));
+  } else {
+    worker.reset(new ShmWorker(config.size, name));
+  }
+  for (int64_t i = 0; i <= config.iters; i++) {
+    double ns;
+    if (config.op == "put") {
+      ns = worker->TimedPut();
+    } else if (config.op == "get") {
+      ns = worker->TimedGet();
+    } else {
+      ns = worker->TimedCreate();
+    }
+    if (i > 0) {
+      samples->push_back(ns);
+    }
+  }
+}
+
+// Latencies of all threads of one process
+void RunProcess(const Options &opts, const Config &config, int proc_id,
+                std::vector<double> *samples) {
+  std::vector<std::vector<double>> thread_samples(config.threads);
+  std::vector<std::thread> threads;
+  std::atomic<bool> failed(false);
+  std::shared_ptr<VovpPlasmaManager> shared_manager;
+  if (config.backend == "vovp_shared") {
+    int connections = opts.connections > 0 ? opts.connections : config.threads;
+    shared_manager =
+        std::make_shared<VovpPlasmaManager>(opts.socket, connections);
+  }
+  for (int t = 0; t < config.threads; t++) {
+    threads.emplace_back([&, t]() {
+      try {
+        RunThread(opts, config, proc_id, t, shared_manager,
+                  &thread_samples[t]);
+      } catch (const std::exception &e) {
+        std::fprintf(stderr, "worker failed: %s\n", e.what());
+        failed = true;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  CHECK(!failed) << "A worker thread failed";
+  for (auto &out : thread_samples) {
+    samples->insert(samples->end(), out.begin(), out.end());
+  }
+}
+
+bool WriteAll(int fd, const void *data, size_t size) {
+  auto ptr = static_cast<const char *>(data);
+  while (size > 0) {
+    ssize_t n = write(fd, ptr, size);
+    if (n <= 0) {
+      return false;
+    }
+    ptr += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool ReadAll(int fd, void *data, size_t size) {
+  auto ptr = static_cast<char *>(data);
+  while (size > 0) {
+    ssize_t n = read(fd, ptr, size);
+    if (n <= 0) {
+      return false;
+    }
+    ptr += n;
+    size -= n;
+  }
+  return true;
+}
+
+// Fork one child per client process; each sends back its latency samples
+// over a pipe. Returns false if any child failed.
+bool RunConfig(const Options &opts, const Config &config,
+               std::vector<double> *samples) {
+  std::vector<std::pair<pid_t, int>> children;
+  for (int p = 0; p < config.processes; p++) {
+    int fds[2];
+    CHECK_EQ(pipe(fds), 0);
+    pid_t pid = fork();
+    CHECK_GE(pid, 0) << "fork failed";
+    if (pid == 0) {
+      close(fds[0]);
+      int code = 0;
+      try {
+        std::vector<double> out;
+        RunProcess(opts, config, p, &out);
+        uint64_t count = out.size();
+        if (!WriteAll(fds[1], &count, sizeof(count)) ||
+            !WriteAll(fds[1], out.data(), count * sizeof(double))) {
+          code = 1;
+        }
+      } catch (const std::exception &e) {
+        std::fprintf(stderr, "worker failed: %s\n", e.what());
+        code = 1;
+      }
+      _exit(code);
+    }
+    close(fds[1]);
+    children.emplace_back(pid, fds[0]);
+  }
+
+  bool ok = true;
+  for (auto &child : children) {
+    uint64_t count;
+    if (ReadAll(child.second, &count, sizeof(count))) {
+      size_t offset = samples->size();
+      samples->resize(offset + count);
+      ok &= ReadAll(child.second, samples->data() + offset,
+                    count * sizeof(double));
+    } else {
+      ok = false;
+    }
+    close(child.second);
+    int status;
+    waitpid(child.first, &status, 0);
+    ok &= WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  }
+  return ok;
+}
+
+double Percentile(const std::vector<double> &sorted, double q) {
+  size_t index = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+void Report(FILE *out, const Config &config, std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  double sum = 0;
+  for (double ns : samples) {
+    sum += ns;
+  }
+  double mean = sum / samples.size();
+  // Aggregate bandwidth of all workers issuing operations back to back. The
+  // untimed setup between operations (e.g. the put before each get) is left
+  // out, so this is not a wall-clock rate.
+  double gbps = config.size * static_cast<double>(config.threads) *
+                config.processes / mean;
+  std::fprintf(out,
+               "{\"backend\": \"%s\", \"op\": \"%s\", \"size\": %lld, "
+               "\"threads\": %d, \"processes\": %d, \"samples\": %zu, "
+               "\"mean_us\": %.3f, \"p50_us\": %.3f, \"p90_us\": %.3f, "
+               "\"p99_us\": %.3f, \"max_us\": %.3f, \"gbps\": %.4f}\n",
+               config.backend.c_str(), config.op.c_str(),
+               static_cast<long long>(config.size), config.threads,
+               config.processes, samples.size(), mean / 1e3,
+               Percentile(samples, 0.5) / 1e3, Percentile(samples, 0.9) / 1e3,
+               Percentile(samples, 0.99) / 1e3, samples.back() / 1e3, gbps);
+  std::fflush(out);
+  std::printf("%-11s %-6s %12lld B  %2dt x %dp  p50 %10.2f us  p99 %10.2f us"
+              "  %8.3f GB/s\n",
+              config.backend.c_str(), config.op.c_str(),
+              static_cast<long long>(config.size), config.threads,
+              config.processes, Percentile(samples, 0.5) / 1e3,
+              Percentile(samples, 0.99) / 1e3, gbps);
+}
+
+pid_t StartStore(const Options &opts) {
+  unlink(opts.socket.c_str());
+  pid_t pid = fork();
+  CHECK_GE(pid, 0) << "fork failed";
+  if (pid == 0) {
+    std::string memory = std::to_string(opts.memory);
+    execlp(opts.store.c_str(), opts.store.c_str(), "-m", memory.c_str(), "-s",
+           opts.socket.c_str(), static_cast<char *>(nullptr));
+    std::fprintf(stderr, "Failed to start %s: %s\n", opts.store.c_str(),
+                 std::strerror(errno));
+    _exit(127);
+  }
+  struct stat st;
+  for (int i = 0; i < 100 && stat(opts.socket.c_str(), &st) != 0; i++) {
+    int status;
+    CHECK_EQ(waitpid(pid, &status, WNOHANG), 0)
+        << opts.store << " exited during startup";
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  CHECK_EQ(stat(opts.socket.c_str(), &st), 0)
+      << "Plasma store did not create " << opts.socket;
+  return pid;
+}
+
+std::vector<std::string> SplitList(const std::string &value) {
+  std::vector<std::string> items;
+  size_t start = 0;
+  while (start <= value.size()) {
+    size_t end = value.find(',', start);
+    if (end == std::string::npos) {
+      end = value.size();
+    }
+    if (end > start) {
+      items.push_back(value.substr(start, end - start));
+    }
+    start = end + 1;
+  }
+  return items;
+}
+
+std::vector<int> SplitInts(const std::string &value) {
+  std::vector<int> items;
+  for (auto &item : SplitList(value)) {
+    items.push_back(std::atoi(item.c_str()));
+  }
+  return items;
+}
+
+Options ParseOptions(int argc, char **argv) {
+  Options opts;
+  for (int i = 1; i < argc; i++) {
+    std::string flag = argv[i];
+    CHECK_LT(i + 1, argc) << "Missing value for " << flag;
+    std::string value = argv[++i];
+    if (flag == "--store") {
+      opts.store = value;
+    } else if (flag == "--socket") {
+      opts.socket = value;
+    } else if (flag == "--memory") {
+      opts.memory = std::atoll(value.c_str());
+    } else if (flag == "--min-size") {
+      opts.min_size = std::atoll(value.c_str());
+    } else if (flag == "--max-size") {
+      opts.max_size = std::atoll(value.c_str());
+    } else if (flag == "--threads") {
+      opts.threads = SplitInts(value);
+    } else if (flag == "--processes") {
+      opts.processes = SplitInts(value);
+    } else if (flag == "--iters") {
+      opts.iters = std::atoll(value.c_str());
+    } else if (flag == "--connections") {
+      opts.connections = std::atoi(value.c_str());
+    } else if (flag == "--backends") {
+      opts.backends = SplitList(value);
+    } else if (flag == "--ops") {
+      opts.ops = SplitList(value);
+    } else if (flag == "--out") {
+      opts.out = value;
+    } else {
+      LOG(FATAL) << "Unknown flag " << flag;
+    }
+  }
+  return opts;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opts = ParseOptions(argc, argv);
+  pid_t store_pid = 0;
+  bool need_store = false;
+  for (auto &backend : opts.backends) {
+    need_store |= backend != "shm";
+  }
+  if (need_store && opts.socket.empty()) {
+    opts.socket = "/tmp/vovp_bench_" + std::to_string(getpid()) + ".sock";
+    store_pid = StartStore(opts);
+  }
+
+  FILE *out = std::fopen(opts.out.c_str(), "w");
+  CHECK(out != nullptr) << "Cannot open " << opts.out;
+  int failures = 0;
+  for (int64_t size = opts.min_size; size <= opts.max_size; size *= 4) {
+    for (int processes : opts.processes) {
+      for (int threads : opts.threads) {
+        int64_t workers = static_cast<int64_t>(threads) * processes;
+        // Every worker holds one object of `size` in the store
+        if (size * workers > opts.memory / 2) {
+          continue;
+        }
+        int64_t iters = std::max<int64_t>(
+            5, std::min(opts.iters, opts.bytes_budget / size));
+        for (auto &backend : opts.backends) {
+          for (auto &op : opts.ops) {
+            Config config{backend, op, size, threads, processes, iters};
+            std::vector<double> samples;
+            if (RunConfig(opts, config, &samples) && !samples.empty()) {
+              Report(out, config, std::move(samples));
+            } else {
+              std::fprintf(stderr, "%s %s %lld B %dt x %dp failed\n",
+                           backend.c_str(), op.c_str(),
+                           static_cast<long long>(size), threads, processes);
+              failures++;
+            }
+          }
+        }
+      }
+    }
+  }
+  std::fclose(out);
+
+  if (store_pid > 0) {
+    kill(store_pid, SIGTERM);
+    waitpid(store_pid, nullptr, 0);
+    unlink(opts.socket.c_str());
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,51 @@
+# Compare two result files of bench_put_get, e.g. before and after a change:
+#   python benchmarks/compare_bench.py base.jsonl new.jsonl --threshold 0.1
+# Exits non-zero if any p50 latency regressed by more than the threshold.
+import argparse
+import json
+import sys
+
+KEY = ("backend", "op", "size", "threads", "processes")
+
+
+def load(path):
+    results = {}
+    with open(path) as f:
+        for line in f:
+            if line.strip():
+                row = json.loads(line)
+                results[tuple(row[k] for k in KEY)] = row
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("base")
+    parser.add_argument("new")
+    parser.add_argument("--threshold", type=float, default=0.1)
+    args = parser.parse_args()
+
+    base = load(args.base)
+    new = load(args.new)
+    regressions = 0
+    print("%-11s %-6s %12s %4s %4s %12s %12s %8s" %
+          ("", "op", "size", "thr", "proc", "base p50 us", "new p50 us",
+           "change"))
+    for key in sorted(base.keys() & new.keys()):
+        old_p50 = base[key]["p50_us"]
+        new_p50 = new[key]["p50_us"]
+        change = new_p50 / old_p50 - 1 if old_p50 > 0 else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSED"
+            regressions += 1
+        print("%-11s %-6s %12d %4d %4d %12.2f %12.2f %+7.1f%%%s" %
+              (key + (old_p50, new_p50, change * 100, flag)))
+    for key in sorted(base.keys() ^ new.keys()):
+        print("only in %s: %s" % (args.base if key in base else args.new,
+                                  key))
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,47 @@
+#ifndef VOVP_ASYNC_WORKER_H
+#define VOVP_ASYNC_WORKER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vovp {
+
+// Small FIFO executor for the async put/get API. Tasks run on native threads
+// that never hold the Python GIL unless they take it explicitly.
+class AsyncWorker {
+public:
+  explicit AsyncWorker(int num_threads);
+  ~AsyncWorker();
+
+  template <typename F>
+  auto Submit(F f) -> std::future<decltype(f())> {
+    using R = decltype(f());
+    auto task = std::make_shared<std::packaged_task<R()>>(std::move(f));
+    auto future = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.emplace_back([task] { (*task)(); });
+    }
+    cond.notify_one();
+    return future;
+  }
+
+private:
+  void Run();
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::deque<std::function<void()>> tasks;
+  bool stopped = false;
+  std::vector<std::thread> threads;
+};
+
+} // namespace vovp
+
+#endif /* VOVP_ASYNC_WORKER_H */
@@ -0,0 +1,62 @@
+#ifndef VOVP_BUNDLE_H
+#define VOVP_BUNDLE_H
+
+#include <cstdint>
+#include <dlpack/dlpack.h>
+#include <string>
+#include <vector>
+
+namespace vovp {
+
+// "VBND" in little endian, distinct from kTensorHeaderMagic
+static constexpr uint32_t kBundleMagic = 0x444e4256;
+static constexpr uint16_t kBundleVersion = 1;
+// Members start on their own cache line
+static constexpr int64_t kBundleAlign = 64;
+
+// Metadata of an object holding several named tensors. The header is
+// followed by one record per member: a BundleEntry, the name, then the
+// member's TensorHeader, padded to 8 bytes.
+struct BundleHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t num_members;
+  // Size in bytes of the whole bundle metadata
+  uint32_t header_size;
+};
+static_assert(sizeof(BundleHeader) == 16, "BundleHeader layout changed");
+
+struct BundleEntry {
+  // Location of the member in the data buffer
+  uint64_t data_offset;
+  uint64_t data_size;
+  uint32_t name_size;
+  uint32_t tensor_header_size;
+};
+static_assert(sizeof(BundleEntry) == 24, "BundleEntry layout changed");
+
+// A decoded member. `tensor_header` points into the decoded metadata.
+struct BundleMember {
+  std::string name;
+  int64_t data_offset;
+  int64_t data_size;
+  const uint8_t *tensor_header;
+  int64_t tensor_header_size;
+};
+
+// Encode the metadata of a bundle of row-major tensors, stored in that
+// order at aligned offsets. `offsets` receives the offset of every member
+// and `data_size` the size of the data buffer.
+std::string EncodeBundleHeader(const std::vector<std::string> &names,
+                               const std::vector<const DLTensor *> &tensors,
+                               std::vector<int64_t> *offsets,
+                               int64_t *data_size);
+
+// Returns false if `data` is not bundle metadata
+bool DecodeBundleHeader(const uint8_t *data, int64_t size,
+                        std::vector<BundleMember> *members);
+
+} // namespace vovp
+
+#endif /* VOVP_BUNDLE_H */
@@ -0,0 +1,88 @@
+#ifndef VOVP_C_API_H
+#define VOVP_C_API_H
+
+// C interface of libvovp for native clients and other language bindings. It
+// wraps VovpPlasmaManager: every call runs on the caller's thread without
+// any interpreter lock. Calls return VOVP_OK or a negative error code; the
+// message of the last error of the calling thread is in vovp_last_error().
+// Null pointer arguments fail with VOVP_INVALID_ARGUMENT.
+// Tensors are plain DLPack tensors; those returned by the library view store
+// memory and hold a reference on their object until their deleter is
+// called.
+
+#include <dlpack/dlpack.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bumped when a declaration below changes incompatibly
+#define VOVP_C_API_VERSION 2
+
+#define VOVP_OBJECT_ID_SIZE 20
+
+#define VOVP_OK 0
+#define VOVP_ERROR -1
+// The object was not sealed within the timeout
+#define VOVP_TIMEOUT -2
+#define VOVP_INVALID_ARGUMENT -3
+
+typedef struct vovp_client vovp_client_t;
+
+// Store object ID. IDs given as names are zero padded, as in the Python
+// client, so both name the same objects.
+typedef struct {
+  uint8_t id[VOVP_OBJECT_ID_SIZE];
+} vovp_object_id_t;
+
+int vovp_api_version(void);
+const char *vovp_last_error(void);
+
+// Fails with VOVP_INVALID_ARGUMENT if `name` is longer than an ID
+int vovp_object_id_from_name(const char *name, size_t length,
+                             vovp_object_id_t *object_id);
+
+// Connect to the store at `socket_name` over `num_connections` connections,
+// 0 for the default
+int vovp_client_create(const char *socket_name, int num_connections,
+                       vovp_client_t **client);
+void vovp_client_destroy(vovp_client_t *client);
+
+// Copy `tensor` into a new sealed object and return a view of it in `out`.
+// The caller keeps ownership of `tensor`.
+int vovp_put(vovp_client_t *client, const vovp_object_id_t *object_id,
+             DLManagedTensor *tensor, DLManagedTensor **out);
+// Wait up to `timeout_ms` (-1 for ever) for the object to be sealed.
+// Calling the deleter of the result also deletes the object from the store,
+// for every client, once its last reference is released.
+int vovp_get(vovp_client_t *client, const vovp_object_id_t *object_id,
+             int64_t timeout_ms, DLManagedTensor **out);
+// As vovp_get, but the object is only deleted by the deleter of the result
+// if `delete_on_free` is set
+int vovp_get_ex(vovp_client_t *client, const vovp_object_id_t *object_id,
+                int64_t timeout_ms, int delete_on_free,
+                DLManagedTensor **out);
+// Create an object and return a writable view of it. Unless `seal` is set
+// the object stays unsealed until vovp_seal, or vovp_abort discards it.
+int vovp_create(vovp_client_t *client, const vovp_object_id_t *object_id,
+                const int64_t *shape, int ndim, DLDataType dtype,
+                DLContext ctx, int seal, DLManagedTensor **out);
+int vovp_seal(vovp_client_t *client, const vovp_object_id_t *object_id);
+int vovp_abort(vovp_client_t *client, const vovp_object_id_t *object_id);
+// Give up the reference `tensor`, a view returned by this client, holds on
+// its object before calling its deleter, which must still be called. The
+// view's data must not be used afterwards. Fails with VOVP_ERROR if the
+// tensor is not such a view or was already released.
+int vovp_release(vovp_client_t *client, DLManagedTensor *tensor);
+// Delete now, or once the last reference is released if it is in use
+int vovp_delete(vovp_client_t *client, const vovp_object_id_t *object_id);
+// Send the releases and deletes still batched by the client
+int vovp_flush(vovp_client_t *client);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VOVP_C_API_H */
@@ -0,0 +1,85 @@
+#ifndef VOVP_COMPRESSION_H
+#define VOVP_COMPRESSION_H
+
+#include <arrow/util/compression.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vovp {
+
+// "VCMP" in little endian, distinct from kTensorHeaderMagic
+static constexpr uint32_t kCompressedMagic = 0x504d4356;
+static constexpr uint16_t kCompressedVersion = 1;
+static constexpr int64_t kDefaultCompressionBlock = 1 << 20;
+static constexpr int64_t kMaxCompressionBlock = 1 << 30;
+
+// Metadata of an object holding a CPU tensor compressed in fixed-size
+// blocks. The header is followed by the TensorHeader of the uncompressed
+// tensor, then by one CompressedBlock per block.
+struct CompressedHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+  // arrow::Compression::type of the blocks
+  int32_t codec;
+  uint32_t tensor_header_size;
+  // Uncompressed bytes per block, the last block may be shorter
+  uint64_t block_size;
+  uint64_t num_blocks;
+  // Size in bytes of the uncompressed tensor
+  uint64_t raw_size;
+  // Size in bytes of the whole metadata
+  uint64_t header_size;
+};
+static_assert(sizeof(CompressedHeader) == 48,
+              "CompressedHeader layout changed");
+
+struct CompressedBlock {
+  // Location of the block in the data buffer. A block whose size is its
+  // uncompressed size is stored as is, because it did not compress.
+  uint64_t offset;
+  uint64_t size;
+};
+static_assert(sizeof(CompressedBlock) == 16, "CompressedBlock layout changed");
+
+// A decoded header. `tensor_header` points into the decoded metadata.
+struct CompressedLayout {
+  CompressedHeader header;
+  const uint8_t *tensor_header;
+  std::vector<CompressedBlock> blocks;
+};
+
+// "lz4" or "zstd"
+arrow::Compression::type ParseCompression(const std::string &name);
+const char *CompressionName(int codec);
+
+bool IsCompressedHeader(const uint8_t *data, int64_t size);
+
+// Compress the `size` bytes at `src` in blocks of `block_size` on the copy
+// engine threads
+std::vector<std::string> CompressBlocks(arrow::Compression::type codec,
+                                        const uint8_t *src, int64_t size,
+                                        int64_t block_size);
+
+// Encode the metadata of `blocks`, stored back to back in that order.
+// `data_size` receives the size of the data buffer.
+std::string EncodeCompressedHeader(arrow::Compression::type codec,
+                                   int64_t block_size, int64_t raw_size,
+                                   const std::string &tensor_header,
+                                   const std::vector<std::string> &blocks,
+                                   int64_t *data_size);
+
+// Returns false if `data` is not compressed tensor metadata
+bool DecodeCompressedHeader(const uint8_t *data, int64_t size,
+                            CompressedLayout *layout);
+
+// Write the uncompressed bytes [begin, end) of the tensor to `dst`,
+// decompressing only the blocks they span, in parallel
+void DecompressRange(const CompressedLayout &layout, const uint8_t *data,
+                     int64_t data_size, int64_t begin, int64_t end,
+                     uint8_t *dst);
+
+} // namespace vovp
+
+#endif /* VOVP_COMPRESSION_H */
@@ -0,0 +1,75 @@
+#ifndef VOVP_CONNECTION_POOL_H
+#define VOVP_CONNECTION_POOL_H
+
+#include <atomic>
+#include <memory>
+#include <plasma/client.h>
+#include <string>
+#include <vector>
+#include <vovp/metrics.h>
+#include <vovp/reclaim_queue.h>
+
+namespace vovp {
+using namespace plasma;
+
+// Independent connections to one store. A PlasmaClient serializes all of
+// its requests on one socket, so concurrent puts and gets each lease their
+// own connection. Store references belong to the connection that took them:
+// every connection has its own reclaim queue, and tensors keep the client
+// and queue they were created with, so they can be freed from any thread.
+class ConnectionPool {
+public:
+  struct Connection {
+    std::shared_ptr<PlasmaClient> client;
+    std::shared_ptr<ReclaimQueue> reclaimer;
+    // Number of leases currently held
+    std::atomic<int> active{0};
+  };
+
+  // Holds a connection for the duration of one operation
+  class Lease {
+  public:
+    explicit Lease(Connection *conn) : conn(conn) {}
+    Lease(Lease &&other) : conn(other.conn) { other.conn = nullptr; }
+    Lease(const Lease &) = delete;
+    Lease &operator=(const Lease &) = delete;
+    ~Lease() {
+      if (conn != nullptr) {
+        conn->active.fetch_sub(1, std::memory_order_release);
+      }
+    }
+    Connection *operator->() const { return conn; }
+
+  private:
+    Connection *conn;
+  };
+
+  ConnectionPool(const std::string &socket_name, int num_connections,
+                 const std::shared_ptr<Metrics> &metrics);
+
+  // An idle connection if there is one, otherwise the next one in turn
+  Lease Acquire();
+  // Connection used for requests not tied to an operation, e.g. List
+  Connection &Primary() { return *connections[0]; }
+  size_t size() const { return connections.size(); }
+  // NUMA node the store keeps its memory on, -1 if unknown
+  int node() const { return numa_node; }
+  void set_node(int node) { numa_node = node; }
+
+  // Flush the reclaim queues that have pending requests. Must run before an
+  // object ID is created again: a delete of its previous incarnation may be
+  // queued on any connection.
+  void FlushPending();
+  void Flush();
+  void SetReclaimOptions(size_t flush_threshold, int64_t flush_interval_ms);
+  void SetDeleteHook(const ReclaimQueue::DeleteHook &hook);
+
+private:
+  std::vector<std::unique_ptr<Connection>> connections;
+  std::atomic<size_t> next{0};
+  int numa_node = -1;
+};
+
+} // namespace vovp
+
+#endif /* VOVP_CONNECTION_POOL_H */
@@ -0,0 +1,109 @@
+#ifndef VOVP_COPY_ENGINE_H
+#define VOVP_COPY_ENGINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vovp {
+
+// Size of an x86-64 huge page
+static constexpr int64_t kHugePageSize = 2 << 20;
+
+struct CopyOptions {
+  // Upper bound on threads per copy, 0 picks one from the machine
+  int num_threads = 0;
+  // Copies smaller than this stay on the calling thread
+  int64_t parallel_threshold = 1 << 20;
+  // Each extra thread needs at least this many bytes to work on
+  int64_t bytes_per_thread = 4 << 20;
+  // Copies at least this large bypass the cache with streaming stores
+  int64_t nontemporal_threshold = 64 << 20;
+  // Run the copy on threads pinned to the NUMA node of the destination
+  bool numa_pin = true;
+  // New objects at least this large have their pages populated in parallel
+  // before the copy, or before CreateTensor returns. -1 disables.
+  int64_t prefault_threshold = 64 << 20;
+  // The data of new CPU objects at least this large starts on a huge page
+  // boundary, at the cost of up to kHugePageSize of padding. -1 disables.
+  int64_t huge_page_align_threshold = 64 << 20;
+};
+
+// Fixed set of worker threads that stays alive between copies, optionally
+// pinned to a set of CPUs.
+class ThreadPool {
+public:
+  ThreadPool(int num_workers, const std::vector<int> &cpus);
+  ~ThreadPool();
+
+  // Run f(0) ... f(num_tasks - 1) on the calling thread and up to
+  // `num_threads - 1` workers. Returns once every task is done.
+  void Run(int num_tasks, int num_threads,
+           const std::function<void(int)> &f);
+  int num_workers() const { return static_cast<int>(workers.size()); }
+
+private:
+  void WorkerLoop(int worker_id, std::vector<int> cpus);
+  void RunTasks();
+
+  std::vector<std::thread> workers;
+  // Only one Run at a time owns the workers
+  std::mutex run_mutex;
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::condition_variable done_cond;
+  const std::function<void(int)> *job = nullptr;
+  int num_tasks = 0;
+  std::atomic<int> next_task{0};
+  int num_helpers = 0;
+  int num_finished = 0;
+  uint64_t generation = 0;
+  bool stopped = false;
+};
+
+// Process-wide engine for bulk host copies into store memory. Keeps one
+// thread pool per NUMA node and picks the thread count from the copy size.
+class CopyEngine {
+public:
+  static CopyEngine &Global();
+
+  void Memcpy(void *dst, const void *src, int64_t size);
+  // Fault in the pages of [ptr, ptr + size) for writing, one huge page per
+  // task on threads of the node of `ptr`, so the copy or the first write of
+  // the user does not stop on page faults. The contents are left unchanged.
+  void Prefault(void *ptr, int64_t size);
+  // Split [0, num_tasks) into contiguous ranges and run f(begin, end) on
+  // `num_threads` threads, on the node of `dst_hint` if it is given.
+  void ParallelFor(int64_t num_tasks, int num_threads,
+                   const std::function<void(int64_t, int64_t)> &f,
+                   const void *dst_hint = nullptr);
+  int NumThreadsFor(int64_t size);
+
+  CopyOptions options();
+  void SetOptions(const CopyOptions &options);
+
+private:
+  CopyEngine();
+  std::shared_ptr<ThreadPool> GetPool(const void *dst_hint);
+  int MaxThreads(int node);
+
+  std::mutex mutex;
+  CopyOptions options_;
+  // CPUs of each NUMA node, empty if the topology is unknown
+  std::vector<std::vector<int>> node_cpus;
+  // Keyed by NUMA node, -1 for the unpinned pool
+  std::map<int, std::shared_ptr<ThreadPool>> pools;
+};
+
+// Node holding the page at `addr`, or -1 if it cannot be determined
+int NumaNodeOfAddress(const void *addr);
+
+} // namespace vovp
+
+#endif /* VOVP_COPY_ENGINE_H */
@@ -0,0 +1,29 @@
+#ifndef VOVP_COPY_UTILS_H
+#define VOVP_COPY_UTILS_H
+
+#include <cstdint>
+#include <dlpack/dlpack.h>
+
+namespace vovp {
+
+// Number of bytes of a dense tensor with the given dtype and shape.
+int64_t GetDataSize(const DLDataType &dtype, const int64_t *shape, int ndim);
+
+// Gather a (possibly non-contiguous) CPU tensor into the row-major buffer
+// `dst`. Strides are in elements, as in DLPack; nullptr means contiguous.
+// Dimensions are collapsed first, contiguous rows are copied with memcpy and
+// transposed layouts are copied in cache-sized tiles, split across the
+// CopyEngine threads once the tensor is large enough.
+void StridedCopy(void *dst, const DLTensor &src, int num_threads = 0);
+
+// dst[i] = src[index[i]] for rows of `row_bytes` bytes. `index` must be a
+// contiguous 1-D int32 or int64 CPU tensor; out of range indices are fatal.
+// Rows ahead of the current one are prefetched since random indices defeat
+// the hardware prefetcher.
+void GatherRows(void *dst, const void *src, int64_t num_rows,
+                int64_t row_bytes, const DLTensor &index,
+                int num_threads = 0);
+
+} // namespace vovp
+
+#endif /* VOVP_COPY_UTILS_H */
@@ -0,0 +1,80 @@
+#ifndef VOVP_DEDUP_H
+#define VOVP_DEDUP_H
+
+#include <atomic>
+#include <cstdint>
+#include <plasma/common.h>
+#include <string>
+
+namespace vovp {
+
+// "VALS" in little endian, distinct from kTensorHeaderMagic
+static constexpr uint32_t kAliasMagic = 0x534c4156;
+
+// Metadata of an empty object that stands for `target`, the object holding
+// its data. Written by deduplicating puts.
+struct AliasHeader {
+  uint32_t magic;
+  // Set once the alias has been dropped from the count of its target
+  uint32_t dropped;
+  uint8_t target[plasma::kUniqueIDSize];
+  uint32_t reserved2;
+};
+static_assert(sizeof(AliasHeader) == 32, "AliasHeader layout changed");
+
+// "VCNT" in little endian
+static constexpr uint32_t kAliasCountMagic = 0x544e4356;
+
+// Data of the object counting the aliases of a shared object, kept next to
+// it. The count is updated in place since store memory is mapped writable in
+// every client. It turns negative when the last alias is dropped and the
+// shared object is being deleted, after which no alias can be added.
+struct AliasCount {
+  uint32_t magic;
+  uint32_t reserved;
+  std::atomic<int64_t> count;
+};
+static_assert(sizeof(AliasCount) == 16, "AliasCount layout changed");
+
+struct ContentDigest {
+  uint64_t lo;
+  uint64_t hi;
+};
+
+// 128-bit digest of `size` bytes, not cryptographic. Large inputs are
+// hashed in fixed-size chunks on the copy engine threads, so the digest
+// does not depend on the thread count or on SSE2 being available.
+ContentDigest ContentHash(const void *data, int64_t size, uint64_t seed = 0);
+
+// memcmp on the copy engine threads
+bool ContentEqual(const void *a, const void *b, int64_t size);
+
+// ID of the shared object holding the contents with this digest, the same
+// in every client
+plasma::ObjectID DedupObjectID(const ContentDigest &digest);
+
+// ID of the object counting the aliases of the shared object `shared_id`
+plasma::ObjectID AliasCountID(const plasma::ObjectID &shared_id);
+
+// Initialize a new count object, with no aliases, before it is sealed
+void InitAliasCount(uint8_t *buffer);
+// The count held by a buffer, or null if it is not a count object
+AliasCount *FindAliasCount(const uint8_t *buffer, int64_t size);
+// Count one more alias. False if the shared object is being deleted.
+bool AddAlias(AliasCount *count);
+// Count one alias less. True if it was the last one, whose owner then
+// deletes the shared object.
+bool RemoveAlias(AliasCount *count);
+
+std::string EncodeAliasHeader(const plasma::ObjectID &target);
+// Returns false if `data` is not alias metadata
+bool DecodeAliasHeader(const uint8_t *data, int64_t size,
+                       plasma::ObjectID *target);
+// Mark the alias with the metadata at `data`, in store memory, as dropped.
+// True for the first caller only, so an alias deleted several times, e.g. by
+// each of its views, is counted down once.
+bool MarkAliasDropped(const uint8_t *data);
+
+} // namespace vovp
+
+#endif /* VOVP_DEDUP_H */
@@ -0,0 +1,192 @@
+#ifndef VOVP_METRICS_H
+#define VOVP_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <dlpack/dlpack.h>
+#include <vector>
+
+namespace vovp {
+
+// Phases of the store operations timed by Metrics
+enum class Phase {
+  kCreate = 0,
+  kCopy,
+  kSeal,
+  kGet,
+  kRelease,
+  kDelete,
+  kAbort,
+  kCreateBatch,
+  kUpdate,
+  kPrefault,
+  kCompress,
+  kDecompress,
+  kHash,
+  kNumPhases
+};
+
+const char *PhaseName(Phase phase);
+
+// Lock-free latency histogram in nanoseconds. Buckets are log-linear: four
+// per power of two, so percentiles are exact to within 25%.
+class LatencyHistogram {
+public:
+  static constexpr int kNumBuckets = 252;
+
+  LatencyHistogram();
+
+  void Record(uint64_t ns) {
+    buckets[BucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum_ns.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t prev = max_ns.load(std::memory_order_relaxed);
+    while (ns > prev &&
+           !max_ns.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {
+    }
+  }
+
+  uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+  uint64_t SumNs() const { return sum_ns.load(std::memory_order_relaxed); }
+  uint64_t MaxNs() const { return max_ns.load(std::memory_order_relaxed); }
+  // Upper bound of the bucket holding the q-th quantile, 0 when empty
+  uint64_t PercentileNs(double q) const;
+  // (exclusive upper bound in ns, count) of every non-empty bucket
+  std::vector<std::pair<uint64_t, uint64_t>> Buckets() const;
+  void Reset();
+
+  static int BucketOf(uint64_t ns) {
+    if (ns < 4) {
+      return static_cast<int>(ns);
+    }
+    int exp = 63 - __builtin_clzll(ns);
+    int mantissa = static_cast<int>((ns >> (exp - 2)) & 3);
+    return 4 * (exp - 1) + mantissa;
+  }
+  static uint64_t BucketUpperBound(int bucket);
+
+private:
+  std::atomic<uint64_t> buckets[kNumBuckets];
+  std::atomic<uint64_t> count;
+  std::atomic<uint64_t> sum_ns;
+  std::atomic<uint64_t> max_ns;
+};
+
+// Per-manager counters. Recording is a handful of relaxed atomic adds; build
+// with VOVP_DISABLE_METRICS to compile the VOVP_METRICS_* macros away.
+class Metrics {
+public:
+  static constexpr bool kEnabled =
+#ifdef VOVP_DISABLE_METRICS
+      false;
+#else
+      true;
+#endif
+
+  Metrics();
+
+  void RecordLatency(Phase phase, uint64_t ns) {
+    latency[static_cast<int>(phase)].Record(ns);
+  }
+  void AddCopiedBytes(DLDeviceType device, int64_t bytes) {
+    auto &counter = device == kDLCPU ? cpu_bytes_copied : gpu_bytes_copied;
+    counter.fetch_add(bytes, std::memory_order_relaxed);
+  }
+  void AddPageFaults(Phase phase, int64_t faults) {
+    page_faults[static_cast<int>(phase)].fetch_add(faults,
+                                                   std::memory_order_relaxed);
+  }
+
+  const LatencyHistogram &Latency(Phase phase) const {
+    return latency[static_cast<int>(phase)];
+  }
+  int64_t CpuBytesCopied() const {
+    return cpu_bytes_copied.load(std::memory_order_relaxed);
+  }
+  int64_t GpuBytesCopied() const {
+    return gpu_bytes_copied.load(std::memory_order_relaxed);
+  }
+  int64_t PageFaults(Phase phase) const {
+    return page_faults[static_cast<int>(phase)].load(
+        std::memory_order_relaxed);
+  }
+  void Reset();
+
+private:
+  LatencyHistogram latency[static_cast<int>(Phase::kNumPhases)];
+  std::atomic<int64_t> page_faults[static_cast<int>(Phase::kNumPhases)];
+  std::atomic<int64_t> cpu_bytes_copied;
+  std::atomic<int64_t> gpu_bytes_copied;
+};
+
+// Records the lifetime of the scope as one sample of `phase`. A null
+// `metrics` records nothing.
+class ScopedPhaseTimer {
+public:
+  ScopedPhaseTimer(Metrics *metrics, Phase phase)
+      : metrics(metrics), phase(phase),
+        start(std::chrono::steady_clock::now()) {}
+  ~ScopedPhaseTimer() {
+    if (metrics != nullptr) {
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      metrics->RecordLatency(
+          phase,
+          std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+              .count());
+    }
+  }
+
+private:
+  Metrics *metrics;
+  Phase phase;
+  std::chrono::steady_clock::time_point start;
+};
+
+// Adds the page faults taken during the scope to `phase`. The count is
+// process-wide, so it includes the faults of the copy threads, and those of
+// any other thread running at the same time.
+class ScopedPageFaultCounter {
+public:
+  ScopedPageFaultCounter(Metrics *metrics, Phase phase)
+      : metrics(metrics), phase(phase),
+        start(metrics != nullptr ? ProcessPageFaults() : 0) {}
+  ~ScopedPageFaultCounter() {
+    if (metrics != nullptr) {
+      metrics->AddPageFaults(phase, ProcessPageFaults() - start);
+    }
+  }
+
+  // Minor and major faults of the process so far
+  static int64_t ProcessPageFaults();
+
+private:
+  Metrics *metrics;
+  Phase phase;
+  int64_t start;
+};
+
+} // namespace vovp
+
+#define VOVP_METRICS_CONCAT_(a, b) a##b
+#define VOVP_METRICS_CONCAT(a, b) VOVP_METRICS_CONCAT_(a, b)
+
+#ifndef VOVP_DISABLE_METRICS
+// Time the rest of the enclosing scope as one `phase` sample
+#define VOVP_METRICS_SCOPE(metrics, phase)                                     \
+  ::vovp::ScopedPhaseTimer VOVP_METRICS_CONCAT(vovp_phase_timer_, __LINE__)(   \
+      (metrics), ::vovp::Phase::phase)
+#define VOVP_METRICS_ADD_BYTES(metrics, device, bytes)                         \
+  (metrics)->AddCopiedBytes((device), (bytes))
+// Count the page faults taken in the rest of the enclosing scope
+#define VOVP_METRICS_PAGE_FAULTS(metrics, phase)                               \
+  ::vovp::ScopedPageFaultCounter VOVP_METRICS_CONCAT(vovp_fault_counter_,      \
+                                                     __LINE__)(                \
+      (metrics), ::vovp::Phase::phase)
+#else
+#define VOVP_METRICS_SCOPE(metrics, phase) ((void)0)
+#define VOVP_METRICS_ADD_BYTES(metrics, device, bytes) ((void)0)
+#define VOVP_METRICS_PAGE_FAULTS(metrics, phase) ((void)0)
+#endif
+
+#endif /* VOVP_METRICS_H */
@@ -1,12 +1,17 @@
 #ifndef VOVP_NDARRAY_UTILS_H
 #define VOVP_NDARRAY_UTILS_H
 
+#include "vovp/reclaim_queue.h"
 #include "vovp/utils.h"
+#include <atomic>
 #include <cstdint>
 #include <dlpack/dlpack.h>
 #include <dmlc/logging.h>
+#include <memory>
+#include <mutex>
 #include <plasma/client.h>
 #include <plasma/common.h>
+#include <vector>
 
 namespace vovp {
 using namespace plasma;
@@ -16,68 +21,128 @@ bool IsContiguous(DLManagedTensor *data_);
 void PlasmaTensorCtxNoReleaseDeleter(DLManagedTensor *arg);
 void PlasmaTensorCtxReleaseDeleter(DLManagedTensor *arg);
 
-class BufferDeleter {
-public:
-  BufferDeleter(std::shared_ptr<PlasmaClient> client, ObjectID object_id)
-      : client(client), object_id(object_id){};
-  ~BufferDeleter() {
-
-    ObjectTable table;
-    VOVP_CHECK_ARROW(client->List(&table));
-    // LOG(INFO) << "Table size: " << table.size();
-    // for (const auto &kv : table) {
-    //   LOG(INFO) << "DL Ref: " << kv.first.hex() << ": " << kv.second->ref_count;
-    // }
-    // auto status = owner->plasma_client->Delete(owner->object_id);
-    // LOG(INFO) << "Delete: " << owner->object_id.hex();
-    // check_arrow_status(status);
-    // LOG(INFO) << "buf Delete: " << object_id.hex();
-    VOVP_CHECK_ARROW(client->Delete(object_id));
-  };
+class PlasmaTensorCtxPool;
+
+// Shared between the manager and the writable view of an object created
+// without sealing. Plasma only allows Abort while the creating client holds
+// exactly the creation reference, so that reference is given up by whichever
+// comes last of Seal and the view being freed, and never after Abort.
+struct UnsealedObject {
+  enum State { kUnsealed, kSealed, kAborted };
+
+  std::mutex mutex;
+  State state = kUnsealed;
+  // Connection that created the object, Seal and Abort must come from it
   std::shared_ptr<PlasmaClient> client;
-  ObjectID object_id;
+  bool view_alive = true;
+
+  // Called when the view is freed. Returns whether the view should release
+  // the creation reference itself.
+  bool ReleaseView() {
+    std::lock_guard<std::mutex> lock(mutex);
+    view_alive = false;
+    return state == kSealed;
+  }
 };
 
 typedef struct PlasmaTensorCtx {
+  // Tensors with at most this many dims keep shape and strides inline
+  static constexpr int kInlineDims = 6;
+
   std::shared_ptr<PlasmaClient> plasma_client;
-  // To be executed after destruction of buffer and before
-  // destruction of PlasmaClient
-  std::unique_ptr<BufferDeleter> buffer_deleter;
   std::shared_ptr<Buffer> buffer;
   ObjectID object_id;
+  // Delete the object after the buffer is dropped and before the client is
+  bool try_delete_when_destruct = false;
+  // Queue for the release/delete on destruction, null to issue them inline
+  std::shared_ptr<ReclaimQueue> reclaimer;
+  // Set for views of objects created without sealing
+  std::shared_ptr<UnsealedObject> unsealed;
+  // Pool to return this context to, null if it was allocated on its own
+  std::shared_ptr<PlasmaTensorCtxPool> pool;
+  // Counted in the pool's LiveStats
+  bool tracked = false;
+  // The view's reference was given up early by ReleaseReference
+  bool released = false;
+  int64_t data_size = 0;
+  int64_t inline_shape[kInlineDims];
+  int64_t inline_strides[kInlineDims];
   std::vector<int64_t> shape;
   std::vector<int64_t> strides;
 
   DLManagedTensor tensor;
 
-  PlasmaTensorCtx(std::shared_ptr<Buffer> buffer,
-                  std::shared_ptr<PlasmaClient> plasma_client,
-                  ObjectID object_id, bool release_when_destruct,
-                  bool try_delete_when_destruct)
-      : buffer(buffer), plasma_client(plasma_client), object_id(object_id) {
-    if (try_delete_when_destruct) {
-      buffer_deleter = std::unique_ptr<BufferDeleter>(
-          new BufferDeleter(plasma_client, object_id));
-    }
-    tensor.manager_ctx = this;
-    tensor.dl_tensor.dtype.lanes = 1;
-    if (release_when_destruct) {
-      tensor.deleter = &PlasmaTensorCtxReleaseDeleter;
-    } else {
-      tensor.deleter = &PlasmaTensorCtxNoReleaseDeleter;
-    }
-  }
+  PlasmaTensorCtx() { tensor.manager_ctx = this; }
+
+  void Init(std::shared_ptr<Buffer> buffer,
+            std::shared_ptr<PlasmaClient> plasma_client, ObjectID object_id,
+            bool release_when_destruct, bool try_delete_when_destruct,
+            const std::shared_ptr<ReclaimQueue> &reclaimer = nullptr);
+  // Point the tensor shape and strides at storage for `ndim` dims
+  void SetNDim(int ndim);
+  // Fill row-major strides from the current shape
+  void SetContiguousStrides();
+  // Give up the view's reference on the object now, on the connection that
+  // took it, instead of when the view is freed. Returns false if it was
+  // already released.
+  bool ReleaseReference();
+  // Drop the buffer and client references, deleting the object if requested
+  void Reset();
 } PlasmaTensorCtx;
 
+// Free list of PlasmaTensorCtx so that the get path does not hit malloc.
+// Contexts may be returned from any thread.
+class PlasmaTensorCtxPool
+    : public std::enable_shared_from_this<PlasmaTensorCtxPool> {
+public:
+  explicit PlasmaTensorCtxPool(size_t capacity = 1024) : capacity(capacity) {
+    free_list.reserve(capacity);
+  }
+  ~PlasmaTensorCtxPool();
+
+  PlasmaTensorCtx *Acquire();
+  void Put(PlasmaTensorCtx *ctx);
+
+  // Count a fully initialized context in LiveStats until Untrack. Only
+  // counters are updated, so the get path stays free of allocations.
+  void Track(PlasmaTensorCtx *ctx);
+  // Called before the context is reset
+  void Untrack(PlasmaTensorCtx *ctx);
+  // Number and total data size of the tracked, not yet freed tensors
+  void LiveStats(int64_t *count, int64_t *bytes);
+
+private:
+  std::mutex mutex;
+  std::vector<PlasmaTensorCtx *> free_list;
+  size_t capacity;
+  std::atomic<int64_t> live_count{0};
+  std::atomic<int64_t> live_bytes{0};
+};
+
+PlasmaTensorCtx *
+NewPlasmaTensorCtx(const std::shared_ptr<PlasmaTensorCtxPool> &pool);
+void FreePlasmaTensorCtx(PlasmaTensorCtx *ctx);
+
 DLManagedTensor *GetPlasmaBufferToDlpack(std::shared_ptr<Buffer> buffer,
                                          std::shared_ptr<Buffer> metadatabuffer,
                                          std::shared_ptr<PlasmaClient> client,
-                                         ObjectID object_id);
+                                         ObjectID object_id,
+                                         bool try_delete_when_destruct = true,
+                                         const std::shared_ptr<PlasmaTensorCtxPool>
+                                             &pool = nullptr,
+                                         const std::shared_ptr<ReclaimQueue>
+                                             &reclaimer = nullptr);
 
 DLManagedTensor *CreatePlasmaBufferToDlpack(
     DLManagedTensor *dlm_tensor, std::shared_ptr<Buffer> buffer,
     std::shared_ptr<PlasmaClient> client, ObjectID object_id,
-    bool try_delete_when_destruct);
+    bool try_delete_when_destruct,
+    const std::shared_ptr<PlasmaTensorCtxPool> &pool = nullptr,
+    const std::shared_ptr<ReclaimQueue> &reclaimer = nullptr);
+
+// Dense CPU tensor in private, 64-byte aligned memory, freed by its deleter
+DLManagedTensor *NewHostTensor(const int64_t *shape, int ndim,
+                               DLDataType dtype);
 
 void *GetPointerFromBuffer(std::shared_ptr<Buffer> buffer,
                            DLDeviceType device);
@@ -0,0 +1,57 @@
+#ifndef VOVP_OBJECT_CACHE_H
+#define VOVP_OBJECT_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <plasma/client.h>
+#include <plasma/common.h>
+#include <unordered_map>
+
+namespace vovp {
+using namespace plasma;
+
+// In-process cache of objects this client already has mapped. Entries only
+// hold a weak reference to the data buffer, so an object stays cached exactly
+// as long as some tensor handed out for it is alive; the cache itself never
+// keeps an object pinned in the store. Only CPU objects are cached.
+class ObjectCache {
+public:
+  // Look up a live mapping of `object_id`, counting a hit or a miss.
+  bool Lookup(const ObjectID &object_id, std::shared_ptr<Buffer> *data,
+              std::shared_ptr<Buffer> *metadata);
+  // Remember the buffers returned by a Get. The metadata is copied since
+  // plasma does not keep it alive.
+  void Insert(const ObjectID &object_id, const std::shared_ptr<Buffer> &data,
+              const std::shared_ptr<Buffer> &metadata);
+  // Forget `object_id`, e.g. because it is being deleted or re-put
+  void Erase(const ObjectID &object_id);
+  void Clear();
+
+  void SetEnabled(bool enabled);
+  bool enabled() const { return enabled_; }
+  int64_t hits() const { return hits_; }
+  int64_t misses() const { return misses_; }
+  size_t size();
+  void ResetCounters();
+
+private:
+  struct Entry {
+    std::weak_ptr<Buffer> data;
+    std::shared_ptr<Buffer> metadata;
+  };
+  // Drop entries whose tensors have all been freed. Called with mutex held.
+  void SweepExpired();
+
+  std::mutex mutex;
+  std::unordered_map<ObjectID, Entry> entries;
+  size_t next_sweep_size = 64;
+  std::atomic<bool> enabled_{true};
+  std::atomic<int64_t> hits_{0};
+  std::atomic<int64_t> misses_{0};
+};
+
+} // namespace vovp
+
+#endif /* VOVP_OBJECT_CACHE_H */
@@ -0,0 +1,59 @@
+#ifndef VOVP_OBJECT_VERSION_H
+#define VOVP_OBJECT_VERSION_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace vovp {
+
+// "VOVR" in little endian
+static constexpr uint32_t kObjectVersionMagic = 0x52564f56;
+
+// Seqlock stored after the tensor data of objects that can be updated in
+// place. The data buffer of such an object is the tensor bytes padded to 64,
+// then this trailer, so the tensor view is unchanged and plain objects,
+// whose buffer is exactly the tensor bytes, are never mistaken for one.
+//
+// The sequence is odd while a writer is copying into the object. A reader
+// that sees the same even sequence before and after its read got a
+// consistent copy.
+struct ObjectVersion {
+  uint32_t magic;
+  uint32_t reserved;
+  std::atomic<uint64_t> sequence;
+  uint8_t padding[48];
+};
+static_assert(sizeof(ObjectVersion) == 64, "ObjectVersion layout changed");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+              "The sequence is shared between processes");
+
+inline int64_t ObjectVersionOffset(int64_t data_size) {
+  return (data_size + 63) / 64 * 64;
+}
+
+// Size of the data buffer of a versioned object holding `data_size` bytes
+inline int64_t VersionedObjectSize(int64_t data_size) {
+  return ObjectVersionOffset(data_size) + sizeof(ObjectVersion);
+}
+
+// Initialize the trailer of a new versioned object before it is sealed
+ObjectVersion *InitObjectVersion(uint8_t *buffer, int64_t data_size);
+
+// The trailer of a buffer of `buffer_size` bytes holding a tensor of
+// `data_size` bytes, or null if the object is not versioned
+ObjectVersion *FindObjectVersion(const uint8_t *buffer, int64_t buffer_size,
+                                 int64_t data_size);
+
+// Make the sequence odd, waiting for a concurrent writer to finish. Returns
+// the sequence to pass to EndObjectWrite.
+uint64_t BeginObjectWrite(ObjectVersion *version);
+void EndObjectWrite(ObjectVersion *version, uint64_t sequence);
+
+// Copy `size` bytes of the object at `src` to `dst`, retrying until no write
+// overlapped the copy. Returns the (even) sequence the copy corresponds to.
+uint64_t ReadObjectConsistent(const ObjectVersion *version, void *dst,
+                              const void *src, int64_t size);
+
+} // namespace vovp
+
+#endif /* VOVP_OBJECT_VERSION_H */
@@ -1,7 +1,9 @@
 #ifndef VOVP_PLASMA_MANAGER_H
 #define VOVP_PLASMA_MANAGER_H
 #include <arrow/io/memory.h>
+#include <atomic>
 #include <dlpack/dlpack.h>
+#include <future>
 #include <dmlc/base.h>
 #include <dmlc/io.h>
 #include <dmlc/logging.h>
@@ -9,9 +11,27 @@
 #include <memory>
 #include <plasma/client.h>
 #include <plasma/common.h>
+#include <mutex>
 #include <random>
+#include <unordered_map>
+#include <vector>
+#include <vovp/async_worker.h>
+#include <vovp/bundle.h>
+#include <vovp/compression.h>
+#include <vovp/connection_pool.h>
+#include <vovp/dedup.h>
+#include <vovp/metrics.h>
 #include <vovp/ndarray_utils.h>
+#include <vovp/object_cache.h>
+#include <vovp/object_version.h>
+#include <vovp/reclaim_queue.h>
+#include <vovp/seal_notifier.h>
 #include <vovp/serializer.h>
+#include <vovp/snapshot.h>
+#include <vovp/sparse.h>
+#include <vovp/tensor_channel.h>
+#include <vovp/spill_store.h>
+#include <vovp/store_router.h>
 #include <vovp/utils.h>
 
 namespace vovp {
@@ -21,22 +41,321 @@ using namespace plasma;
 ObjectID random_object_id();
 class VovpPlasmaManager {
 public:
-  VovpPlasmaManager(std::string socket_name);
+  // Requests are spread over `num_connections` independent connections, so
+  // concurrent threads do not serialize on one socket
+  static constexpr int kDefaultConnections = 4;
+  VovpPlasmaManager(std::string socket_name,
+                    int num_connections = kDefaultConnections);
+  // One store per NUMA node: `nodes[i]` is the node whose memory the store
+  // at `socket_names[i]` uses, the i-th node by default. Objects are routed
+  // between the stores by a StoreRouter. Spilling is not available, and
+  // snapshots and channels use the first store.
+  VovpPlasmaManager(const std::vector<std::string> &socket_names,
+                    const std::vector<int> &nodes,
+                    int num_connections = kDefaultConnections);
   
   DLManagedTensor *PutDlpackTensor(DLManagedTensor *dlm_tensor,
                                    ObjectID &object_id,
                                    bool try_delete_when_destruct = false,
                                    bool try_delete_before_create = true);
 
-  DLManagedTensor *GetDlpackTensor(ObjectID &object_id);
+  // Put that stores identical contents once. The CPU tensor is hashed
+  // first; if a sealed object already holds the same dtype, shape and bytes,
+  // `object_id` becomes an alias of it and nothing is copied. Otherwise the
+  // data is stored under an ID derived from the hash, which every client
+  // finds, and `object_id` aliases that. The returned view holds its own
+  // reference on the shared object. Aliases are counted in a side object:
+  // deleting or overwriting one leaves the data to the others, and the last
+  // one deletes the shared object. Deletes made by clients that never made
+  // or read an alias, other than through Delete, are not counted. GPU and
+  // non-contiguous tensors get a plain put.
+  DLManagedTensor *PutDedupTensor(DLManagedTensor *dlm_tensor,
+                                  ObjectID &object_id,
+                                  bool try_delete_before_create = true);
 
-  DLManagedTensor *CreateTensor(ObjectID &object_id, int64_t *shape, int ndim, DLDataType dtype,
-                                  DLContext ctx);
+  // Waits up to `timeout_ms` (-1 for ever) for the object to be sealed and
+  // throws ObjectTimeoutError if it is not. Unless `try_delete_when_destruct`
+  // is false, freeing the view deletes the object, as for put views.
+  DLManagedTensor *GetDlpackTensor(ObjectID &object_id,
+                                   int64_t timeout_ms = 1000,
+                                   bool try_delete_when_destruct = true);
 
-  void Release(ObjectID &object_id);
+  // Wait up to `timeout_ms` (-1 for ever) for one of `object_ids` to be
+  // sealed, or spilled, and return its index, -1 on timeout. Waiters are
+  // woken by the store's seal notifications.
+  int WaitAny(const std::vector<ObjectID> &object_ids, int64_t timeout_ms);
+  bool WaitTensor(const ObjectID &object_id, int64_t timeout_ms);
 
+  // Re-put of a CPU tensor that overwrites the existing object in place when
+  // its dtype and shape are unchanged, so the allocation and the mappings of
+  // readers stay valid. Otherwise the object is replaced, as with a put, by
+  // one that carries an ObjectVersion seqlock for later updates. GPU tensors
+  // are always replaced. `in_place` is set to whether the object was reused.
+  DLManagedTensor *UpdateDlpackTensor(DLManagedTensor *dlm_tensor,
+                                      ObjectID &object_id,
+                                      bool *in_place = nullptr);
+  // Private host copy of a stored CPU tensor that no update tore. `version`
+  // is set to the update sequence the copy matches, 0 if not versioned.
+  DLManagedTensor *ReadDlpackTensor(ObjectID &object_id, uint64_t *version);
+  // Current update sequence of an object, -1 if it is not versioned. It is
+  // odd while an update is in progress and grows by 2 per update.
+  int64_t TensorVersion(ObjectID &object_id);
+
+  // Batched variants: objects are deleted and fetched with one store request
+  // per batch, and small CPU tensors are created and sealed together.
+  std::vector<DLManagedTensor *>
+  PutDlpackTensors(std::vector<DLManagedTensor *> &dlm_tensors,
+                   std::vector<ObjectID> &object_ids,
+                   bool try_delete_when_destruct = false,
+                   bool try_delete_before_create = true);
+
+  std::vector<DLManagedTensor *>
+  GetDlpackTensors(std::vector<ObjectID> &object_ids,
+                   int64_t timeout_ms = 1000);
+
+  // Store named CPU tensors as a single object: one allocation and one seal,
+  // members at cache-line aligned offsets described by a BundleHeader.
+  void PutBundle(ObjectID &object_id, const std::vector<std::string> &names,
+                 const std::vector<DLManagedTensor *> &tensors,
+                 bool try_delete_before_create = true);
+  // Zero-copy views of the members of a bundle, in the order they were put.
+  // The views share the object's single store reference, which is released
+  // with the last of them.
+  std::vector<std::pair<std::string, DLManagedTensor *>>
+  GetBundle(ObjectID &object_id);
+
+  // Store a CPU tensor compressed with `codec` ("lz4" or "zstd") in blocks
+  // of `block_size` bytes, compressed in parallel. Gets of the object
+  // return a private decompressed copy.
+  void PutCompressedTensor(DLManagedTensor *dlm_tensor, ObjectID &object_id,
+                           const std::string &codec = "lz4",
+                           int64_t block_size = kDefaultCompressionBlock,
+                           bool try_delete_before_create = true);
+  // Private host copy of the rows [start, stop) of a stored CPU tensor. Of a
+  // compressed tensor only the blocks holding those rows are decompressed.
+  DLManagedTensor *ReadTensorRows(ObjectID &object_id, int64_t start,
+                                  int64_t stop);
+  // Fill `header` and `compressed_size` and return true if the object is a
+  // compressed tensor
+  bool CompressionInfo(ObjectID &object_id, CompressedHeader *header,
+                       int64_t *compressed_size);
+
+  // Store a `num_rows` x `num_cols` sparse matrix from 1-D CPU arrays:
+  // `first` and `second` are indptr and indices for CSR, row and col for
+  // COO, and `values` may be null. Index arrays are checked and stored as
+  // int32 when their values fit. With `delta_encode`, the indices of a CSR
+  // matrix whose rows are sorted are stored as differences within each row
+  // when that makes them narrower.
+  void PutSparse(ObjectID &object_id, SparseFormat format, int64_t num_rows,
+                 int64_t num_cols, DLManagedTensor *first,
+                 DLManagedTensor *second, DLManagedTensor *values,
+                 bool delta_encode = false,
+                 bool try_delete_before_create = true);
+  // Arrays of a sparse matrix by name, with its header. They are zero-copy
+  // views sharing the object's store reference, as with GetBundle, except
+  // delta encoded indices which are decoded into a private tensor.
+  std::vector<std::pair<std::string, DLManagedTensor *>>
+  GetSparse(ObjectID &object_id, SparseHeader *header);
+  // Store the transpose of the CSR matrix `object_id`, that is its CSC
+  // form, as the CSR matrix `out_object_id`, built in parallel from the
+  // mapped arrays. Without values, the data of the transpose is the
+  // position of each entry in the source.
+  void TransposeSparse(ObjectID &object_id, ObjectID &out_object_id,
+                       bool try_delete_before_create = true);
+  // Private host CSR arrays of the rows `rows` (1-D integer CPU tensor) of
+  // a CSR matrix, gathered in parallel from the mapped arrays
+  std::vector<std::pair<std::string, DLManagedTensor *>>
+  SliceSparseRows(ObjectID &object_id, DLManagedTensor *rows);
+
+  // With `seal` false the returned tensor is a writable view of an unsealed
+  // object: readers block in Get until Seal is called, and Abort discards
+  // the object. The view must not be used after Abort.
+  DLManagedTensor *CreateTensor(ObjectID &object_id, int64_t *shape, int ndim,
+                                DLDataType dtype, DLContext ctx,
+                                bool seal = true);
+  void Seal(ObjectID &object_id);
+  void Abort(ObjectID &object_id);
+
+  // Give up the reference a view returned by this client holds on its
+  // object, on the connection that took it, before the view is freed. The
+  // view's data must not be used afterwards. Throws std::invalid_argument
+  // if the tensor is not such a view or was already released.
+  void Release(DLManagedTensor *dlm_tensor);
+  // Delete now, or once the last reference is released if it is in use
+  void Delete(ObjectID &object_id);
+
+  // Gather the rows `index` (1-D int32/int64 CPU tensor) of the stored CPU
+  // tensor `object_id` straight from the mapped buffer. The result is
+  // written to `out` if given, in which case null is returned; otherwise it
+  // becomes the sealed store object `out_object_id` if given, or a private
+  // host tensor.
+  DLManagedTensor *GatherRows(ObjectID &object_id, DLManagedTensor *index,
+                              DLManagedTensor *out = nullptr,
+                              ObjectID *out_object_id = nullptr);
+
+  // Run the put/get on the async worker threads. For puts, `dlm_tensor` must
+  // stay alive until the future is ready.
+  std::future<DLManagedTensor *>
+  PutDlpackTensorAsync(DLManagedTensor *dlm_tensor, ObjectID object_id,
+                       bool try_delete_when_destruct = false,
+                       bool try_delete_before_create = true);
+  std::future<DLManagedTensor *> GetDlpackTensorAsync(ObjectID object_id);
+  void SetAsyncThreads(int num_threads);
+
+  // Spill cold objects to files in `directory` instead of failing when the
+  // store is full, see SpillStore. Call before the manager is shared
+  // between threads.
+  void EnableSpill(const std::string &directory);
+  // Start restoring spilled objects in the background ahead of their gets
+  void Prefetch(const std::vector<ObjectID> &object_ids);
+  // Keep an object in the store even when it is cold
+  void Pin(const ObjectID &object_id);
+  void Unpin(const ObjectID &object_id);
+
+  // Write the sealed CPU objects `object_ids`, or all of them if empty, with
+  // their tensor headers to the snapshot file `path`. Returns the number of
+  // objects written.
+  int64_t Snapshot(const std::string &path,
+                   const std::vector<ObjectID> &object_ids);
+  // Load the objects of a snapshot into the store, skipping existing ones.
+  // Returns the number of objects restored.
+  int64_t Restore(const std::string &path, bool use_mmap = false);
+
+  // Open the channel stored as `object_id`, creating it with `num_slots`
+  // slots of `slot_bytes` each if it does not exist yet. An existing channel
+  // keeps its own shape. Waits up to `timeout_ms` for a channel another
+  // process is creating.
+  std::shared_ptr<TensorChannel> OpenChannel(ObjectID &object_id,
+                                             int64_t num_slots,
+                                             int64_t slot_bytes,
+                                             int64_t timeout_ms = 10000);
+
+  // Place the objects created afterwards as `placement` says, unless the
+  // creating thread set a node hint
+  void SetPlacement(Placement placement);
+  // Create the objects of the calling thread on the store of `node`, -1 to
+  // follow the placement policy
+  void SetNodeHint(int node);
+  // Copy an object to every store that does not hold it yet, so that
+  // readers on every node map local memory. Returns the number of copies
+  // made. An update or put of the object replaces all of its copies.
+  int Replicate(ObjectID &object_id);
+  // NUMA nodes of the stores known to hold the object
+  std::vector<int> ObjectNodes(const ObjectID &object_id);
+  int NumStores() const { return router ? router->size() : 1; }
+
+  // Send the releases and deletes queued by destroyed tensors to the store
+  void Flush();
+  void SetReclaimOptions(size_t flush_threshold, int64_t flush_interval_ms);
+
+  std::shared_ptr<ConnectionPool> connections;
+  // Primary connection and its reclaim queue, for requests that are not
+  // tied to an object reference such as List
   std::shared_ptr<PlasmaClient> client;
+  std::shared_ptr<ReclaimQueue> reclaimer;
+  // Recycles the DLPack contexts handed out by this manager
+  std::shared_ptr<PlasmaTensorCtxPool> ctx_pool;
+  // Live mappings of objects fetched by this process
+  ObjectCache object_cache;
+  // Per-phase latencies and copied bytes, shared with the reclaim queues
+  std::shared_ptr<Metrics> metrics;
+  // Disk tier, null unless EnableSpill was called
+  std::shared_ptr<SpillStore> spill;
+  // Null with a single store, in which case `connections` is that store.
+  // Otherwise `connections` is the first store.
+  std::shared_ptr<StoreRouter> router;
   ObjectID tmp_object_id;
+
+private:
+  std::shared_ptr<UnsealedObject> TakeUnsealed(ObjectID &object_id);
+  // PutDlpackTensor, optionally appending an ObjectVersion to the data. With
+  // `existed` given, an existing object is not an error: it is reported
+  // there and null is returned.
+  DLManagedTensor *PutTensorObject(DLManagedTensor *dlm_tensor,
+                                   ObjectID &object_id,
+                                   bool try_delete_when_destruct,
+                                   bool try_delete_before_create,
+                                   bool versioned, bool *existed = nullptr);
+  // Store a new object goes to. With `replace`, copies of the object on
+  // other stores are deleted.
+  ConnectionPool &PlaceObject(const ObjectID &object_id, bool replace);
+  // Store holding the object, the nearest one if several do. With several
+  // stores, waits up to `timeout_ms` for the object to appear on one and
+  // throws ObjectTimeoutError if it does not; with a timeout of 0 the
+  // nearest store is returned instead.
+  ConnectionPool &FindObject(const ObjectID &object_id,
+                             int64_t timeout_ms = 1000);
+  // Store the small contiguous CPU tensors at `batch_index` in one request,
+  // setting their views in `results` and marking them in `stored`
+  void PutBatch(ConnectionPool &store,
+                std::vector<DLManagedTensor *> &dlm_tensors,
+                std::vector<ObjectID> &object_ids,
+                const std::vector<size_t> &batch_index,
+                bool try_delete_when_destruct,
+                std::vector<DLManagedTensor *> *results,
+                std::vector<bool> *stored);
+  std::vector<DLManagedTensor *>
+  GetDlpackTensorsFrom(ConnectionPool &store,
+                       std::vector<ObjectID> &object_ids, int64_t timeout_ms);
+  // View of the shared object `shared_id` if it holds `header` and the
+  // `size` bytes at `src`. Sets `collision` if it holds something else.
+  DLManagedTensor *GetDedupTensor(ObjectID &shared_id,
+                                  const std::string &header, const void *src,
+                                  int64_t size, int64_t timeout_ms,
+                                  bool *collision);
+  // Replace the buffers of an alias by those of the object it stands for.
+  // Returns false if that object was deleted or evicted.
+  bool ResolveAlias(PlasmaClient *client, const ObjectID &object_id,
+                    std::shared_ptr<Buffer> *data,
+                    std::shared_ptr<Buffer> *metadata);
+  // Start dropping the alias counts of deleted aliases, once this client
+  // has made or read one
+  void CountAliases();
+  // client->Create, spilling cold objects and retrying if the store is full
+  Status CreateObject(PlasmaClient *client, const ObjectID &object_id,
+                      int64_t data_size, const uint8_t *metadata,
+                      int64_t metadata_size, std::shared_ptr<Buffer> *buffer,
+                      int device_num);
+  // Private host tensor holding the rows [start, stop) of a compressed
+  // object, all of it if `stop` is -1
+  DLManagedTensor *DecompressTensor(const Buffer &data, const Buffer &metadata,
+                                    int64_t start, int64_t stop);
+  // Buffers and header of a sealed sparse matrix, checked against the size
+  // of the data
+  void GetSparseBuffers(PlasmaClient *client, ObjectID &object_id,
+                        std::shared_ptr<Buffer> *data, SparseHeader *header);
+  // Bring back the spilled objects among `object_ids` before a Get
+  void RestoreSpilled(const std::vector<ObjectID> &object_ids);
+  // Buffers of a sealed object, from the object cache when possible. Throws
+  // ObjectTimeoutError if it is not sealed within `timeout_ms`.
+  void GetObjectBuffers(PlasmaClient *client, const ObjectID &object_id,
+                        std::shared_ptr<Buffer> *data,
+                        std::shared_ptr<Buffer> *metadata,
+                        int64_t timeout_ms = 1000);
+  // As GetObjectBuffers, but returns false if the object is not sealed
+  // within `timeout_ms`
+  bool TryGetObjectBuffers(PlasmaClient *client, const ObjectID &object_id,
+                           int64_t timeout_ms, std::shared_ptr<Buffer> *data,
+                           std::shared_ptr<Buffer> *metadata);
+  std::shared_ptr<AsyncWorker> GetAsyncWorker();
+  std::shared_ptr<SealNotifier> GetSealNotifier();
+
+  std::vector<std::string> socket_names;
+  // Started by the first wait for an object that is not sealed yet
+  std::mutex notifier_mutex;
+  std::shared_ptr<SealNotifier> seal_notifier;
+
+  // Started on the first async call
+  std::mutex async_mutex;
+  std::shared_ptr<AsyncWorker> async_worker;
+  int num_async_threads = 2;
+
+  std::once_flag alias_once;
+  std::atomic<bool> count_aliases{false};
+
+  std::mutex unsealed_mutex;
+  std::unordered_map<ObjectID, std::shared_ptr<UnsealedObject>>
+      unsealed_objects;
 };
 } // namespace vovp
 #endif /* VOVP_PLASMA_MANAGER_H */
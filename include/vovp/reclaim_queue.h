@@ -0,0 +1,62 @@
+#ifndef VOVP_RECLAIM_QUEUE_H
+#define VOVP_RECLAIM_QUEUE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vovp/metrics.h>
+#include <mutex>
+#include <plasma/client.h>
+#include <plasma/common.h>
+#include <thread>
+#include <vector>
+
+namespace vovp {
+using namespace plasma;
+
+// Collects Release and Delete requests from tensor destructors and sends them
+// to the store in batches, either from a background thread every
+// `flush_interval_ms` or as soon as `flush_threshold` requests are pending.
+// Enqueueing is O(1) and never talks to the store.
+class ReclaimQueue {
+public:
+  ReclaimQueue(std::shared_ptr<PlasmaClient> client,
+               size_t flush_threshold = 256, int64_t flush_interval_ms = 10,
+               std::shared_ptr<Metrics> metrics = nullptr);
+  ~ReclaimQueue();
+
+  void EnqueueRelease(const ObjectID &object_id);
+  void EnqueueDelete(const ObjectID &object_id);
+  // Send all pending requests now. Releases go first so that the deletes of
+  // the same objects can take effect.
+  void Flush();
+  bool Empty();
+  void SetOptions(size_t flush_threshold, int64_t flush_interval_ms);
+  // Called with each delete of a flush before it is sent
+  using DeleteHook =
+      std::function<void(PlasmaClient *client, const ObjectID &object_id)>;
+  void SetDeleteHook(DeleteHook hook);
+
+private:
+  void Run();
+
+  std::shared_ptr<PlasmaClient> client;
+  std::shared_ptr<Metrics> metrics;
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::vector<ObjectID> pending_releases;
+  std::vector<ObjectID> pending_deletes;
+  DeleteHook delete_hook;
+  size_t flush_threshold;
+  int64_t flush_interval_ms;
+  bool stopped = false;
+  // Serializes flushes so a Flush() returns only after earlier requests
+  // taken by the background thread have reached the store too
+  std::mutex flush_mutex;
+  std::thread worker;
+};
+
+} // namespace vovp
+
+#endif /* VOVP_RECLAIM_QUEUE_H */
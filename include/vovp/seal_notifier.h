@@ -0,0 +1,59 @@
+#ifndef VOVP_SEAL_NOTIFIER_H
+#define VOVP_SEAL_NOTIFIER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <plasma/client.h>
+#include <plasma/common.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vovp {
+using namespace plasma;
+
+// Wakes threads waiting for objects to be sealed. A dedicated connection
+// subscribes to the store's seal notifications and a background thread
+// hands each one to the waiters interested in that object, so a waiter is
+// woken as soon as the store has sealed its object without polling and
+// without occupying one of the request connections.
+class SealNotifier {
+public:
+  explicit SealNotifier(const std::string &socket_name);
+  // Notifications of several stores, e.g. one per NUMA node
+  explicit SealNotifier(const std::vector<std::string> &socket_names);
+  ~SealNotifier();
+
+  // Wait up to `timeout_ms` (-1 for ever) for one of `object_ids` to be
+  // sealed and return its index, or -1 on timeout. `poll` returns the index
+  // of an object that is already sealed, or -1; it is called once the
+  // waiter is registered so that no seal can be missed.
+  int WaitAny(const std::vector<ObjectID> &object_ids, int64_t timeout_ms,
+              const std::function<int()> &poll);
+
+private:
+  struct Waiter {
+    const std::vector<ObjectID> *object_ids;
+    int found = -1;
+    std::condition_variable cv;
+  };
+
+  void Run();
+
+  std::vector<std::shared_ptr<PlasmaClient>> clients;
+  std::vector<int> notification_fds;
+
+  std::mutex mutex;
+  std::list<Waiter *> waiters;
+  // Set when the subscription ends, waits then poll with a backoff
+  bool stopped = false;
+  std::thread thread;
+};
+
+} // namespace vovp
+
+#endif /* VOVP_SEAL_NOTIFIER_H */
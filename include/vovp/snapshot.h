@@ -0,0 +1,74 @@
+#ifndef VOVP_SNAPSHOT_H
+#define VOVP_SNAPSHOT_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <plasma/client.h>
+#include <plasma/common.h>
+#include <string>
+#include <vector>
+
+namespace vovp {
+using namespace plasma;
+
+// Snapshot container: a 4 KiB header page, an index of fixed-size entries,
+// the packed metadata of all objects, then the data of every object at a
+// 4 KiB aligned offset. Data can therefore be read with large aligned I/O,
+// or mapped and used in place.
+static constexpr uint32_t kSnapshotMagic = 0x504e5356; // "VSNP"
+static constexpr uint32_t kSnapshotVersion = 1;
+static constexpr int64_t kSnapshotAlign = 4096;
+
+struct SnapshotHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t num_objects;
+  // Offset of the SnapshotEntry array
+  uint64_t index_offset;
+  uint64_t file_size;
+};
+
+struct SnapshotEntry {
+  uint8_t object_id[kUniqueIDSize];
+  uint32_t reserved;
+  int64_t metadata_offset;
+  int64_t metadata_size;
+  int64_t data_offset;
+  int64_t data_size;
+  uint8_t padding[8];
+};
+static_assert(sizeof(SnapshotEntry) == 64, "SnapshotEntry layout changed");
+
+struct SnapshotOptions {
+  // Threads issuing reads and writes
+  int num_threads = 8;
+  // Bytes per read or write request
+  int64_t chunk_bytes = 8 << 20;
+  // Objects are fetched or created in groups of about this many bytes, which
+  // bounds the store references held at once
+  int64_t batch_bytes = 1LL << 30;
+  // Restore by copying from a mapping of the file instead of reading it
+  bool use_mmap = false;
+};
+
+// Creates an object for a restore, e.g. with spilling on a full store
+using SnapshotCreateFn = std::function<Status(
+    const ObjectID &object_id, int64_t data_size, const uint8_t *metadata,
+    int64_t metadata_size, std::shared_ptr<Buffer> *buffer)>;
+
+// Write the sealed CPU objects `object_ids` to `path`. Objects that are not
+// in the store are skipped. Returns the number of objects written.
+int64_t WriteSnapshot(PlasmaClient *client, const std::string &path,
+                      const std::vector<ObjectID> &object_ids,
+                      const SnapshotOptions &options);
+
+// Create and seal every object of the snapshot at `path`, skipping objects
+// that already exist. Returns the number of objects restored.
+int64_t ReadSnapshot(PlasmaClient *client, const std::string &path,
+                     const SnapshotCreateFn &create,
+                     const SnapshotOptions &options);
+
+} // namespace vovp
+
+#endif /* VOVP_SNAPSHOT_H */
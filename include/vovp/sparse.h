@@ -0,0 +1,117 @@
+#ifndef VOVP_SPARSE_H
+#define VOVP_SPARSE_H
+
+#include <cstdint>
+#include <dlpack/dlpack.h>
+#include <string>
+#include <vector>
+
+namespace vovp {
+
+// "VSPR" in little endian, distinct from kTensorHeaderMagic
+static constexpr uint32_t kSparseMagic = 0x52505356;
+static constexpr uint16_t kSparseVersion = 1;
+static constexpr int kMaxSparseArrays = 3;
+// Arrays start on their own cache line
+static constexpr int64_t kSparseAlign = 64;
+
+enum class SparseFormat : uint8_t { kCSR = 0, kCOO = 1 };
+
+enum SparseEncoding : uint32_t {
+  kSparsePlain = 0,
+  // Each CSR row holds its first column, then the differences between
+  // consecutive columns of the row
+  kSparseRowDelta = 1,
+};
+
+struct SparseArray {
+  // Location of the array in the data buffer
+  uint64_t offset;
+  uint64_t length;
+  // Type of the stored elements
+  DLDataType dtype;
+  uint32_t encoding;
+};
+static_assert(sizeof(SparseArray) == 24, "SparseArray layout changed");
+
+// Metadata of an object holding a sparse matrix. CSR objects hold indptr,
+// indices and optionally data; COO objects row, col and optionally data.
+// Index arrays are stored as int32 whenever their values fit.
+struct SparseHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint8_t format;
+  uint8_t num_arrays;
+  int64_t num_rows;
+  int64_t num_cols;
+  int64_t nnz;
+  SparseArray arrays[kMaxSparseArrays];
+};
+static_assert(sizeof(SparseHeader) == 104, "SparseHeader layout changed");
+
+// "indptr", "indices", "data" for CSR and "row", "col", "data" for COO
+const char *SparseArrayName(SparseFormat format, int index);
+
+// Encode the metadata of a sparse matrix whose `arrays` have their length,
+// dtype and encoding set. Their offsets are assigned here, cache-line
+// aligned in that order, and `data_size` receives the size of the data
+// buffer.
+std::string EncodeSparseHeader(SparseFormat format, int64_t num_rows,
+                               int64_t num_cols, int64_t nnz,
+                               std::vector<SparseArray> *arrays,
+                               int64_t *data_size);
+// Returns false if `data` is not sparse metadata
+bool DecodeSparseHeader(const uint8_t *data, int64_t size,
+                        SparseHeader *header);
+bool IsSparseHeader(const uint8_t *data, int64_t size);
+
+// A 1-D array in memory
+struct ArrayRef {
+  void *data;
+  DLDataType dtype;
+  int64_t length;
+};
+
+DLDataType IntType(int bits);
+// int32 if `max_value` fits, else int64
+DLDataType NarrowIndexType(int64_t max_value);
+
+// The kernels below run on the copy engine threads. Index arrays may be of
+// any signed integer width.
+
+// Smallest and largest value, false if the array is empty
+bool IndexRange(const ArrayRef &array, int64_t *min, int64_t *max);
+bool IsNonDecreasing(const ArrayRef &array);
+// Copy `src` into `dst`, converting the index type
+void ConvertIndices(const ArrayRef &src, const ArrayRef &dst);
+
+// Type of the narrowest kSparseRowDelta encoding of `indices`, or a type
+// with 0 bits if a row is not sorted
+DLDataType RowDeltaType(const ArrayRef &indptr, const ArrayRef &indices);
+void EncodeRowDelta(const ArrayRef &indptr, const ArrayRef &indices,
+                    const ArrayRef &deltas);
+void DecodeRowDelta(const ArrayRef &indptr, const ArrayRef &deltas,
+                    const ArrayRef &indices);
+
+// CSR of the transpose of a `num_rows` x `num_cols` CSR matrix, that is its
+// CSC form. Rows of the result are sorted. `out_data` receives `data`
+// permuted, or the position of each entry in the input if `data` is null.
+void TransposeCSR(int64_t num_rows, int64_t num_cols, const ArrayRef &indptr,
+                  const ArrayRef &indices, const ArrayRef *data,
+                  const ArrayRef &out_indptr, const ArrayRef &out_indices,
+                  const ArrayRef &out_data);
+
+// Offsets of the slices of `rows` (an index array) of a CSR matrix:
+// `out_indptr` gets rows.length + 1 entries.
+void SliceRowsIndptr(const ArrayRef &indptr, const ArrayRef &rows,
+                     std::vector<int64_t> *out_indptr);
+// Gather the entries of `rows`. `indices` is decoded on the fly if it is
+// kSparseRowDelta encoded. `data` and `out_data` may be null.
+void SliceRows(const ArrayRef &indptr, const ArrayRef &indices,
+               uint32_t encoding, const ArrayRef *data, const ArrayRef &rows,
+               const std::vector<int64_t> &out_indptr,
+               const ArrayRef &out_indices, const ArrayRef *out_data);
+
+} // namespace vovp
+
+#endif /* VOVP_SPARSE_H */
@@ -0,0 +1,90 @@
+#ifndef VOVP_SPILL_STORE_H
+#define VOVP_SPILL_STORE_H
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <plasma/client.h>
+#include <plasma/common.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vovp/async_worker.h>
+#include <vovp/connection_pool.h>
+
+namespace vovp {
+using namespace plasma;
+
+// Disk tier behind the plasma store. When a Create fails because the store
+// is full, cold objects are written to files in `directory` and deleted
+// from the store; a Get of a spilled object restores it first.
+//
+// Only sealed CPU objects that no client references and that are not pinned
+// are spilled, least recently used first. Recency is what this process has
+// seen through Touch; objects it never touched go first, oldest created
+// first. A spilled object is just its file, so processes sharing the
+// directory can restore each other's objects.
+class SpillStore {
+public:
+  SpillStore(const std::string &directory,
+             std::shared_ptr<ConnectionPool> connections);
+
+  // Record an access for the LRU order
+  void Touch(const ObjectID &object_id);
+  // Pinned objects are never spilled
+  void Pin(const ObjectID &object_id);
+  void Unpin(const ObjectID &object_id);
+
+  // Spill until at least `needed` bytes are freed or nothing is left to
+  // spill. Returns the bytes freed.
+  int64_t Evict(int64_t needed);
+
+  // Drop the spill file and access record of an object that is deleted or
+  // created again, so a later restore cannot bring back old contents
+  void Forget(const ObjectID &object_id);
+
+  bool Contains(const ObjectID &object_id) const;
+  // Restore on the background thread. Restores of the same object share one
+  // future; it is ready once the object is back in the store, or if it was
+  // not spilled.
+  std::shared_future<void> RestoreAsync(const ObjectID &object_id);
+
+  const std::string &directory() const { return directory_; }
+  int64_t spilled_objects() const { return spilled_objects_; }
+  int64_t spilled_bytes() const { return spilled_bytes_; }
+  int64_t restored_objects() const { return restored_objects_; }
+  int64_t restored_bytes() const { return restored_bytes_; }
+
+private:
+  std::string PathOf(const ObjectID &object_id) const;
+  // Write the object to its spill file, returns false if it is gone
+  bool Spill(PlasmaClient *client, const ObjectID &object_id);
+  void Restore(const ObjectID &object_id);
+
+  std::string directory_;
+  std::shared_ptr<ConnectionPool> connections;
+
+  std::mutex mutex;
+  uint64_t clock = 0;
+  std::unordered_map<ObjectID, uint64_t> last_access;
+  std::unordered_set<ObjectID> pinned;
+  std::unordered_map<ObjectID, std::shared_future<void>> pending_restores;
+
+  // One eviction at a time, concurrent ones would spill twice the space
+  std::mutex evict_mutex;
+
+  std::atomic<int64_t> spilled_objects_{0};
+  std::atomic<int64_t> spilled_bytes_{0};
+  std::atomic<int64_t> restored_objects_{0};
+  std::atomic<int64_t> restored_bytes_{0};
+
+  // Started on the first restore. Declared last so that queued restores
+  // finish before anything they use is destroyed.
+  std::unique_ptr<AsyncWorker> restore_worker;
+};
+
+} // namespace vovp
+
+#endif /* VOVP_SPILL_STORE_H */
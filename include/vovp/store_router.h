@@ -0,0 +1,109 @@
+#ifndef VOVP_STORE_ROUTER_H
+#define VOVP_STORE_ROUTER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <plasma/common.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vovp/connection_pool.h>
+#include <vovp/metrics.h>
+
+namespace vovp {
+using namespace plasma;
+
+// Objects are tracked in a 64-bit mask of stores
+static constexpr int kMaxStores = 64;
+// Smaller buffers share their pages with other objects, which are bound
+// when those are created
+static constexpr int64_t kNodeBindThreshold = 1 << 16;
+
+enum class Placement : int {
+  // The store on the node of the thread that puts the object
+  kLocal = 0,
+  // Each store in turn, to spread memory bandwidth over all nodes
+  kInterleave = 1,
+};
+
+// Routes objects between stores that each keep their memory on one NUMA
+// node, e.g. one plasma-store-server per socket. New objects go to the store
+// of the node the calling thread hinted, or are placed by the Placement
+// policy. A per-process directory remembers which stores hold a copy of
+// each object; objects put by other processes are looked up in the stores,
+// nearest first, and remembered. The directory is a bounded cache: lookups
+// check the copies it lists and drop those deleted or evicted since.
+class StoreRouter {
+public:
+  // The store at `socket_names[i]` keeps its memory on node `nodes[i]`
+  StoreRouter(const std::vector<std::string> &socket_names,
+              const std::vector<int> &nodes, int num_connections,
+              const std::shared_ptr<Metrics> &metrics);
+
+  size_t size() const { return stores.size(); }
+  const std::shared_ptr<ConnectionPool> &Store(int store) const {
+    return stores[store];
+  }
+
+  void SetPlacement(Placement policy);
+  Placement placement() const {
+    return static_cast<Placement>(policy.load(std::memory_order_relaxed));
+  }
+  // Put the objects created by the calling thread on `node`, -1 to follow
+  // the placement policy again
+  static void SetNodeHint(int node);
+  static int NodeHint();
+  // NUMA node the calling thread runs on, 0 if unknown
+  static int CurrentNode();
+  // Prefer `node` for the pages of [data, data + size) of a store mapping
+  // that are not allocated yet. Store memory is shared, so without this a
+  // page lands on the node of whichever process touches it first.
+  static void BindToNode(void *data, int64_t size, int node);
+
+  // Store for a new object
+  int Place();
+  // Store on the node of the calling thread, or the first one
+  int LocalStore() const;
+
+  // `store` now holds the only copy of the object
+  void Assign(const ObjectID &object_id, int store);
+  void AddCopy(const ObjectID &object_id, int store);
+  void RemoveCopy(const ObjectID &object_id, int store);
+  // Bit i is set if store i holds a copy, 0 if the object is unknown
+  uint64_t Copies(const ObjectID &object_id);
+  void Forget(const ObjectID &object_id);
+  // Store with a sealed copy of the object, the nearest one first, or -1
+  int Locate(const ObjectID &object_id);
+
+private:
+  int StoreOfNode(int node) const;
+  // Whether `store` holds a sealed copy of the object
+  bool Holds(int store, const ObjectID &object_id);
+  // Evict an entry if the directory is full. Called with mutex held.
+  void MakeRoom(const ObjectID &object_id);
+
+  std::vector<std::shared_ptr<ConnectionPool>> stores;
+  std::atomic<int> policy{static_cast<int>(Placement::kLocal)};
+  std::atomic<size_t> next{0};
+
+  std::mutex mutex;
+  std::unordered_map<ObjectID, uint64_t> directory;
+};
+
+// Sets the node hint of the calling thread for its lifetime
+class ScopedNodeHint {
+public:
+  explicit ScopedNodeHint(int node) : saved(StoreRouter::NodeHint()) {
+    StoreRouter::SetNodeHint(node);
+  }
+  ~ScopedNodeHint() { StoreRouter::SetNodeHint(saved); }
+
+private:
+  int saved;
+};
+
+} // namespace vovp
+
+#endif /* VOVP_STORE_ROUTER_H */
@@ -0,0 +1,93 @@
+#ifndef VOVP_TENSOR_CHANNEL_H
+#define VOVP_TENSOR_CHANNEL_H
+
+#include <atomic>
+#include <cstdint>
+#include <dlpack/dlpack.h>
+#include <memory>
+#include <plasma/client.h>
+#include <vovp/metrics.h>
+
+namespace vovp {
+using namespace plasma;
+
+// "VCHN" in little endian
+static constexpr uint32_t kChannelMagic = 0x4e484356;
+static constexpr int kChannelMaxDims = 8;
+
+// Shared state at the start of a channel object. Head and tail sit on their
+// own cache lines so senders and receivers do not contend on one line.
+struct ChannelHeader {
+  uint32_t magic;
+  uint32_t reserved;
+  uint64_t num_slots;
+  // Largest tensor in bytes a slot can hold
+  int64_t slot_bytes;
+  // Distance between slots, a ChannelSlot plus the padded payload
+  int64_t slot_stride;
+  uint8_t padding0[32];
+  // Position of the next send
+  std::atomic<uint64_t> head;
+  uint8_t padding1[56];
+  // Position of the next receive
+  std::atomic<uint64_t> tail;
+  uint8_t padding2[56];
+};
+static_assert(sizeof(ChannelHeader) == 192, "ChannelHeader layout changed");
+
+// Per-slot header, followed by the payload. `sequence` is the slot's turn:
+// equal to the position of a send that may fill it, and to that position
+// plus one once the tensor can be received.
+struct ChannelSlot {
+  std::atomic<uint64_t> sequence;
+  int32_t ndim;
+  DLDataType dtype;
+  int64_t data_size;
+  int64_t shape[kChannelMaxDims];
+  uint8_t padding[40];
+};
+static_assert(sizeof(ChannelSlot) == 128, "ChannelSlot layout changed");
+
+// Bounded multi-producer multi-consumer queue of CPU tensors living in one
+// preallocated store object. Tensors are copied into and out of fixed-size
+// slots, and the head, tail and slot turns are atomics in the shared
+// mapping, so once every process has opened the channel a send or receive
+// involves no store request and no allocation in the store. Blocking calls
+// poll with backoff.
+class TensorChannel {
+public:
+  // Size of the store object for a channel of this shape
+  static int64_t BufferSize(int64_t num_slots, int64_t slot_bytes);
+  // Lay out an empty channel in a newly created object
+  static void Init(uint8_t *data, int64_t num_slots, int64_t slot_bytes);
+
+  // Attach to a sealed channel object. `buffer` keeps it mapped and
+  // referenced for the lifetime of the channel.
+  TensorChannel(std::shared_ptr<Buffer> buffer,
+                std::shared_ptr<Metrics> metrics = nullptr);
+
+  // Copy `tensor` into the next free slot, waiting up to `timeout_ms` (-1
+  // for ever, 0 to not wait) for one. Returns false on timeout.
+  bool Send(DLManagedTensor *tensor, int64_t timeout_ms = -1);
+  // Take the oldest tensor, waiting up to `timeout_ms` for one. It is copied
+  // to `out` if given, which must match its dtype and shape; otherwise
+  // `*result` is set to a new host tensor. Returns false on timeout.
+  bool Receive(int64_t timeout_ms, DLManagedTensor *out,
+               DLManagedTensor **result);
+
+  int64_t num_slots() const { return header->num_slots; }
+  int64_t slot_bytes() const { return header->slot_bytes; }
+  // Tensors sent and not yet received, approximate under concurrency
+  int64_t Size() const;
+
+private:
+  ChannelSlot *SlotAt(uint64_t position) const;
+
+  std::shared_ptr<Buffer> buffer;
+  std::shared_ptr<Metrics> metrics;
+  ChannelHeader *header;
+};
+
+} // namespace vovp
+
+#endif /* VOVP_TENSOR_CHANNEL_H */
@@ -0,0 +1,55 @@
+#ifndef VOVP_TENSOR_HEADER_H
+#define VOVP_TENSOR_HEADER_H
+
+#include <cstdint>
+#include <dlpack/dlpack.h>
+#include <string>
+
+namespace vovp {
+
+// "VOVP" in little endian. The legacy dmlc-serialized metadata starts with the
+// device type, so it can never match.
+static constexpr uint32_t kTensorHeaderMagic = 0x50564f56;
+static constexpr uint16_t kTensorHeaderVersion = 1;
+
+// Fixed-layout tensor metadata stored as the plasma object metadata. It is
+// followed by `int64_t shape[ndim]` and `int64_t strides[ndim]` (in elements),
+// so the whole header can be decoded without a stream or any allocation.
+struct TensorHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t ndim;
+  int32_t device_type;
+  int32_t device_id;
+  DLDataType dtype;
+  // Size in bytes of the header including the shape and stride arrays
+  uint32_t header_size;
+  // Offset in bytes of the first element from the start of the data buffer
+  uint64_t byte_offset;
+};
+static_assert(sizeof(TensorHeader) == 32, "TensorHeader layout changed");
+
+inline int64_t TensorHeaderSize(int ndim) {
+  return sizeof(TensorHeader) + 2 * ndim * sizeof(int64_t);
+}
+
+// Encode a header for a tensor stored with the given layout. Null `strides`
+// means row-major contiguous.
+std::string EncodeTensorHeader(const DLContext &ctx, const DLDataType &dtype,
+                               int ndim, const int64_t *shape,
+                               const int64_t *strides = nullptr,
+                               uint64_t byte_offset = 0);
+
+// Decode the fixed part of a header in place. Returns false if `data` is not
+// a header of a known version, e.g. legacy dmlc-serialized metadata.
+bool DecodeTensorHeader(const uint8_t *data, int64_t size,
+                        TensorHeader *header);
+
+// Copy the shape and strides following a decoded header into caller-owned
+// arrays of at least `ndim` entries.
+void DecodeTensorHeaderArrays(const uint8_t *data, int ndim, int64_t *shape,
+                              int64_t *strides);
+
+} // namespace vovp
+
+#endif /* VOVP_TENSOR_HEADER_H */
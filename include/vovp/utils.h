@@ -5,6 +5,7 @@
 
 #include <plasma/client.h>
 #include <plasma/common.h>
+#include <stdexcept>
 #define VOVP_CHECK_ARROW(status)                                               \
   do {                                                                         \
     CHECK(status.ok()) << "Fail: " << status.ToString();                       \
@@ -17,6 +18,13 @@ inline void check_arrow_status(const Status &status) {
   CHECK(status.ok()) << "Fail: " << status.ToString();
 }
 
+// An object was not sealed within the timeout of a get or wait. Raised as
+// TimeoutError in Python.
+class ObjectTimeoutError : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
 inline ObjectID ToObjectID(std::string object_id) {
   // CHECK(object_id.size()<20);
   ObjectID id;
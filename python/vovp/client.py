@@ -1,30 +1,417 @@
 import _vovp
+import asyncio
 import torch as th
 from torch.utils.dlpack import to_dlpack, from_dlpack
 
 
+# Result of put_tensor_async/get_tensor_async, also usable with await
+class TensorFuture:
+    def __init__(self, native_future):
+        self._future = native_future
+        self._result = None
+
+    def done(self):
+        return self._future.done()
+
+    def result(self):
+        if self._result is None:
+            self._result = from_dlpack(self._future.result())
+        return self._result
+
+    def __await__(self):
+        loop = asyncio.get_event_loop()
+        return loop.run_in_executor(None, self.result).__await__()
+
+
+# DLPack (type code, bits) of each dtype create_tensor can allocate. Bool
+# tensors are stored as uint8, which every reader can import, and viewed as
+# bool by the creator.
+_DLPACK_TYPES = {
+    th.bool: (1, 8),
+    th.uint8: (1, 8),
+    th.int8: (0, 8),
+    th.int16: (0, 16),
+    th.int32: (0, 32),
+    th.int64: (0, 64),
+    th.float16: (2, 16),
+    th.float32: (2, 32),
+    th.float64: (2, 64),
+    th.bfloat16: (4, 16),
+    th.complex64: (5, 64),
+    th.complex128: (5, 128),
+}
+
+
+def _timeout_ms(block, timeout):
+    if not block:
+        return 0
+    if timeout is None:
+        return -1
+    return max(int(timeout * 1000), 0)
+
+
+def _store_view(tensor, object_id):
+    # Remembers the object behind a tensor mapping store memory, so that
+    # lookup_tensor finds it from the tensor or any view of it
+    tensor._vovp_object_id = object_id
+    return tensor
+
+
+def _open_channel(name, num_slots, slot_bytes):
+    return get_client().open_channel(name, num_slots, slot_bytes)
+
+
+# Fixed-size queue of CPU tensors in one store object, see open_channel.
+# Pickling a channel reopens it by name in the receiving process.
+class TensorChannel:
+    def __init__(self, name, native_channel):
+        self.name = name
+        self._channel = native_channel
+
+    def send(self, tensor, block=True, timeout=None):
+        # Copies tensor into a free slot. Returns False if none freed up in
+        # time.
+        return self._channel.send(to_dlpack(tensor), _timeout_ms(block, timeout))
+
+    def recv(self, block=True, timeout=None, out=None):
+        # The oldest tensor, written to out if given, or None on timeout
+        out_dlp = None if out is None else to_dlpack(out)
+        result = self._channel.recv(_timeout_ms(block, timeout), out_dlp)
+        if result is None:
+            return None
+        if out is not None:
+            return out
+        return from_dlpack(result)
+
+    def qsize(self):
+        return self._channel.size()
+
+    @property
+    def num_slots(self):
+        return self._channel.num_slots
+
+    @property
+    def slot_bytes(self):
+        return self._channel.slot_bytes
+
+    def __reduce__(self):
+        return _open_channel, (self.name, self.num_slots, self.slot_bytes)
+
+
 class VovpClient:
-    def __init__(self, socket_name):
-        self.plasma_client = _vovp.VovpPlasmaClient(socket_name)
+    def __init__(self, socket_name, num_connections=4, nodes=None):
+        # Concurrent calls from different threads run on separate store
+        # connections, up to num_connections at a time. A list of sockets
+        # connects to one store per NUMA node, nodes[i] being the node of
+        # socket_name[i] (by default the i-th node).
+        if isinstance(socket_name, str):
+            self.plasma_client = _vovp.VovpPlasmaClient(socket_name,
+                                                        num_connections)
+        else:
+            self.plasma_client = _vovp.VovpPlasmaClient(
+                list(socket_name), list(nodes or []), num_connections)
 
-    def put_tensor(self, object_id, tensor):
-        new_dlp = self.plasma_client.put_tensor(to_dlpack(tensor), object_id, False, True)
-        return from_dlpack(new_dlp)
+    def put_tensor(self, object_id, tensor, dedup=False, node=None,
+                   replicate=False):
+        # With dedup=True, a CPU tensor whose dtype, shape and bytes are
+        # already in the store is not copied again: object_id becomes an
+        # alias of the existing object. With several stores, the tensor goes
+        # to the store of `node` if given, and to every store with
+        # replicate=True, for read-mostly tensors.
+        if node is not None:
+            self.plasma_client.set_node_hint(node)
+        try:
+            if dedup:
+                new_dlp = self.plasma_client.put_dedup_tensor(to_dlpack(tensor), object_id, True)
+            else:
+                new_dlp = self.plasma_client.put_tensor(to_dlpack(tensor), object_id, False, True)
+        finally:
+            if node is not None:
+                self.plasma_client.set_node_hint(-1)
+        if replicate:
+            self.plasma_client.replicate(object_id)
+        return _store_view(from_dlpack(new_dlp), object_id)
+
+    def get_tensor(self, object_id, timeout=1.0, delete_on_free=True):
+        # Waits up to timeout seconds (None: for ever) for the object to be
+        # sealed, then raises TimeoutError. With delete_on_free=False, freeing
+        # the returned tensor leaves the object in the store.
+        new_dlp = self.plasma_client.get_tensor(
+            object_id, _timeout_ms(True, timeout), delete_on_free)
+        return _store_view(from_dlpack(new_dlp), object_id)
+
+    def wait_tensor(self, object_id, timeout=None):
+        # Returns once object_id is sealed, woken by the store's seal
+        # notification. False if timeout seconds passed first.
+        return self.plasma_client.wait_tensor(
+            object_id, _timeout_ms(True, timeout))
+
+    def wait_any(self, object_ids, timeout=None):
+        # The first of object_ids found sealed, or None on timeout
+        object_ids = list(object_ids)
+        index = self.plasma_client.wait_any(
+            object_ids, _timeout_ms(True, timeout))
+        return None if index < 0 else object_ids[index]
+
+    def update_tensor(self, object_id, tensor):
+        # Overwrites the stored tensor in place when dtype and shape match,
+        # otherwise replaces it like put_tensor. Readers' views of an updated
+        # object see the new values; read_tensor gives an untorn copy.
+        new_dlp, _ = self.plasma_client.update_tensor(to_dlpack(tensor), object_id)
+        return _store_view(from_dlpack(new_dlp), object_id)
+
+    def read_tensor(self, object_id):
+        # (private copy, version) where the copy matches a single update
+        new_dlp, version = self.plasma_client.read_tensor(object_id)
+        return from_dlpack(new_dlp), version
+
+    def tensor_version(self, object_id):
+        # Update count * 2 of an updatable object (odd while one is in
+        # progress), None for objects written by put_tensor
+        version = self.plasma_client.tensor_version(object_id)
+        return None if version < 0 else version
+
+    def put_bundle(self, object_id, tensors):
+        # Stores a dict of CPU tensors as one object, e.g. all the tensors of
+        # a minibatch, with a single allocation and seal
+        self.plasma_client.put_bundle(
+            object_id, {name: to_dlpack(t) for name, t in tensors.items()})
+
+    def get_bundle(self, object_id):
+        # Zero-copy views of the members of a bundle, as a dict
+        members = self.plasma_client.get_bundle(object_id)
+        return {name: from_dlpack(dlp) for name, dlp in members.items()}
+
+    def put_compressed(self, object_id, tensor, codec="lz4", block_size=1 << 20):
+        # Stores a CPU tensor compressed in blocks ("lz4" or "zstd") for data
+        # that is rarely read. get_tensor returns a decompressed private copy.
+        self.plasma_client.put_compressed(object_id, to_dlpack(tensor), codec,
+                                          block_size)
+
+    def get_tensor_rows(self, object_id, start, stop):
+        # Private copy of rows start:stop, decompressing only the blocks that
+        # hold them
+        return from_dlpack(
+            self.plasma_client.read_tensor_rows(object_id, start, stop))
+
+    def compression_info(self, object_id):
+        # codec, block_size, num_blocks, raw_size and compressed_size of a
+        # compressed object, None for other objects
+        return self.plasma_client.compression_info(object_id)
+
+    def put_sparse(self, object_id, shape, indptr=None, indices=None,
+                   row=None, col=None, data=None, delta=False):
+        # Stores a CSR (indptr, indices) or COO (row, col) matrix with
+        # optional values as one object. Indices are stored as int32 when
+        # they fit; with `delta`, sorted CSR rows are stored as differences.
+        if indptr is not None:
+            fmt, first, second = "csr", indptr, indices
+        else:
+            fmt, first, second = "coo", row, col
+        first, second = [
+            t.contiguous() if t.dtype in (th.int8, th.int16, th.int32, th.int64)
+            else t.long().contiguous() for t in (first, second)]
+        values = None if data is None else to_dlpack(data.contiguous())
+        self.plasma_client.put_sparse(
+            object_id, fmt, shape[0], shape[1], to_dlpack(first),
+            to_dlpack(second), values, delta)
 
-    def get_tensor(self, object_id):
-        new_dlp = self.plasma_client.get_tensor(object_id)
+    def get_sparse(self, object_id):
+        # dict with format, shape, nnz, the encoding of every array and the
+        # arrays by name, zero-copy views except delta encoded indices
+        result = self.plasma_client.get_sparse(object_id)
+        arrays = result.pop("arrays")
+        result.update(
+            {name: from_dlpack(dlp) for name, dlp in arrays.items()})
+        return result
+
+    def transpose_sparse(self, object_id, out_object_id):
+        # Stores the CSC form of a CSR matrix as the CSR matrix
+        # `out_object_id`. Without values, its data holds the position of
+        # each entry in the source.
+        self.plasma_client.transpose_sparse(object_id, out_object_id)
+
+    def slice_sparse_rows(self, object_id, rows):
+        # Private CSR arrays (indptr, indices, data) of rows `rows`
+        rows = rows.contiguous()
+        if rows.dtype not in (th.int32, th.int64):
+            rows = rows.long()
+        arrays = self.plasma_client.slice_sparse_rows(object_id,
+                                                      to_dlpack(rows))
+        return {name: from_dlpack(dlp) for name, dlp in arrays.items()}
+
+    def put_tensor_async(self, object_id, tensor):
+        return TensorFuture(self.plasma_client.put_tensor_async(
+            to_dlpack(tensor), object_id, False, True))
+
+    def get_tensor_async(self, object_id):
+        return TensorFuture(self.plasma_client.get_tensor_async(object_id))
+
+    def set_async_threads(self, num_threads):
+        self.plasma_client.set_async_threads(num_threads)
+
+    def gather_rows(self, object_id, index, out=None, out_object_id=None):
+        # Rows `index` of the stored tensor, read straight from store memory.
+        # The result goes to `out`, to the store object `out_object_id`, or
+        # to a new private tensor.
+        index = index.contiguous()
+        if index.dtype not in (th.int32, th.int64):
+            index = index.long()
+        out_dlp = None if out is None else to_dlpack(out)
+        new_dlp = self.plasma_client.gather_rows(
+            object_id, to_dlpack(index), out_dlp, out_object_id)
+        if new_dlp is None:
+            return out
         return from_dlpack(new_dlp)
+
+    def put_tensors(self, object_ids, tensors):
+        object_ids = list(object_ids)
+        new_dlps = self.plasma_client.put_tensors(
+            [to_dlpack(tensor) for tensor in tensors], object_ids, False, True)
+        return [_store_view(from_dlpack(new_dlp), object_id)
+                for new_dlp, object_id in zip(new_dlps, object_ids)]
+
+    def get_tensors(self, object_ids, timeout=1.0):
+        # Waits up to timeout seconds (None: for ever) for all of the objects
+        # to be sealed, then raises TimeoutError
+        object_ids = list(object_ids)
+        new_dlps = self.plasma_client.get_tensors(
+            object_ids, _timeout_ms(True, timeout))
+        return [_store_view(from_dlpack(new_dlp), object_id)
+                for new_dlp, object_id in zip(new_dlps, object_ids)]
     
+    def create_tensor(self, object_id, shape, dtype=th.float32, device="cpu", seal=True):
+        # With seal=False the result is a writable view of store memory that
+        # readers cannot get until seal(object_id); abort(object_id) drops it
+        device = th.device(device)
+        if dtype not in _DLPACK_TYPES:
+            raise TypeError("create_tensor does not support %s" % dtype)
+        dtype_code, dtype_bits = _DLPACK_TYPES[dtype]
+        new_dlp = self.plasma_client.create_tensor(
+            object_id, list(shape), dtype_code, dtype_bits, device.type,
+            device.index or 0, seal)
+        tensor = _store_view(from_dlpack(new_dlp), object_id)
+        if dtype == th.bool:
+            return tensor.view(th.bool)
+        return tensor
+
+    def seal(self, object_id):
+        self.plasma_client.seal(object_id)
+
+    def abort(self, object_id):
+        self.plasma_client.abort(object_id)
+
+    def flush(self):
+        self.plasma_client.flush()
+
+    def set_reclaim_options(self, flush_threshold=256, flush_interval_ms=10):
+        self.plasma_client.set_reclaim_options(flush_threshold, flush_interval_ms)
+
+    def cache_stats(self):
+        return self.plasma_client.cache_stats()
+
+    def stats(self):
+        # Per-phase latencies in microseconds, bytes copied per device, live
+        # tensors of this client and the occupancy of the whole store
+        return self.plasma_client.stats()
+
+    def enable_spill(self, directory):
+        # When the store is full, move cold objects to files in directory
+        # instead of failing; get_tensor brings them back
+        self.plasma_client.enable_spill(directory)
+
+    def prefetch(self, object_ids):
+        self.plasma_client.prefetch(list(object_ids))
+
+    def pin(self, object_id):
+        self.plasma_client.pin(object_id)
+
+    def unpin(self, object_id):
+        self.plasma_client.unpin(object_id)
+
+    def open_channel(self, name, num_slots=8, slot_bytes=1 << 20):
+        # Streams tensors of up to slot_bytes between processes without a
+        # store allocation per tensor. All slots are allocated here, once;
+        # opening an existing channel attaches to it.
+        return TensorChannel(
+            name, self.plasma_client.open_channel(name, num_slots, slot_bytes))
+
+    def snapshot(self, path, object_ids=None):
+        return self.plasma_client.snapshot(path, list(object_ids or []))
+
+    def restore(self, path, use_mmap=False):
+        return self.plasma_client.restore(path, use_mmap)
+
+    def reset_stats(self):
+        self.plasma_client.reset_stats()
+
+    def reset_cache_stats(self):
+        self.plasma_client.reset_cache_stats()
+
+    def set_cache_enabled(self, enabled):
+        self.plasma_client.set_cache_enabled(enabled)
+
+    def set_copy_options(self, **kwargs):
+        # Copy settings are process-wide, shared by every client
+        options = self.plasma_client.copy_options()
+        for key, value in kwargs.items():
+            if key not in options:
+                raise KeyError("Unknown copy option: %s" % key)
+            options[key] = value
+        self.plasma_client.set_copy_options(
+            options["num_threads"], options["parallel_threshold"],
+            options["bytes_per_thread"], options["nontemporal_threshold"],
+            options["numa_pin"], options["prefault_threshold"],
+            options["huge_page_align_threshold"])
+
+    def copy_options(self):
+        return self.plasma_client.copy_options()
+
+    def delete(self, object_id):
+        self.plasma_client.delete(object_id)
+
+    def lookup_tensor(self, tensor):
+        # Returns (object_id, element offset) if tensor is a view of a
+        # tensor this client returned for a store object, else None. Nothing
+        # is indexed on the get path: the object ID is read off the view's
+        # base tensor, only when asked.
+        base = tensor if tensor._base is None else tensor._base
+        object_id = getattr(base, "_vovp_object_id", None)
+        if object_id is None or tensor.numel() == 0:
+            return None
+        if base.element_size() != tensor.element_size():
+            return None
+        offset = tensor.data_ptr() - base.data_ptr()
+        if offset < 0 or offset % tensor.element_size() != 0:
+            return None
+        return object_id, offset // tensor.element_size()
+
     def list(self):
         self.plasma_client.list()
 
+    def set_placement(self, placement):
+        # Store for new objects when several are connected: "local" (the
+        # node of the calling thread) or "interleave" (each store in turn)
+        self.plasma_client.set_placement(placement)
+
+    def replicate(self, object_id):
+        # Copies an object to every store, returns the number of new copies
+        return self.plasma_client.replicate(object_id)
+
+    def object_nodes(self, object_id):
+        # NUMA nodes of the stores holding the object
+        return self.plasma_client.object_nodes(object_id)
+
+    def num_stores(self):
+        return self.plasma_client.num_stores()
+
 
 VOVP_CLIENT = None
 
 
-def init_client(socket_name="/tmp/dgl_socket"):
+def init_client(socket_name="/tmp/dgl_socket", num_connections=4, nodes=None):
     global VOVP_CLIENT
-    VOVP_CLIENT = VovpClient(socket_name)
+    VOVP_CLIENT = VovpClient(socket_name, num_connections, nodes)
     return VOVP_CLIENT
 
 
@@ -1,5 +1,7 @@
+import atexit
 import os
 import threading
+import time
 import multiprocessing
 from multiprocessing.util import register_after_fork
 from multiprocessing.reduction import ForkingPickler
@@ -16,19 +18,108 @@ class PlasmaIDHolder:
     def __init__(self, object_id) -> None:
         self.object_id = object_id
 
+# A tensor that already lives in the store is pickled as its ObjectID plus a
+# lease token. The receiver maps the object without taking ownership of it
+# and acks by creating a small object named by the token once it holds its
+# own reference. Until then the sender keeps the tensor alive, so the object
+# cannot be reclaimed while the pickle is in flight. A background thread
+# collects acked leases and those older than LEASE_TIMEOUT seconds, for
+# pickles that were never unpickled; leases still open at exit are dropped.
+LEASE_TIMEOUT = 300
+COLLECT_INTERVAL = 1.0
+_leases = {}
+_leases_lock = threading.Lock()
+_collector = None
+
+def _collect_leases(client, everything=False):
+    now = time.monotonic()
+    with _leases_lock:
+        tokens = list(_leases.items())
+    done = []
+    for token, (tensor, created) in tokens:
+        if (everything or now - created > LEASE_TIMEOUT or
+                client.wait_tensor(token, timeout=0)):
+            done.append(token)
+    with _leases_lock:
+        for token in done:
+            _leases.pop(token, None)
+    for token in done:
+        # Deletes the ack, if the receiver got that far
+        client.delete(token)
+
+def _collect_loop():
+    global _collector
+    while True:
+        time.sleep(COLLECT_INTERVAL)
+        _collect_leases(get_client())
+        with _leases_lock:
+            if not _leases:
+                _collector = None
+                return
+
+def _new_lease(client, tensor):
+    global _collector
+    token = id_generator(10)
+    with _leases_lock:
+        _leases[token] = (tensor, time.monotonic())
+        if _collector is None:
+            _collector = threading.Thread(target=_collect_loop, daemon=True)
+            _collector.start()
+    return token
+
+def _release_leases():
+    if _leases:
+        _collect_leases(get_client(), everything=True)
+
+def _reset_leases():
+    # The collector thread does not survive a fork, and the child must not
+    # release the parent's leases
+    global _collector
+    _leases.clear()
+    _collector = None
+
+atexit.register(_release_leases)
+os.register_at_fork(after_in_child=_reset_leases)
+
 def rebuild_tensor(object_id):
     client = get_client()
     return client.get_tensor(object_id)
 
+def rebuild_store_tensor(object_id, token, dtype, size, stride, offset):
+    client = get_client()
+    # The object belongs to the sender: freeing this view must not delete it
+    base = client.get_tensor(object_id, delete_on_free=False)
+    if base.dtype != dtype:
+        base = base.view(dtype)
+    tensor = base.as_strided(size, stride, offset)
+    try:
+        client.create_tensor(token, (1,), torch.uint8)
+    except RuntimeError:
+        # Already acked, the pickle was loaded more than once
+        pass
+    return tensor
+
 def reduce_tensor(tensor):
-    # print("Get client")
     client = get_client()
+    found = client.lookup_tensor(tensor)
+    if found is not None:
+        # Zero-copy: the receiver maps the same object
+        object_id, offset = found
+        token = _new_lease(client, tensor)
+        return (rebuild_store_tensor,
+                (object_id, token, tensor.dtype, tuple(tensor.size()),
+                 tuple(tensor.stride()), offset))
 
     object_id = id_generator(10)
-    client.put_tensor(object_id, tensor)
-
-    # print("Put Tensor")
+    client.put_tensor(object_id, tensor, dedup=_dedup)
     return (rebuild_tensor, (object_id,))
 
-def init_reduction():
-    ForkingPickler.register(torch.Tensor, reduce_tensor)
\ No newline at end of file
+# Set by init_reduction
+_dedup = False
+
+def init_reduction(dedup=False):
+    # With dedup=True, pickling the same tensor contents again shares the
+    # object stored the first time instead of copying them
+    global _dedup
+    _dedup = dedup
+    ForkingPickler.register(torch.Tensor, reduce_tensor)
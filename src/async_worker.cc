@@ -0,0 +1,39 @@
+#include "vovp/async_worker.h"
+
+namespace vovp {
+
+AsyncWorker::AsyncWorker(int num_threads) {
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back(&AsyncWorker::Run, this);
+  }
+}
+
+AsyncWorker::~AsyncWorker() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+  }
+  cond.notify_all();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+void AsyncWorker::Run() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cond.wait(lock, [this] { return stopped || !tasks.empty(); });
+      // Drain the queue before stopping so no future is left pending
+      if (tasks.empty()) {
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+  }
+}
+
+} // namespace vovp
@@ -0,0 +1,102 @@
+#include "vovp/bundle.h"
+#include "vovp/copy_utils.h"
+#include "vovp/tensor_header.h"
+#include "vovp/utils.h"
+
+#include <cstring>
+
+namespace vovp {
+
+namespace {
+
+int64_t AlignUp(int64_t size, int64_t align) {
+  return (size + align - 1) / align * align;
+}
+
+int64_t RecordSize(int64_t name_size, int64_t tensor_header_size) {
+  return AlignUp(sizeof(BundleEntry) + name_size + tensor_header_size, 8);
+}
+
+} // namespace
+
+std::string EncodeBundleHeader(const std::vector<std::string> &names,
+                               const std::vector<const DLTensor *> &tensors,
+                               std::vector<int64_t> *offsets,
+                               int64_t *data_size) {
+  CHECK_EQ(names.size(), tensors.size());
+  std::vector<std::string> tensor_headers;
+  int64_t metadata_size = sizeof(BundleHeader);
+  int64_t offset = 0;
+  offsets->clear();
+  for (size_t i = 0; i < tensors.size(); i++) {
+    const DLTensor &tensor = *tensors[i];
+    tensor_headers.push_back(EncodeTensorHeader(tensor.ctx, tensor.dtype,
+                                                tensor.ndim, tensor.shape));
+    metadata_size += RecordSize(names[i].size(), tensor_headers[i].size());
+    offset = AlignUp(offset, kBundleAlign);
+    offsets->push_back(offset);
+    offset += GetDataSize(tensor.dtype, tensor.shape, tensor.ndim);
+  }
+  *data_size = offset;
+
+  std::string metadata(metadata_size, '\0');
+  char *ptr = &metadata[0];
+  BundleHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = kBundleMagic;
+  header.version = kBundleVersion;
+  header.num_members = static_cast<uint32_t>(tensors.size());
+  header.header_size = static_cast<uint32_t>(metadata_size);
+  std::memcpy(ptr, &header, sizeof(header));
+  ptr += sizeof(header);
+  for (size_t i = 0; i < tensors.size(); i++) {
+    BundleEntry entry;
+    entry.data_offset = (*offsets)[i];
+    entry.data_size =
+        GetDataSize(tensors[i]->dtype, tensors[i]->shape, tensors[i]->ndim);
+    entry.name_size = static_cast<uint32_t>(names[i].size());
+    entry.tensor_header_size = static_cast<uint32_t>(tensor_headers[i].size());
+    std::memcpy(ptr, &entry, sizeof(entry));
+    std::memcpy(ptr + sizeof(entry), names[i].data(), names[i].size());
+    std::memcpy(ptr + sizeof(entry) + names[i].size(),
+                tensor_headers[i].data(), tensor_headers[i].size());
+    ptr += RecordSize(names[i].size(), tensor_headers[i].size());
+  }
+  return metadata;
+}
+
+bool DecodeBundleHeader(const uint8_t *data, int64_t size,
+                        std::vector<BundleMember> *members) {
+  BundleHeader header;
+  if (size < static_cast<int64_t>(sizeof(header))) {
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (header.magic != kBundleMagic || header.version != kBundleVersion ||
+      header.header_size > size) {
+    return false;
+  }
+  members->clear();
+  members->reserve(header.num_members);
+  const uint8_t *ptr = data + sizeof(header);
+  const uint8_t *end = data + header.header_size;
+  for (uint32_t i = 0; i < header.num_members; i++) {
+    BundleEntry entry;
+    CHECK_LE(ptr + sizeof(entry), end) << "Truncated bundle metadata";
+    std::memcpy(&entry, ptr, sizeof(entry));
+    int64_t record_size = RecordSize(entry.name_size, entry.tensor_header_size);
+    CHECK_LE(ptr + record_size, end) << "Truncated bundle metadata";
+    BundleMember member;
+    member.name.assign(reinterpret_cast<const char *>(ptr + sizeof(entry)),
+                       entry.name_size);
+    member.data_offset = entry.data_offset;
+    member.data_size = entry.data_size;
+    member.tensor_header = ptr + sizeof(entry) + entry.name_size;
+    member.tensor_header_size = entry.tensor_header_size;
+    members->push_back(std::move(member));
+    ptr += record_size;
+  }
+  return true;
+}
+
+} // namespace vovp
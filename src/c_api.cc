@@ -0,0 +1,172 @@
+#include "vovp/c_api.h"
+#include "vovp/plasma_manager.h"
+
+#include <cstring>
+#include <exception>
+#include <string>
+#include <vector>
+
+struct vovp_client {
+  vovp::VovpPlasmaManager manager;
+
+  vovp_client(const std::string &socket_name, int num_connections)
+      : manager(socket_name, num_connections) {}
+};
+
+namespace {
+
+using namespace vovp;
+
+thread_local std::string last_error;
+
+// Runs `f`, turning the exceptions that would have crossed the C boundary
+// into status codes
+template <typename F> int Guard(F f) {
+  try {
+    f();
+    return VOVP_OK;
+  } catch (const ObjectTimeoutError &e) {
+    last_error = e.what();
+    return VOVP_TIMEOUT;
+  } catch (const std::exception &e) {
+    last_error = e.what();
+    return VOVP_ERROR;
+  } catch (...) {
+    last_error = "unknown error";
+    return VOVP_ERROR;
+  }
+}
+
+int InvalidArgument(const char *message) {
+  last_error = message;
+  return VOVP_INVALID_ARGUMENT;
+}
+
+ObjectID ToPlasmaID(const vovp_object_id_t *object_id) {
+  static_assert(VOVP_OBJECT_ID_SIZE == kUniqueIDSize,
+                "vovp_object_id_t does not match the plasma ID size");
+  ObjectID id;
+  std::memcpy(id.mutable_data(), object_id->id, VOVP_OBJECT_ID_SIZE);
+  return id;
+}
+
+} // namespace
+
+extern "C" {
+
+int vovp_api_version(void) { return VOVP_C_API_VERSION; }
+
+const char *vovp_last_error(void) { return last_error.c_str(); }
+
+int vovp_object_id_from_name(const char *name, size_t length,
+                             vovp_object_id_t *object_id) {
+  if ((name == nullptr && length > 0) || object_id == nullptr) {
+    return InvalidArgument("invalid argument to vovp_object_id_from_name");
+  }
+  if (length > VOVP_OBJECT_ID_SIZE) {
+    return InvalidArgument("object name longer than an object ID");
+  }
+  std::memset(object_id->id, 0, VOVP_OBJECT_ID_SIZE);
+  std::memcpy(object_id->id, name, length);
+  return VOVP_OK;
+}
+
+int vovp_client_create(const char *socket_name, int num_connections,
+                       vovp_client_t **client) {
+  if (socket_name == nullptr || num_connections < 0 || client == nullptr) {
+    return InvalidArgument("invalid argument to vovp_client_create");
+  }
+  if (num_connections == 0) {
+    num_connections = VovpPlasmaManager::kDefaultConnections;
+  }
+  return Guard(
+      [&] { *client = new vovp_client(socket_name, num_connections); });
+}
+
+void vovp_client_destroy(vovp_client_t *client) { delete client; }
+
+int vovp_put(vovp_client_t *client, const vovp_object_id_t *object_id,
+             DLManagedTensor *tensor, DLManagedTensor **out) {
+  if (client == nullptr || object_id == nullptr || tensor == nullptr ||
+      out == nullptr) {
+    return InvalidArgument("invalid argument to vovp_put");
+  }
+  ObjectID id = ToPlasmaID(object_id);
+  return Guard(
+      [&] { *out = client->manager.PutDlpackTensor(tensor, id, false); });
+}
+
+int vovp_get(vovp_client_t *client, const vovp_object_id_t *object_id,
+             int64_t timeout_ms, DLManagedTensor **out) {
+  return vovp_get_ex(client, object_id, timeout_ms, 1, out);
+}
+
+int vovp_get_ex(vovp_client_t *client, const vovp_object_id_t *object_id,
+                int64_t timeout_ms, int delete_on_free,
+                DLManagedTensor **out) {
+  if (client == nullptr || object_id == nullptr || out == nullptr) {
+    return InvalidArgument("invalid argument to vovp_get");
+  }
+  ObjectID id = ToPlasmaID(object_id);
+  return Guard([&] {
+    *out = client->manager.GetDlpackTensor(id, timeout_ms,
+                                           delete_on_free != 0);
+  });
+}
+
+int vovp_create(vovp_client_t *client, const vovp_object_id_t *object_id,
+                const int64_t *shape, int ndim, DLDataType dtype,
+                DLContext ctx, int seal, DLManagedTensor **out) {
+  if (client == nullptr || object_id == nullptr || out == nullptr) {
+    return InvalidArgument("invalid argument to vovp_create");
+  }
+  if (ndim < 0 || (ndim > 0 && shape == nullptr)) {
+    return InvalidArgument("invalid shape");
+  }
+  ObjectID id = ToPlasmaID(object_id);
+  std::vector<int64_t> dims(shape, shape + ndim);
+  return Guard([&] {
+    *out = client->manager.CreateTensor(id, dims.data(), ndim, dtype, ctx,
+                                        seal != 0);
+  });
+}
+
+int vovp_seal(vovp_client_t *client, const vovp_object_id_t *object_id) {
+  if (client == nullptr || object_id == nullptr) {
+    return InvalidArgument("invalid argument to vovp_seal");
+  }
+  ObjectID id = ToPlasmaID(object_id);
+  return Guard([&] { client->manager.Seal(id); });
+}
+
+int vovp_abort(vovp_client_t *client, const vovp_object_id_t *object_id) {
+  if (client == nullptr || object_id == nullptr) {
+    return InvalidArgument("invalid argument to vovp_abort");
+  }
+  ObjectID id = ToPlasmaID(object_id);
+  return Guard([&] { client->manager.Abort(id); });
+}
+
+int vovp_release(vovp_client_t *client, DLManagedTensor *tensor) {
+  if (client == nullptr || tensor == nullptr) {
+    return InvalidArgument("invalid argument to vovp_release");
+  }
+  return Guard([&] { client->manager.Release(tensor); });
+}
+
+int vovp_delete(vovp_client_t *client, const vovp_object_id_t *object_id) {
+  if (client == nullptr || object_id == nullptr) {
+    return InvalidArgument("invalid argument to vovp_delete");
+  }
+  ObjectID id = ToPlasmaID(object_id);
+  return Guard([&] { client->manager.Delete(id); });
+}
+
+int vovp_flush(vovp_client_t *client) {
+  if (client == nullptr) {
+    return InvalidArgument("invalid argument to vovp_flush");
+  }
+  return Guard([&] { client->manager.Flush(); });
+}
+
+} // extern "C"
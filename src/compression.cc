@@ -0,0 +1,227 @@
+#include "vovp/compression.h"
+#include "vovp/copy_engine.h"
+#include "vovp/utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+namespace vovp {
+
+namespace {
+
+// Codecs run about an order of magnitude slower than memcpy, so a block
+// job gets as many threads as a copy this many times larger
+constexpr int64_t kCodecCost = 8;
+
+std::unique_ptr<arrow::util::Codec> MakeCodec(int codec, bool *ok) {
+  auto result =
+      arrow::util::Codec::Create(static_cast<arrow::Compression::type>(codec));
+  *ok = result.ok();
+  if (!*ok) {
+    return nullptr;
+  }
+  return std::move(result).ValueOrDie();
+}
+
+} // namespace
+
+arrow::Compression::type ParseCompression(const std::string &name) {
+  if (name == "lz4") {
+    return arrow::Compression::LZ4;
+  } else if (name == "zstd") {
+    return arrow::Compression::ZSTD;
+  }
+  LOG(FATAL) << "Unknown codec " << name << ", expected lz4 or zstd";
+  return arrow::Compression::UNCOMPRESSED;
+}
+
+const char *CompressionName(int codec) {
+  switch (codec) {
+  case arrow::Compression::LZ4:
+    return "lz4";
+  case arrow::Compression::ZSTD:
+    return "zstd";
+  default:
+    return "unknown";
+  }
+}
+
+bool IsCompressedHeader(const uint8_t *data, int64_t size) {
+  uint32_t magic;
+  if (size < static_cast<int64_t>(sizeof(CompressedHeader))) {
+    return false;
+  }
+  std::memcpy(&magic, data, sizeof(magic));
+  return magic == kCompressedMagic;
+}
+
+std::vector<std::string> CompressBlocks(arrow::Compression::type codec,
+                                        const uint8_t *src, int64_t size,
+                                        int64_t block_size) {
+  CHECK(block_size > 0 && block_size <= kMaxCompressionBlock)
+      << "Invalid compression block size " << block_size;
+  bool ok;
+  // Fail on the calling thread if the codec is not built into arrow
+  MakeCodec(codec, &ok);
+  CHECK(ok) << "Codec " << CompressionName(codec) << " is not available";
+  int64_t num_blocks = (size + block_size - 1) / block_size;
+  std::vector<std::string> blocks(num_blocks);
+  std::atomic<bool> failed{false};
+  auto &engine = CopyEngine::Global();
+  engine.ParallelFor(
+      num_blocks, engine.NumThreadsFor(size * kCodecCost),
+      [&](int64_t begin, int64_t end) {
+        bool ok;
+        auto compressor = MakeCodec(codec, &ok);
+        for (int64_t i = begin; i < end && ok; i++) {
+          const uint8_t *input = src + i * block_size;
+          int64_t input_size = std::min(block_size, size - i * block_size);
+          std::string &block = blocks[i];
+          block.resize(compressor->MaxCompressedLen(input_size, input));
+          auto result = compressor->Compress(
+              input_size, input, block.size(),
+              reinterpret_cast<uint8_t *>(&block[0]));
+          ok = result.ok();
+          if (ok && result.ValueOrDie() < input_size) {
+            block.resize(result.ValueOrDie());
+          } else {
+            // Keep blocks that do not shrink as they are
+            block.assign(reinterpret_cast<const char *>(input), input_size);
+          }
+        }
+        if (!ok) {
+          failed.store(true, std::memory_order_relaxed);
+        }
+      });
+  CHECK(!failed) << "Compression with " << CompressionName(codec)
+                 << " failed";
+  return blocks;
+}
+
+std::string EncodeCompressedHeader(arrow::Compression::type codec,
+                                   int64_t block_size, int64_t raw_size,
+                                   const std::string &tensor_header,
+                                   const std::vector<std::string> &blocks,
+                                   int64_t *data_size) {
+  std::string metadata(sizeof(CompressedHeader) + tensor_header.size() +
+                           blocks.size() * sizeof(CompressedBlock),
+                       '\0');
+  CompressedHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = kCompressedMagic;
+  header.version = kCompressedVersion;
+  header.codec = static_cast<int32_t>(codec);
+  header.tensor_header_size = static_cast<uint32_t>(tensor_header.size());
+  header.block_size = block_size;
+  header.num_blocks = blocks.size();
+  header.raw_size = raw_size;
+  header.header_size = metadata.size();
+  char *ptr = &metadata[0];
+  std::memcpy(ptr, &header, sizeof(header));
+  ptr += sizeof(header);
+  std::memcpy(ptr, tensor_header.data(), tensor_header.size());
+  ptr += tensor_header.size();
+  uint64_t offset = 0;
+  for (auto &block : blocks) {
+    CompressedBlock entry;
+    entry.offset = offset;
+    entry.size = block.size();
+    std::memcpy(ptr, &entry, sizeof(entry));
+    ptr += sizeof(entry);
+    offset += block.size();
+  }
+  *data_size = offset;
+  return metadata;
+}
+
+bool DecodeCompressedHeader(const uint8_t *data, int64_t size,
+                            CompressedLayout *layout) {
+  if (!IsCompressedHeader(data, size)) {
+    return false;
+  }
+  CompressedHeader &header = layout->header;
+  std::memcpy(&header, data, sizeof(header));
+  if (header.version != kCompressedVersion || header.block_size == 0 ||
+      header.num_blocks !=
+          (header.raw_size + header.block_size - 1) / header.block_size ||
+      header.header_size > static_cast<uint64_t>(size) ||
+      header.header_size != sizeof(header) + header.tensor_header_size +
+                                header.num_blocks * sizeof(CompressedBlock)) {
+    return false;
+  }
+  layout->tensor_header = data + sizeof(header);
+  // Plasma places the metadata right after the data, so it is not aligned
+  layout->blocks.resize(header.num_blocks);
+  std::memcpy(layout->blocks.data(),
+              layout->tensor_header + header.tensor_header_size,
+              header.num_blocks * sizeof(CompressedBlock));
+  return true;
+}
+
+void DecompressRange(const CompressedLayout &layout, const uint8_t *data,
+                     int64_t data_size, int64_t begin, int64_t end,
+                     uint8_t *dst) {
+  const CompressedHeader &header = layout.header;
+  int64_t block_size = header.block_size;
+  int64_t raw_size = header.raw_size;
+  CHECK(0 <= begin && begin <= end && end <= raw_size)
+      << "Range [" << begin << ", " << end << ") is outside of the tensor";
+  if (begin == end) {
+    return;
+  }
+  int64_t first = begin / block_size;
+  int64_t last = (end - 1) / block_size + 1;
+  CHECK_LE(static_cast<uint64_t>(last), layout.blocks.size());
+  for (int64_t i = first; i < last; i++) {
+    CHECK_LE(layout.blocks[i].offset + layout.blocks[i].size,
+             static_cast<uint64_t>(data_size))
+        << "Corrupt compressed tensor";
+  }
+  bool ok;
+  MakeCodec(header.codec, &ok);
+  CHECK(ok) << "Codec " << CompressionName(header.codec)
+            << " is not available";
+  std::atomic<bool> failed{false};
+  auto &engine = CopyEngine::Global();
+  engine.ParallelFor(
+      last - first, engine.NumThreadsFor((end - begin) * kCodecCost),
+      [&](int64_t task_begin, int64_t task_end) {
+        bool ok;
+        auto decompressor = MakeCodec(header.codec, &ok);
+        // Blocks cut by the range are decompressed here first
+        std::vector<uint8_t> scratch;
+        for (int64_t i = first + task_begin; i < first + task_end && ok;
+             i++) {
+          const CompressedBlock &block = layout.blocks[i];
+          int64_t block_begin = i * block_size;
+          int64_t block_end = std::min(raw_size, block_begin + block_size);
+          int64_t lo = std::max(begin, block_begin);
+          int64_t hi = std::min(end, block_end);
+          bool whole = lo == block_begin && hi == block_end;
+          uint8_t *out = dst + (block_begin - begin);
+          if (!whole) {
+            scratch.resize(block_end - block_begin);
+            out = scratch.data();
+          }
+          if (static_cast<int64_t>(block.size) == block_end - block_begin) {
+            std::memcpy(out, data + block.offset, block.size);
+          } else {
+            auto result = decompressor->Decompress(
+                block.size, data + block.offset, block_end - block_begin, out);
+            ok = result.ok() && result.ValueOrDie() == block_end - block_begin;
+          }
+          if (ok && !whole) {
+            std::memcpy(dst + (lo - begin), out + (lo - block_begin), hi - lo);
+          }
+        }
+        if (!ok) {
+          failed.store(true, std::memory_order_relaxed);
+        }
+      },
+      dst);
+  CHECK(!failed) << "Corrupt compressed tensor";
+}
+
+} // namespace vovp
@@ -0,0 +1,69 @@
+#include "vovp/connection_pool.h"
+#include "vovp/utils.h"
+
+namespace vovp {
+
+ConnectionPool::ConnectionPool(const std::string &socket_name,
+                               int num_connections,
+                               const std::shared_ptr<Metrics> &metrics) {
+  CHECK_GT(num_connections, 0);
+  for (int i = 0; i < num_connections; i++) {
+    std::unique_ptr<Connection> conn(new Connection());
+    conn->client = std::shared_ptr<PlasmaClient>(
+        new PlasmaClient(), [](PlasmaClient *client) {
+          check_arrow_status(client->Disconnect());
+          delete client;
+        });
+    auto status = conn->client->Connect(socket_name, "", 0, 10);
+    CHECK(status.ok()) << "Connection failed: " << status.ToString();
+    conn->reclaimer =
+        std::make_shared<ReclaimQueue>(conn->client, 256, 10, metrics);
+    connections.push_back(std::move(conn));
+  }
+}
+
+ConnectionPool::Lease ConnectionPool::Acquire() {
+  size_t n = connections.size();
+  size_t start = next.fetch_add(1, std::memory_order_relaxed) % n;
+  for (size_t i = 0; i < n; i++) {
+    Connection *conn = connections[(start + i) % n].get();
+    int idle = 0;
+    if (conn->active.compare_exchange_strong(idle, 1,
+                                             std::memory_order_acquire)) {
+      return Lease(conn);
+    }
+  }
+  // All busy: share one, PlasmaClient itself is thread-safe
+  Connection *conn = connections[start].get();
+  conn->active.fetch_add(1, std::memory_order_acquire);
+  return Lease(conn);
+}
+
+void ConnectionPool::FlushPending() {
+  for (auto &conn : connections) {
+    if (!conn->reclaimer->Empty()) {
+      conn->reclaimer->Flush();
+    }
+  }
+}
+
+void ConnectionPool::Flush() {
+  for (auto &conn : connections) {
+    conn->reclaimer->Flush();
+  }
+}
+
+void ConnectionPool::SetReclaimOptions(size_t flush_threshold,
+                                       int64_t flush_interval_ms) {
+  for (auto &conn : connections) {
+    conn->reclaimer->SetOptions(flush_threshold, flush_interval_ms);
+  }
+}
+
+void ConnectionPool::SetDeleteHook(const ReclaimQueue::DeleteHook &hook) {
+  for (auto &conn : connections) {
+    conn->reclaimer->SetDeleteHook(hook);
+  }
+}
+
+} // namespace vovp
@@ -0,0 +1,368 @@
+#include "vovp/copy_engine.h"
+#include <algorithm>
+#include <cstring>
+#include <dmlc/logging.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace vovp {
+
+// Upper bound on the default thread count; a socket's memory bandwidth is
+// usually saturated well before this.
+static constexpr int kMaxDefaultThreads = 16;
+
+namespace {
+
+std::vector<int> ParseCpuList(const std::string &list) {
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty() || range == "\n") {
+      continue;
+    }
+    auto dash = range.find('-');
+    int begin = std::stoi(range.substr(0, dash));
+    int end = dash == std::string::npos ? begin
+                                        : std::stoi(range.substr(dash + 1));
+    for (int cpu = begin; cpu <= end; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+std::vector<std::vector<int>> ReadNodeCpus() {
+  std::vector<std::vector<int>> node_cpus;
+  for (int node = 0;; node++) {
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) +
+                       "/cpulist");
+    if (!file) {
+      break;
+    }
+    std::string list;
+    std::getline(file, list);
+    node_cpus.push_back(ParseCpuList(list));
+  }
+  return node_cpus;
+}
+
+void PinCurrentThread(const std::vector<int> &cpus) {
+#ifdef __linux__
+  if (cpus.empty()) {
+    return;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    LOG(WARNING) << "Failed to pin copy thread";
+  }
+#endif
+}
+
+// memcpy with streaming stores so a copy much larger than the LLC does not
+// evict everything else and skips the read-for-ownership of `dst`
+void StreamCopy(char *dst, const char *src, int64_t size) {
+#ifdef __SSE2__
+  int64_t head = (16 - reinterpret_cast<uintptr_t>(dst) % 16) % 16;
+  if (size < head + 64) {
+    std::memcpy(dst, src, size);
+    return;
+  }
+  std::memcpy(dst, src, head);
+  dst += head;
+  src += head;
+  size -= head;
+  int64_t body = size & ~int64_t(63);
+  for (int64_t i = 0; i < body; i += 64) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 16));
+    __m128i c =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 32));
+    __m128i d =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 48));
+    _mm_stream_si128(reinterpret_cast<__m128i *>(dst + i), a);
+    _mm_stream_si128(reinterpret_cast<__m128i *>(dst + i + 16), b);
+    _mm_stream_si128(reinterpret_cast<__m128i *>(dst + i + 32), c);
+    _mm_stream_si128(reinterpret_cast<__m128i *>(dst + i + 48), d);
+  }
+  _mm_sfence();
+  std::memcpy(dst + body, src + body, size - body);
+#else
+  std::memcpy(dst, src, size);
+#endif
+}
+
+#if defined(__linux__) && !defined(MADV_POPULATE_WRITE)
+// Linux 5.14, missing from older headers
+#define MADV_POPULATE_WRITE 23
+#endif
+
+// Cleared once the kernel rejects MADV_POPULATE_WRITE
+std::atomic<bool> populate_supported{true};
+
+void PopulatePages(char *begin, char *end, int64_t page_size) {
+#ifdef __linux__
+  if (populate_supported.load(std::memory_order_relaxed)) {
+    // Populating never changes the contents, so the partial pages at the
+    // ends, shared with other objects, may be included
+    auto first = reinterpret_cast<uintptr_t>(begin) &
+                 ~static_cast<uintptr_t>(page_size - 1);
+    if (madvise(reinterpret_cast<void *>(first),
+                reinterpret_cast<uintptr_t>(end) - first,
+                MADV_POPULATE_WRITE) == 0) {
+      return;
+    }
+    populate_supported.store(false, std::memory_order_relaxed);
+  }
+#endif
+  // Write fault one byte per page, staying inside the range
+  volatile char *ptr = begin;
+  while (ptr < end) {
+    *ptr = *ptr;
+    auto next = (reinterpret_cast<uintptr_t>(ptr) | (page_size - 1)) + 1;
+    ptr = reinterpret_cast<volatile char *>(next);
+  }
+}
+
+} // namespace
+
+int NumaNodeOfAddress(const void *addr) {
+#if defined(__linux__) && defined(SYS_get_mempolicy)
+  // MPOL_F_NODE | MPOL_F_ADDR from <numaif.h>, without linking libnuma
+  const unsigned long kFlags = (1 << 0) | (1 << 1);
+  int node = -1;
+  if (syscall(SYS_get_mempolicy, &node, nullptr, 0, const_cast<void *>(addr),
+              kFlags) == 0) {
+    return node;
+  }
+#endif
+  return -1;
+}
+
+ThreadPool::ThreadPool(int num_workers, const std::vector<int> &cpus) {
+  for (int i = 0; i < num_workers; i++) {
+    workers.emplace_back(&ThreadPool::WorkerLoop, this, i, cpus);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+  }
+  cond.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::RunTasks() {
+  for (int i = next_task++; i < num_tasks; i = next_task++) {
+    (*job)(i);
+  }
+}
+
+void ThreadPool::Run(int num_tasks, int num_threads,
+                     const std::function<void(int)> &f) {
+  int helpers = std::min(std::min(num_threads - 1, num_workers()),
+                         num_tasks - 1);
+  if (helpers <= 0) {
+    for (int i = 0; i < num_tasks; i++) {
+      f(i);
+    }
+    return;
+  }
+  std::lock_guard<std::mutex> run_lock(run_mutex);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    job = &f;
+    this->num_tasks = num_tasks;
+    next_task = 0;
+    num_helpers = helpers;
+    num_finished = 0;
+    generation++;
+  }
+  cond.notify_all();
+  RunTasks();
+  std::unique_lock<std::mutex> lock(mutex);
+  // Helpers must be done with `job` before it goes out of scope
+  done_cond.wait(lock, [this] { return num_finished == num_helpers; });
+  job = nullptr;
+}
+
+void ThreadPool::WorkerLoop(int worker_id, std::vector<int> cpus) {
+  PinCurrentThread(cpus);
+  uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    cond.wait(lock, [&] { return stopped || generation != seen; });
+    if (stopped) {
+      return;
+    }
+    seen = generation;
+    if (worker_id >= num_helpers) {
+      continue;
+    }
+    lock.unlock();
+    RunTasks();
+    lock.lock();
+    if (++num_finished == num_helpers) {
+      done_cond.notify_one();
+    }
+  }
+}
+
+CopyEngine &CopyEngine::Global() {
+  static CopyEngine engine;
+  return engine;
+}
+
+CopyEngine::CopyEngine() : node_cpus(ReadNodeCpus()) {}
+
+CopyOptions CopyEngine::options() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return options_;
+}
+
+void CopyEngine::SetOptions(const CopyOptions &options) {
+  std::lock_guard<std::mutex> lock(mutex);
+  options_ = options;
+  // Pools are rebuilt with the new size on next use; copies still running
+  // keep their old pool alive
+  pools.clear();
+}
+
+int CopyEngine::MaxThreads(int node) {
+  if (options_.num_threads > 0) {
+    return options_.num_threads;
+  }
+  int cpus = node >= 0 ? static_cast<int>(node_cpus[node].size())
+                       : static_cast<int>(std::thread::hardware_concurrency());
+  return std::max(1, std::min(cpus, kMaxDefaultThreads));
+}
+
+int CopyEngine::NumThreadsFor(int64_t size) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (size < options_.parallel_threshold) {
+    return 1;
+  }
+  int64_t threads = size / std::max<int64_t>(options_.bytes_per_thread, 1);
+  return static_cast<int>(
+      std::max<int64_t>(1, std::min<int64_t>(threads, MaxThreads(-1))));
+}
+
+std::shared_ptr<ThreadPool> CopyEngine::GetPool(const void *dst_hint) {
+  int node = -1;
+  bool numa_pin;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    numa_pin = options_.numa_pin && node_cpus.size() > 1;
+  }
+  if (numa_pin && dst_hint != nullptr) {
+    node = NumaNodeOfAddress(dst_hint);
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  if (node >= static_cast<int>(node_cpus.size())) {
+    node = -1;
+  }
+  auto &pool = pools[node];
+  if (!pool) {
+    std::vector<int> cpus;
+    if (node >= 0) {
+      cpus = node_cpus[node];
+    }
+    pool = std::make_shared<ThreadPool>(MaxThreads(node) - 1, cpus);
+  }
+  return pool;
+}
+
+void CopyEngine::ParallelFor(int64_t num_tasks, int num_threads,
+                             const std::function<void(int64_t, int64_t)> &f,
+                             const void *dst_hint) {
+  num_threads = static_cast<int>(
+      std::min<int64_t>(std::max(num_threads, 1), num_tasks));
+  if (num_threads <= 1) {
+    f(0, num_tasks);
+    return;
+  }
+  int64_t chunk = (num_tasks + num_threads - 1) / num_threads;
+  int num_chunks = static_cast<int>((num_tasks + chunk - 1) / chunk);
+  GetPool(dst_hint)->Run(num_chunks, num_threads, [&](int i) {
+    int64_t begin = i * chunk;
+    f(begin, std::min(num_tasks, begin + chunk));
+  });
+}
+
+void CopyEngine::Prefault(void *ptr, int64_t size) {
+  if (size <= 0) {
+    return;
+  }
+#ifdef __linux__
+  int64_t page_size = sysconf(_SC_PAGESIZE);
+#else
+  int64_t page_size = 4096;
+#endif
+  auto base = static_cast<char *>(ptr);
+  int64_t num_chunks = (size + kHugePageSize - 1) / kHugePageSize;
+  // The pool is picked from the node of the first page, which the NUMA
+  // lookup faults in, so the other pages are first touched on that node
+  ParallelFor(
+      num_chunks, NumThreadsFor(size),
+      [&](int64_t begin, int64_t end) {
+        PopulatePages(base + begin * kHugePageSize,
+                      base + std::min(size, end * kHugePageSize), page_size);
+      },
+      ptr);
+}
+
+void CopyEngine::Memcpy(void *dst, const void *src, int64_t size) {
+  bool nontemporal;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    nontemporal = size >= options_.nontemporal_threshold;
+  }
+  auto dst_ptr = static_cast<char *>(dst);
+  auto src_ptr = static_cast<const char *>(src);
+  int num_threads = NumThreadsFor(size);
+  if (num_threads <= 1) {
+    if (nontemporal) {
+      StreamCopy(dst_ptr, src_ptr, size);
+    } else {
+      std::memcpy(dst_ptr, src_ptr, size);
+    }
+    return;
+  }
+  // Split on cache line boundaries so no two threads write the same line
+  int64_t num_lines = (size + 63) / 64;
+  ParallelFor(
+      num_lines, num_threads,
+      [&](int64_t begin, int64_t end) {
+        int64_t offset = begin * 64;
+        int64_t bytes = std::min(size, end * 64) - offset;
+        if (nontemporal) {
+          StreamCopy(dst_ptr + offset, src_ptr + offset, bytes);
+        } else {
+          std::memcpy(dst_ptr + offset, src_ptr + offset, bytes);
+        }
+      },
+      dst);
+}
+
+} // namespace vovp
@@ -0,0 +1,290 @@
+#include "vovp/copy_utils.h"
+#include "vovp/copy_engine.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <dmlc/logging.h>
+#include <vector>
+
+namespace vovp {
+
+// Tile edge (in elements) for copies whose innermost source stride is not 1
+static constexpr int64_t kTileSize = 32;
+// How many rows ahead GatherRows prefetches
+static constexpr int64_t kPrefetchDistance = 8;
+
+int64_t GetDataSize(const DLDataType &dtype, const int64_t *shape, int ndim) {
+  int64_t data_size = dtype.bits / 8;
+  for (int i = 0; i < ndim; i++) {
+    data_size *= shape[i];
+  }
+  return data_size;
+}
+
+namespace {
+
+struct CopyLayout {
+  int ndim = 0;
+  int64_t elem_size = 0;
+  // Shape and source strides in bytes after dropping size-1 dims and
+  // merging dims that are contiguous with each other
+  std::vector<int64_t> shape;
+  std::vector<int64_t> strides;
+};
+
+CopyLayout CollapseLayout(const DLTensor &src) {
+  CopyLayout layout;
+  layout.elem_size = src.dtype.bits / 8;
+  std::vector<int64_t> dense_strides(src.ndim, 1);
+  for (int i = src.ndim - 2; i >= 0; --i) {
+    dense_strides[i] = dense_strides[i + 1] * src.shape[i + 1];
+  }
+  const int64_t *strides =
+      src.strides == nullptr ? dense_strides.data() : src.strides;
+  for (int i = 0; i < src.ndim; i++) {
+    if (src.shape[i] == 1) {
+      continue;
+    }
+    int64_t stride = strides[i] * layout.elem_size;
+    if (!layout.shape.empty() &&
+        layout.strides.back() == stride * src.shape[i]) {
+      layout.shape.back() *= src.shape[i];
+      layout.strides.back() = stride;
+    } else {
+      layout.shape.push_back(src.shape[i]);
+      layout.strides.push_back(stride);
+    }
+  }
+  layout.ndim = static_cast<int>(layout.shape.size());
+  return layout;
+}
+
+// Source byte offset of the first element of outer index `index`, where the
+// outer index ranges over the first `outer_ndim` dims in row-major order
+inline int64_t OuterOffset(const CopyLayout &layout, int outer_ndim,
+                           int64_t index) {
+  int64_t offset = 0;
+  for (int i = outer_ndim - 1; i >= 0; --i) {
+    offset += (index % layout.shape[i]) * layout.strides[i];
+    index /= layout.shape[i];
+  }
+  return offset;
+}
+
+template <typename DType>
+void CopyTile(char *dst, const char *src, int64_t rows, int64_t cols,
+              int64_t dst_row_stride, int64_t src_row_stride,
+              int64_t src_col_stride) {
+  // Walk along the smaller source stride so the reads stay sequential
+  if (std::abs(src_row_stride) < std::abs(src_col_stride)) {
+    for (int64_t j = 0; j < cols; j++) {
+      for (int64_t i = 0; i < rows; i++) {
+        *reinterpret_cast<DType *>(dst + i * dst_row_stride +
+                                   j * sizeof(DType)) =
+            *reinterpret_cast<const DType *>(src + i * src_row_stride +
+                                             j * src_col_stride);
+      }
+    }
+  } else {
+    for (int64_t i = 0; i < rows; i++) {
+      for (int64_t j = 0; j < cols; j++) {
+        *reinterpret_cast<DType *>(dst + i * dst_row_stride +
+                                   j * sizeof(DType)) =
+            *reinterpret_cast<const DType *>(src + i * src_row_stride +
+                                             j * src_col_stride);
+      }
+    }
+  }
+}
+
+void CopyTileBytes(char *dst, const char *src, int64_t rows, int64_t cols,
+                   int64_t elem_size, int64_t dst_row_stride,
+                   int64_t src_row_stride, int64_t src_col_stride) {
+  switch (elem_size) {
+  case 1:
+    CopyTile<uint8_t>(dst, src, rows, cols, dst_row_stride, src_row_stride,
+                      src_col_stride);
+    break;
+  case 2:
+    CopyTile<uint16_t>(dst, src, rows, cols, dst_row_stride, src_row_stride,
+                       src_col_stride);
+    break;
+  case 4:
+    CopyTile<uint32_t>(dst, src, rows, cols, dst_row_stride, src_row_stride,
+                       src_col_stride);
+    break;
+  case 8:
+    CopyTile<uint64_t>(dst, src, rows, cols, dst_row_stride, src_row_stride,
+                       src_col_stride);
+    break;
+  default:
+    for (int64_t i = 0; i < rows; i++) {
+      for (int64_t j = 0; j < cols; j++) {
+        std::memcpy(dst + i * dst_row_stride + j * elem_size,
+                    src + i * src_row_stride + j * src_col_stride, elem_size);
+      }
+    }
+  }
+}
+
+// Copy one row with a loop the compiler can vectorize for the row sizes of
+// common feature tensors, falling back to memcpy otherwise
+template <typename T>
+inline void CopyRow(char *dst, const char *src, int64_t row_bytes) {
+  auto d = reinterpret_cast<T *>(dst);
+  auto s = reinterpret_cast<const T *>(src);
+  int64_t n = row_bytes / sizeof(T);
+  for (int64_t i = 0; i < n; i++) {
+    d[i] = s[i];
+  }
+}
+
+// Checked up front on the calling thread: a fatal error inside a pool worker
+// could not be reported back to the caller
+template <typename IdType>
+void CheckIndexRange(const IdType *index, int64_t num_indices,
+                     int64_t num_rows) {
+  IdType min_index = 0;
+  IdType max_index = 0;
+  for (int64_t i = 0; i < num_indices; i++) {
+    min_index = std::min(min_index, index[i]);
+    max_index = std::max(max_index, index[i]);
+  }
+  CHECK(min_index >= 0 && (num_indices == 0 || max_index < num_rows))
+      << "Index out of range [" << min_index << ", " << max_index
+      << "] for " << num_rows << " rows";
+}
+
+template <typename IdType>
+void GatherRowsImpl(char *dst, const char *src, int64_t row_bytes, const IdType *index, int64_t begin,
+                    int64_t end) {
+  for (int64_t i = begin; i < end; i++) {
+    int64_t row = index[i];
+    if (i + kPrefetchDistance < end) {
+      const char *ahead = src + index[i + kPrefetchDistance] * row_bytes;
+      for (int64_t off = 0; off < row_bytes && off < 256; off += 64) {
+        __builtin_prefetch(ahead + off);
+      }
+    }
+    char *d = dst + i * row_bytes;
+    const char *s = src + row * row_bytes;
+    if (row_bytes <= 256 && row_bytes % 8 == 0) {
+      CopyRow<uint64_t>(d, s, row_bytes);
+    } else if (row_bytes <= 256 && row_bytes % 4 == 0) {
+      CopyRow<uint32_t>(d, s, row_bytes);
+    } else {
+      std::memcpy(d, s, row_bytes);
+    }
+  }
+}
+
+} // namespace
+
+void GatherRows(void *dst, const void *src, int64_t num_rows,
+                int64_t row_bytes, const DLTensor &index, int num_threads) {
+  CHECK(index.ctx.device_type == kDLCPU) << "Index must be a CPU tensor";
+  CHECK_EQ(index.ndim, 1) << "Index must be 1-D";
+  CHECK(index.strides == nullptr || index.shape[0] <= 1 ||
+        index.strides[0] == 1)
+      << "Index must be contiguous";
+  CHECK(index.dtype.code == kDLInt &&
+        (index.dtype.bits == 32 || index.dtype.bits == 64))
+      << "Index must be int32 or int64";
+  int64_t num_indices = index.shape[0];
+  auto index_ptr = static_cast<const char *>(index.data) + index.byte_offset;
+  auto dst_ptr = static_cast<char *>(dst);
+  auto src_ptr = static_cast<const char *>(src);
+  if (index.dtype.bits == 32) {
+    CheckIndexRange(reinterpret_cast<const int32_t *>(index_ptr), num_indices,
+                    num_rows);
+  } else {
+    CheckIndexRange(reinterpret_cast<const int64_t *>(index_ptr), num_indices,
+                    num_rows);
+  }
+  if (num_threads <= 0) {
+    num_threads = CopyEngine::Global().NumThreadsFor(num_indices * row_bytes);
+  }
+  CopyEngine::Global().ParallelFor(
+      num_indices, num_threads,
+      [&](int64_t begin, int64_t end) {
+        if (index.dtype.bits == 32) {
+          GatherRowsImpl(dst_ptr, src_ptr, row_bytes,
+                         reinterpret_cast<const int32_t *>(index_ptr), begin,
+                         end);
+        } else {
+          GatherRowsImpl(dst_ptr, src_ptr, row_bytes,
+                         reinterpret_cast<const int64_t *>(index_ptr), begin,
+                         end);
+        }
+      },
+      dst);
+}
+
+void StridedCopy(void *dst, const DLTensor &src, int num_threads) {
+  CHECK(src.ctx.device_type == kDLCPU)
+      << "Strided copy only supports CPU tensors";
+  CopyLayout layout = CollapseLayout(src);
+  int64_t total_size = GetDataSize(src.dtype, src.shape, src.ndim);
+  auto src_ptr = static_cast<const char *>(src.data) + src.byte_offset;
+  auto dst_ptr = static_cast<char *>(dst);
+  if (total_size == 0) {
+    return;
+  }
+  if (num_threads <= 0) {
+    num_threads = CopyEngine::Global().NumThreadsFor(total_size);
+  }
+  if (layout.ndim == 0) {
+    std::memcpy(dst_ptr, src_ptr, layout.elem_size);
+    return;
+  }
+
+  int last = layout.ndim - 1;
+  int64_t inner = layout.shape[last];
+  if (layout.strides[last] == layout.elem_size) {
+    // Innermost dim is dense: one memcpy per row
+    int64_t row_bytes = inner * layout.elem_size;
+    int64_t rows = total_size / row_bytes;
+    CopyEngine::Global().ParallelFor(
+        rows, num_threads,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t r = begin; r < end; r++) {
+            std::memcpy(dst_ptr + r * row_bytes,
+                        src_ptr + OuterOffset(layout, last, r), row_bytes);
+          }
+        },
+        dst);
+    return;
+  }
+
+  // Copy the last two dims in square tiles so that both the strided reads and
+  // the dense writes stay within a few cache lines
+  int64_t rows = layout.ndim >= 2 ? layout.shape[last - 1] : 1;
+  int64_t src_row_stride = layout.ndim >= 2 ? layout.strides[last - 1] : 0;
+  int64_t src_col_stride = layout.strides[last];
+  int64_t dst_row_stride = inner * layout.elem_size;
+  int outer_ndim = std::max(layout.ndim - 2, 0);
+  int64_t outer = total_size / (rows * dst_row_stride);
+  int64_t row_tiles = (rows + kTileSize - 1) / kTileSize;
+  CopyEngine::Global().ParallelFor(
+      outer * row_tiles, num_threads,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t task = begin; task < end; task++) {
+          int64_t o = task / row_tiles;
+          int64_t i0 = (task % row_tiles) * kTileSize;
+          int64_t tile_rows = std::min(kTileSize, rows - i0);
+          const char *src_base = src_ptr + OuterOffset(layout, outer_ndim, o) +
+                                 i0 * src_row_stride;
+          char *dst_base = dst_ptr + (o * rows + i0) * dst_row_stride;
+          for (int64_t j0 = 0; j0 < inner; j0 += kTileSize) {
+            int64_t tile_cols = std::min(kTileSize, inner - j0);
+            CopyTileBytes(dst_base + j0 * layout.elem_size,
+                          src_base + j0 * src_col_stride, tile_rows, tile_cols,
+                          layout.elem_size, dst_row_stride, src_row_stride,
+                          src_col_stride);
+          }
+        }
+      },
+      dst);
+}
+
+} // namespace vovp
@@ -0,0 +1,245 @@
+#include "vovp/dedup.h"
+#include "vovp/copy_engine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace vovp {
+
+namespace {
+
+constexpr int64_t kStripe = 64;
+constexpr int kLanes = 8;
+// Inputs are hashed in chunks of this size, independently of the threads
+constexpr int64_t kHashChunk = 1 << 20;
+constexpr uint64_t kSecret[kLanes] = {
+    0xbe4ba423396cfeb8ULL, 0x1cad21f72c81017cULL, 0xdb979083e96dd4deULL,
+    0x1f67b3b7a4a44072ULL, 0x78e5c0cc4ee679cbULL, 0x2172ffcc7dd05a82ULL,
+    0x8e2443f7744608b8ULL, 0x4c263a81e69035e0ULL};
+// Added to the keys at every stripe, so that the digest depends on where
+// each stripe is and not only on which stripes there are
+constexpr uint64_t kStripeStep = 0x9e3779b97f4a7c15ULL;
+// Start of the ID of deduplicated objects, followed by the digest
+constexpr char kDedupPrefix[4] = {'V', 'D', 'U', 'P'};
+constexpr char kAliasCountPrefix[4] = {'V', 'C', 'N', 'T'};
+
+uint64_t Mix(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+// acc[j] += v + lo32(k) * hi32(k) with k = v ^ key[j], for the 8 lanes of
+// each of `num_stripes` stripes. `keys` holds the keys of the first stripe
+// and is advanced past the last one.
+void Accumulate(uint64_t *acc, uint64_t *keys, const uint8_t *data,
+                int64_t num_stripes) {
+#ifdef __SSE2__
+  __m128i vacc[kLanes / 2];
+  __m128i vkeys[kLanes / 2];
+  for (int j = 0; j < kLanes / 2; j++) {
+    vacc[j] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc) + j);
+    vkeys[j] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys) + j);
+  }
+  const __m128i step = _mm_set1_epi64x(static_cast<long long>(kStripeStep));
+  for (int64_t s = 0; s < num_stripes; s++) {
+    auto stripe = reinterpret_cast<const __m128i *>(data + s * kStripe);
+    for (int j = 0; j < kLanes / 2; j++) {
+      __m128i v = _mm_loadu_si128(stripe + j);
+      __m128i k = _mm_xor_si128(v, vkeys[j]);
+      __m128i product = _mm_mul_epu32(k, _mm_srli_epi64(k, 32));
+      vacc[j] = _mm_add_epi64(vacc[j], _mm_add_epi64(v, product));
+      vkeys[j] = _mm_add_epi64(vkeys[j], step);
+    }
+  }
+  for (int j = 0; j < kLanes / 2; j++) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(acc) + j, vacc[j]);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(keys) + j, vkeys[j]);
+  }
+#else
+  for (int64_t s = 0; s < num_stripes; s++) {
+    for (int j = 0; j < kLanes; j++) {
+      uint64_t v;
+      std::memcpy(&v, data + s * kStripe + j * 8, sizeof(v));
+      uint64_t k = v ^ keys[j];
+      acc[j] += v + (k & 0xffffffffULL) * (k >> 32);
+      keys[j] += kStripeStep;
+    }
+  }
+#endif
+}
+
+ContentDigest HashChunk(const uint8_t *data, int64_t size, uint64_t seed) {
+  uint64_t acc[kLanes];
+  uint64_t keys[kLanes];
+  for (int j = 0; j < kLanes; j++) {
+    acc[j] = kSecret[j] ^ seed;
+    keys[j] = kSecret[(j + 3) % kLanes];
+  }
+  int64_t num_stripes = size / kStripe;
+  Accumulate(acc, keys, data, num_stripes);
+  int64_t tail = size - num_stripes * kStripe;
+  if (tail > 0) {
+    // Zero padded, the size below tells the padding from data
+    uint8_t last[kStripe] = {0};
+    std::memcpy(last, data + num_stripes * kStripe, tail);
+    Accumulate(acc, keys, last, 1);
+  }
+  ContentDigest digest;
+  digest.lo = Mix(static_cast<uint64_t>(size) ^ seed);
+  digest.hi = Mix(digest.lo + kStripeStep);
+  for (int j = 0; j < kLanes; j++) {
+    digest.lo = Mix(digest.lo ^ acc[j]);
+    digest.hi = Mix(digest.hi + acc[kLanes - 1 - j]);
+  }
+  return digest;
+}
+
+} // namespace
+
+ContentDigest ContentHash(const void *data, int64_t size, uint64_t seed) {
+  auto bytes = static_cast<const uint8_t *>(data);
+  if (size <= kHashChunk) {
+    return HashChunk(bytes, size, seed);
+  }
+  int64_t num_chunks = (size + kHashChunk - 1) / kHashChunk;
+  std::vector<ContentDigest> digests(num_chunks);
+  auto &engine = CopyEngine::Global();
+  engine.ParallelFor(
+      num_chunks, engine.NumThreadsFor(size),
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; i++) {
+          int64_t offset = i * kHashChunk;
+          digests[i] = HashChunk(bytes + offset,
+                                 std::min(kHashChunk, size - offset),
+                                 seed + static_cast<uint64_t>(i));
+        }
+      },
+      data);
+  return HashChunk(reinterpret_cast<const uint8_t *>(digests.data()),
+                   num_chunks * sizeof(ContentDigest),
+                   seed ^ static_cast<uint64_t>(size));
+}
+
+bool ContentEqual(const void *a, const void *b, int64_t size) {
+  auto lhs = static_cast<const char *>(a);
+  auto rhs = static_cast<const char *>(b);
+  int64_t num_chunks = (size + kHashChunk - 1) / kHashChunk;
+  std::atomic<bool> differ{false};
+  auto &engine = CopyEngine::Global();
+  engine.ParallelFor(
+      num_chunks, engine.NumThreadsFor(size),
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin;
+             i < end && !differ.load(std::memory_order_relaxed); i++) {
+          int64_t offset = i * kHashChunk;
+          if (std::memcmp(lhs + offset, rhs + offset,
+                          std::min(kHashChunk, size - offset)) != 0) {
+            differ.store(true, std::memory_order_relaxed);
+          }
+        }
+      },
+      a);
+  return !differ;
+}
+
+plasma::ObjectID DedupObjectID(const ContentDigest &digest) {
+  static_assert(sizeof(kDedupPrefix) + sizeof(ContentDigest) ==
+                    plasma::kUniqueIDSize,
+                "Deduplicated IDs must fill an ObjectID");
+  plasma::ObjectID object_id;
+  std::memcpy(object_id.mutable_data(), kDedupPrefix, sizeof(kDedupPrefix));
+  std::memcpy(object_id.mutable_data() + sizeof(kDedupPrefix), &digest,
+              sizeof(digest));
+  return object_id;
+}
+
+plasma::ObjectID AliasCountID(const plasma::ObjectID &shared_id) {
+  plasma::ObjectID object_id = shared_id;
+  std::memcpy(object_id.mutable_data(), kAliasCountPrefix,
+              sizeof(kAliasCountPrefix));
+  return object_id;
+}
+
+void InitAliasCount(uint8_t *buffer) {
+  std::memset(buffer, 0, sizeof(AliasCount));
+  auto count = new (buffer) AliasCount();
+  count->magic = kAliasCountMagic;
+  count->count.store(0, std::memory_order_release);
+}
+
+AliasCount *FindAliasCount(const uint8_t *buffer, int64_t size) {
+  if (size != static_cast<int64_t>(sizeof(AliasCount))) {
+    return nullptr;
+  }
+  auto count = reinterpret_cast<AliasCount *>(const_cast<uint8_t *>(buffer));
+  if (count->magic != kAliasCountMagic) {
+    return nullptr;
+  }
+  return count;
+}
+
+bool AddAlias(AliasCount *count) {
+  int64_t value = count->count.load(std::memory_order_relaxed);
+  while (value >= 0) {
+    if (count->count.compare_exchange_weak(value, value + 1,
+                                           std::memory_order_acq_rel)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool RemoveAlias(AliasCount *count) {
+  int64_t value = count->count.load(std::memory_order_relaxed);
+  while (value > 0) {
+    // The last one marks the shared object as being deleted
+    int64_t next = value == 1 ? -1 : value - 1;
+    if (count->count.compare_exchange_weak(value, next,
+                                           std::memory_order_acq_rel)) {
+      return value == 1;
+    }
+  }
+  return false;
+}
+
+std::string EncodeAliasHeader(const plasma::ObjectID &target) {
+  AliasHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = kAliasMagic;
+  std::memcpy(header.target, target.data(), sizeof(header.target));
+  return std::string(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+bool DecodeAliasHeader(const uint8_t *data, int64_t size,
+                       plasma::ObjectID *target) {
+  AliasHeader header;
+  if (size != static_cast<int64_t>(sizeof(header))) {
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (header.magic != kAliasMagic) {
+    return false;
+  }
+  std::memcpy(target->mutable_data(), header.target, sizeof(header.target));
+  return true;
+}
+
+bool MarkAliasDropped(const uint8_t *data) {
+  auto dropped = reinterpret_cast<uint32_t *>(
+      const_cast<uint8_t *>(data) + offsetof(AliasHeader, dropped));
+  return __atomic_exchange_n(dropped, 1, __ATOMIC_ACQ_REL) == 0;
+}
+
+} // namespace vovp
@@ -1,6 +1,11 @@
 #include "dlpack/dlpack.h"
 #include <pybind11/pybind11.h>
 #include <pybind11/pytypes.h>
+#include <pybind11/stl.h>
+#include <chrono>
+#include <future>
+#include <vovp/copy_engine.h>
+#include <vovp/metrics.h>
 #include <vovp/plasma_manager.h>
 #include <vovp/utils.h>
 #define STRINGIFY(x) #x
@@ -21,6 +26,61 @@ void DlpackCapsuleDestructor(PyObject *capsule) {
   }
 }
 
+// Python handle of an async put/get. The result capsule can be taken once;
+// a result that is never taken is freed with the future.
+struct TensorFuture {
+  std::future<DLManagedTensor *> future;
+  // Source tensor of a put, freed as soon as the copy is done
+  DLManagedTensor *source = nullptr;
+  bool taken = false;
+
+  ~TensorFuture() {
+    if (taken || !future.valid()) {
+      return;
+    }
+    {
+      py::gil_scoped_release release;
+      future.wait();
+    }
+    FreeSource();
+    try {
+      auto dlm_ptr = future.get();
+      if (dlm_ptr->deleter != nullptr) {
+        dlm_ptr->deleter(dlm_ptr);
+      }
+    } catch (const std::exception &e) {
+      LOG(WARNING) << "Discarded async tensor failed: " << e.what();
+    }
+  }
+
+  bool Done() {
+    return future.wait_for(std::chrono::seconds(0)) ==
+           std::future_status::ready;
+  }
+
+  void Wait() { future.wait(); }
+
+  py::capsule Result() {
+    CHECK(!taken) << "Result of this future was already taken";
+    {
+      py::gil_scoped_release release;
+      future.wait();
+    }
+    FreeSource();
+    taken = true;
+    // Rethrows the error of a failed put/get
+    auto dlm_ptr = future.get();
+    return py::capsule(dlm_ptr, "dltensor", &DlpackCapsuleDestructor);
+  }
+
+  void FreeSource() {
+    if (source != nullptr && source->deleter != nullptr) {
+      source->deleter(source);
+    }
+    source = nullptr;
+  }
+};
+
 ObjectID BytesToObjectID(std::string &object_id) {
   return ToObjectID(object_id);
 }
@@ -29,8 +89,40 @@ ObjectID BytesToObjectID(std::string &object_id) {
 PYBIND11_MODULE(_vovp, m) {
 
   using namespace vovp;
+  py::register_exception<vovp::ObjectTimeoutError>(m, "ObjectTimeoutError",
+                                                   PyExc_TimeoutError);
+
   py::class_<vovp::VovpPlasmaManager>(m, "VovpPlasmaClient")
-      .def(py::init<const std::string &>())
+      .def(py::init<const std::string &, int>(), py::arg("socket_name"),
+           py::arg("num_connections") =
+               vovp::VovpPlasmaManager::kDefaultConnections)
+      .def(py::init<const std::vector<std::string> &, const std::vector<int> &,
+                    int>(),
+           py::arg("socket_names"), py::arg("nodes"),
+           py::arg("num_connections") =
+               vovp::VovpPlasmaManager::kDefaultConnections)
+      .def("set_placement",
+           [](vovp::VovpPlasmaManager &manager, std::string placement) {
+             CHECK(placement == "local" || placement == "interleave")
+                 << "Unknown placement " << placement
+                 << ", expected local or interleave";
+             manager.SetPlacement(placement == "local"
+                                      ? vovp::Placement::kLocal
+                                      : vovp::Placement::kInterleave);
+           })
+      .def("set_node_hint", &vovp::VovpPlasmaManager::SetNodeHint)
+      .def("num_stores", &vovp::VovpPlasmaManager::NumStores)
+      .def("replicate",
+           [](vovp::VovpPlasmaManager &manager, std::string object_id) {
+             ObjectID plasma_object_id = ToObjectID(object_id);
+             return manager.Replicate(plasma_object_id);
+           },
+           py::call_guard<py::gil_scoped_release>())
+      .def("object_nodes",
+           [](vovp::VovpPlasmaManager &manager, std::string object_id) {
+             return manager.ObjectNodes(ToObjectID(object_id));
+           },
+           py::call_guard<py::gil_scoped_release>())
       .def("put_tensor",
            [](vovp::VovpPlasmaManager &manager, const py::capsule &pycapsule,
               std::string object_id, 
@@ -38,9 +130,13 @@ PYBIND11_MODULE(_vovp, m) {
              auto *dlm_ptr =
                  reinterpret_cast<DLManagedTensor *>(pycapsule.get_pointer());
              ObjectID plasma_object_id = ToObjectID(object_id);
-             DLManagedTensor *new_dlm_ptr = manager.PutDlpackTensor(
-                 dlm_ptr, plasma_object_id, 
-                 try_delete_when_destruct, try_delete_before_create);
+             DLManagedTensor *new_dlm_ptr;
+             {
+               py::gil_scoped_release release;
+               new_dlm_ptr = manager.PutDlpackTensor(
+                   dlm_ptr, plasma_object_id, try_delete_when_destruct,
+                   try_delete_before_create);
+             }
 
              PyCapsule_SetName(pycapsule.ptr(), "used_dltensor");
              PyCapsule_SetDestructor(pycapsule.ptr(), nullptr);
@@ -51,36 +147,431 @@ PYBIND11_MODULE(_vovp, m) {
                                      &DlpackCapsuleDestructor);
              return new_capsule;
            })
+      .def("put_dedup_tensor",
+           [](vovp::VovpPlasmaManager &manager, const py::capsule &pycapsule,
+              std::string object_id, bool try_delete_before_create) {
+             auto *dlm_ptr =
+                 reinterpret_cast<DLManagedTensor *>(pycapsule.get_pointer());
+             ObjectID plasma_object_id = ToObjectID(object_id);
+             DLManagedTensor *new_dlm_ptr;
+             {
+               py::gil_scoped_release release;
+               new_dlm_ptr = manager.PutDedupTensor(dlm_ptr, plasma_object_id,
+                                                    try_delete_before_create);
+             }
+
+             PyCapsule_SetName(pycapsule.ptr(), "used_dltensor");
+             PyCapsule_SetDestructor(pycapsule.ptr(), nullptr);
+             if (dlm_ptr->deleter != nullptr) {
+               dlm_ptr->deleter(dlm_ptr);
+             }
+             return py::capsule(new_dlm_ptr, "dltensor",
+                                &DlpackCapsuleDestructor);
+           })
       .def("get_tensor",
-           [](vovp::VovpPlasmaManager &manager, std::string object_id) {
+           [](vovp::VovpPlasmaManager &manager, std::string object_id,
+              int64_t timeout_ms, bool try_delete_when_destruct) {
              ObjectID plasma_object_id = ToObjectID(object_id);
-             auto *dlm_ptr = manager.GetDlpackTensor(plasma_object_id);
+             DLManagedTensor *dlm_ptr;
+             {
+               py::gil_scoped_release release;
+               dlm_ptr = manager.GetDlpackTensor(plasma_object_id, timeout_ms,
+                                                 try_delete_when_destruct);
+             }
 
              py::capsule new_capsule(dlm_ptr, "dltensor",
                                      &DlpackCapsuleDestructor);
              return new_capsule;
-           })
-      .def("create_tensor",
+           },
+           py::arg("object_id"), py::arg("timeout_ms") = 1000,
+           py::arg("try_delete_when_destruct") = true)
+      .def("wait_tensor",
            [](vovp::VovpPlasmaManager &manager, std::string object_id,
-              std::vector<int64_t> shape, uint8_t dtype_code,
-              uint8_t dtype_bits, std::string device_str, int device_id) {
-             DLDataType dtype = {
-                 .code = dtype_code, .bits = dtype_bits, .lanes = 1};
-             DLContext ctx;
-             if (device_str == "cpu") {
-               ctx = {.device_type = kDLCPU, .device_id = 0};
-             } else if (device_str == "cuda" or device_str == "gpu") {
-               ctx = {.device_type = kDLGPU, .device_id = device_id};
+              int64_t timeout_ms) {
+             return manager.WaitTensor(ToObjectID(object_id), timeout_ms);
+           },
+           py::call_guard<py::gil_scoped_release>())
+      .def("wait_any",
+           [](vovp::VovpPlasmaManager &manager,
+              std::vector<std::string> object_ids, int64_t timeout_ms) {
+             std::vector<ObjectID> plasma_object_ids;
+             for (auto &object_id : object_ids) {
+               plasma_object_ids.push_back(ToObjectID(object_id));
              }
-
+             return manager.WaitAny(plasma_object_ids, timeout_ms);
+           },
+           py::call_guard<py::gil_scoped_release>())
+      .def("update_tensor",
+           [](vovp::VovpPlasmaManager &manager, const py::capsule &pycapsule,
+              std::string object_id) {
+             auto *dlm_ptr =
+                 reinterpret_cast<DLManagedTensor *>(pycapsule.get_pointer());
              ObjectID plasma_object_id = ToObjectID(object_id);
-             auto *dlm_ptr = manager.CreateTensor(
-                 plasma_object_id, shape.data(), shape.size(), dtype, ctx);
+             DLManagedTensor *new_dlm_ptr;
+             bool in_place;
+             {
+               py::gil_scoped_release release;
+               new_dlm_ptr = manager.UpdateDlpackTensor(
+                   dlm_ptr, plasma_object_id, &in_place);
+             }
 
+             PyCapsule_SetName(pycapsule.ptr(), "used_dltensor");
+             PyCapsule_SetDestructor(pycapsule.ptr(), nullptr);
+             if (dlm_ptr->deleter != nullptr) {
+               dlm_ptr->deleter(dlm_ptr);
+             }
+             py::capsule new_capsule(new_dlm_ptr, "dltensor",
+                                     &DlpackCapsuleDestructor);
+             return py::make_tuple(new_capsule, in_place);
+           })
+      .def("read_tensor",
+           [](vovp::VovpPlasmaManager &manager, std::string object_id) {
+             ObjectID plasma_object_id = ToObjectID(object_id);
+             DLManagedTensor *dlm_ptr;
+             uint64_t version;
+             {
+               py::gil_scoped_release release;
+               dlm_ptr = manager.ReadDlpackTensor(plasma_object_id, &version);
+             }
              py::capsule new_capsule(dlm_ptr, "dltensor",
                                      &DlpackCapsuleDestructor);
-             return new_capsule;
+             return py::make_tuple(new_capsule, version);
+           })
+      .def(
+          "put_compressed",
+          [](vovp::VovpPlasmaManager &manager, std::string object_id,
+             py::capsule dlpack_tensor, std::string codec, int64_t block_size,
+             bool try_delete_before_create) {
+            auto dlm_tensor = reinterpret_cast<DLManagedTensor *>(
+                dlpack_tensor.get_pointer());
+            ObjectID plasma_object_id = ToObjectID(object_id);
+            py::gil_scoped_release release;
+            manager.PutCompressedTensor(dlm_tensor, plasma_object_id, codec,
+                                        block_size, try_delete_before_create);
+          },
+          py::arg("object_id"), py::arg("tensor"), py::arg("codec") = "lz4",
+          py::arg("block_size") = vovp::kDefaultCompressionBlock,
+          py::arg("try_delete_before_create") = true)
+      .def("read_tensor_rows",
+           [](vovp::VovpPlasmaManager &manager, std::string object_id,
+              int64_t start, int64_t stop) {
+             ObjectID plasma_object_id = ToObjectID(object_id);
+             DLManagedTensor *dlm_ptr;
+             {
+               py::gil_scoped_release release;
+               dlm_ptr = manager.ReadTensorRows(plasma_object_id, start, stop);
+             }
+             return py::capsule(dlm_ptr, "dltensor", &DlpackCapsuleDestructor);
            })
+      .def("compression_info",
+           [](vovp::VovpPlasmaManager &manager,
+              std::string object_id) -> py::object {
+             ObjectID plasma_object_id = ToObjectID(object_id);
+             vovp::CompressedHeader header;
+             int64_t compressed_size;
+             bool compressed;
+             {
+               py::gil_scoped_release release;
+               compressed = manager.CompressionInfo(plasma_object_id, &header,
+                                                    &compressed_size);
+             }
+             if (!compressed) {
+               return py::none();
+             }
+             py::dict info;
+             info["codec"] = vovp::CompressionName(header.codec);
+             info["block_size"] = header.block_size;
+             info["num_blocks"] = header.num_blocks;
+             info["raw_size"] = header.raw_size;
+             info["compressed_size"] = compressed_size;
+             return std::move(info);
+           })
+      .def("tensor_version",
+           [](vovp::VovpPlasmaManager &manager, std::string object_id) {
+             ObjectID plasma_object_id = ToObjectID(object_id);
+             return manager.TensorVersion(plasma_object_id);
+           },
+           py::call_guard<py::gil_scoped_release>())
+      .def(
+          "put_bundle",
+          [](vovp::VovpPlasmaManager &manager, std::string object_id,
+             const py::dict &members, bool try_delete_before_create) {
+            // Members are copied, the capsules stay with the caller
+            std::vector<std::string> names;
+            std::vector<DLManagedTensor *> tensors;
+            for (auto item : members) {
+              names.push_back(item.first.cast<std::string>());
+              tensors.push_back(reinterpret_cast<DLManagedTensor *>(
+                  item.second.cast<py::capsule>().get_pointer()));
+            }
+            ObjectID plasma_object_id = ToObjectID(object_id);
+            py::gil_scoped_release release;
+            manager.PutBundle(plasma_object_id, names, tensors,
+                              try_delete_before_create);
+          },
+          py::arg("object_id"), py::arg("members"),
+          py::arg("try_delete_before_create") = true)
+      .def("get_bundle",
+           [](vovp::VovpPlasmaManager &manager, std::string object_id) {
+             ObjectID plasma_object_id = ToObjectID(object_id);
+             std::vector<std::pair<std::string, DLManagedTensor *>> members;
+             {
+               py::gil_scoped_release release;
+               members = manager.GetBundle(plasma_object_id);
+             }
+             py::dict result;
+             for (auto &member : members) {
+               result[py::str(member.first)] = py::capsule(
+                   member.second, "dltensor", &DlpackCapsuleDestructor);
+             }
+             return result;
+           })
+      .def(
+          "put_sparse",
+          [](vovp::VovpPlasmaManager &manager, std::string object_id,
+             std::string format, int64_t num_rows, int64_t num_cols,
+             py::capsule first, py::capsule second, py::object values,
+             bool delta_encode, bool try_delete_before_create) {
+            CHECK(format == "csr" || format == "coo")
+                << "Unknown sparse format " << format
+                << ", expected csr or coo";
+            // Arrays are copied, the capsules stay with the caller
+            DLManagedTensor *values_ptr = nullptr;
+            if (!values.is_none()) {
+              values_ptr = reinterpret_cast<DLManagedTensor *>(
+                  values.cast<py::capsule>().get_pointer());
+            }
+            ObjectID plasma_object_id = ToObjectID(object_id);
+            py::gil_scoped_release release;
+            manager.PutSparse(
+                plasma_object_id,
+                format == "csr" ? vovp::SparseFormat::kCSR
+                                : vovp::SparseFormat::kCOO,
+                num_rows, num_cols,
+                reinterpret_cast<DLManagedTensor *>(first.get_pointer()),
+                reinterpret_cast<DLManagedTensor *>(second.get_pointer()),
+                values_ptr, delta_encode, try_delete_before_create);
+          },
+          py::arg("object_id"), py::arg("format"), py::arg("num_rows"),
+          py::arg("num_cols"), py::arg("first"), py::arg("second"),
+          py::arg("values") = py::none(), py::arg("delta_encode") = false,
+          py::arg("try_delete_before_create") = true)
+      .def("get_sparse",
+           [](vovp::VovpPlasmaManager &manager, std::string object_id) {
+             ObjectID plasma_object_id = ToObjectID(object_id);
+             vovp::SparseHeader header;
+             std::vector<std::pair<std::string, DLManagedTensor *>> arrays;
+             {
+               py::gil_scoped_release release;
+               arrays = manager.GetSparse(plasma_object_id, &header);
+             }
+             py::dict result;
+             result["format"] =
+                 header.format == static_cast<uint8_t>(vovp::SparseFormat::kCSR)
+                     ? "csr"
+                     : "coo";
+             result["shape"] = py::make_tuple(header.num_rows, header.num_cols);
+             result["nnz"] = header.nnz;
+             py::dict capsules;
+             py::dict encodings;
+             for (size_t i = 0; i < arrays.size(); i++) {
+               capsules[py::str(arrays[i].first)] = py::capsule(
+                   arrays[i].second, "dltensor", &DlpackCapsuleDestructor);
+               encodings[py::str(arrays[i].first)] =
+                   header.arrays[i].encoding == vovp::kSparseRowDelta
+                       ? "row_delta"
+                       : "plain";
+             }
+             result["arrays"] = capsules;
+             result["encodings"] = encodings;
+             return result;
+           })
+      .def("transpose_sparse",
+           [](vovp::VovpPlasmaManager &manager, std::string object_id,
+              std::string out_object_id, bool try_delete_before_create) {
+             ObjectID plasma_object_id = ToObjectID(object_id);
+             ObjectID out_plasma_object_id = ToObjectID(out_object_id);
+             manager.TransposeSparse(plasma_object_id, out_plasma_object_id,
+                                     try_delete_before_create);
+           },
+           py::arg("object_id"), py::arg("out_object_id"),
+           py::arg("try_delete_before_create") = true,
+           py::call_guard<py::gil_scoped_release>())
+      .def("slice_sparse_rows",
+           [](vovp::VovpPlasmaManager &manager, std::string object_id,
+              py::capsule rows) {
+             ObjectID plasma_object_id = ToObjectID(object_id);
+             auto rows_ptr =
+                 reinterpret_cast<DLManagedTensor *>(rows.get_pointer());
+             std::vector<std::pair<std::string, DLManagedTensor *>> arrays;
+             {
+               py::gil_scoped_release release;
+               arrays = manager.SliceSparseRows(plasma_object_id, rows_ptr);
+             }
+             py::dict result;
+             for (auto &array : arrays) {
+               result[py::str(array.first)] = py::capsule(
+                   array.second, "dltensor", &DlpackCapsuleDestructor);
+             }
+             return result;
+           })
+      .def("put_tensors",
+           [](vovp::VovpPlasmaManager &manager, const py::list &pycapsules,
+              std::vector<std::string> object_ids,
+              bool try_delete_when_destruct, bool try_delete_before_create) {
+             CHECK_EQ(pycapsules.size(), object_ids.size());
+             std::vector<DLManagedTensor *> dlm_ptrs;
+             std::vector<ObjectID> plasma_object_ids;
+             for (size_t i = 0; i < object_ids.size(); i++) {
+               auto pycapsule = pycapsules[i].cast<py::capsule>();
+               dlm_ptrs.push_back(reinterpret_cast<DLManagedTensor *>(
+                   pycapsule.get_pointer()));
+               plasma_object_ids.push_back(ToObjectID(object_ids[i]));
+             }
+             std::vector<DLManagedTensor *> new_dlm_ptrs;
+             {
+               py::gil_scoped_release release;
+               new_dlm_ptrs = manager.PutDlpackTensors(
+                   dlm_ptrs, plasma_object_ids, try_delete_when_destruct,
+                   try_delete_before_create);
+             }
+
+             py::list new_capsules;
+             for (size_t i = 0; i < object_ids.size(); i++) {
+               auto pycapsule = pycapsules[i].cast<py::capsule>();
+               PyCapsule_SetName(pycapsule.ptr(), "used_dltensor");
+               PyCapsule_SetDestructor(pycapsule.ptr(), nullptr);
+               if (dlm_ptrs[i]->deleter != nullptr) {
+                 dlm_ptrs[i]->deleter(dlm_ptrs[i]);
+               }
+               new_capsules.append(py::capsule(new_dlm_ptrs[i], "dltensor",
+                                               &DlpackCapsuleDestructor));
+             }
+             return new_capsules;
+           })
+      .def("get_tensors",
+           [](vovp::VovpPlasmaManager &manager,
+              std::vector<std::string> object_ids, int64_t timeout_ms) {
+             std::vector<ObjectID> plasma_object_ids;
+             for (auto &object_id : object_ids) {
+               plasma_object_ids.push_back(ToObjectID(object_id));
+             }
+             std::vector<DLManagedTensor *> dlm_ptrs;
+             {
+               py::gil_scoped_release release;
+               dlm_ptrs =
+                   manager.GetDlpackTensors(plasma_object_ids, timeout_ms);
+             }
+
+             py::list new_capsules;
+             for (auto *dlm_ptr : dlm_ptrs) {
+               new_capsules.append(
+                   py::capsule(dlm_ptr, "dltensor", &DlpackCapsuleDestructor));
+             }
+             return new_capsules;
+           },
+           py::arg("object_ids"), py::arg("timeout_ms") = 1000)
+      .def(
+          "create_tensor",
+          [](vovp::VovpPlasmaManager &manager, std::string object_id,
+             std::vector<int64_t> shape, uint8_t dtype_code,
+             uint8_t dtype_bits, std::string device_str, int device_id,
+             bool seal) {
+            DLDataType dtype = {
+                .code = dtype_code, .bits = dtype_bits, .lanes = 1};
+            DLContext ctx;
+            if (device_str == "cpu") {
+              ctx = {.device_type = kDLCPU, .device_id = 0};
+            } else if (device_str == "cuda" or device_str == "gpu") {
+              ctx = {.device_type = kDLGPU, .device_id = device_id};
+            }
+
+            ObjectID plasma_object_id = ToObjectID(object_id);
+            DLManagedTensor *dlm_ptr;
+            {
+              py::gil_scoped_release release;
+              dlm_ptr = manager.CreateTensor(plasma_object_id, shape.data(),
+                                             shape.size(), dtype, ctx, seal);
+            }
+
+            py::capsule new_capsule(dlm_ptr, "dltensor",
+                                    &DlpackCapsuleDestructor);
+            return new_capsule;
+          },
+          py::arg("object_id"), py::arg("shape"), py::arg("dtype_code"),
+          py::arg("dtype_bits"), py::arg("device_str"), py::arg("device_id"),
+          py::arg("seal") = true)
+      .def(
+          "seal",
+          [](vovp::VovpPlasmaManager &manager, std::string object_id) {
+            ObjectID plasma_object_id = ToObjectID(object_id);
+            manager.Seal(plasma_object_id);
+          },
+          py::call_guard<py::gil_scoped_release>())
+      .def(
+          "abort",
+          [](vovp::VovpPlasmaManager &manager, std::string object_id) {
+            ObjectID plasma_object_id = ToObjectID(object_id);
+            manager.Abort(plasma_object_id);
+          },
+          py::call_guard<py::gil_scoped_release>())
+      .def(
+          "put_tensor_async",
+          [](vovp::VovpPlasmaManager &manager, const py::capsule &pycapsule,
+             std::string object_id, bool try_delete_when_destruct,
+             bool try_delete_before_create) {
+            auto *dlm_ptr =
+                reinterpret_cast<DLManagedTensor *>(pycapsule.get_pointer());
+            // The future now owns the source tensor
+            PyCapsule_SetName(pycapsule.ptr(), "used_dltensor");
+            PyCapsule_SetDestructor(pycapsule.ptr(), nullptr);
+            auto future = std::make_shared<TensorFuture>();
+            future->source = dlm_ptr;
+            future->future = manager.PutDlpackTensorAsync(
+                dlm_ptr, ToObjectID(object_id), try_delete_when_destruct,
+                try_delete_before_create);
+            return future;
+          })
+      .def("get_tensor_async",
+           [](vovp::VovpPlasmaManager &manager, std::string object_id) {
+             auto future = std::make_shared<TensorFuture>();
+             future->future =
+                 manager.GetDlpackTensorAsync(ToObjectID(object_id));
+             return future;
+           })
+      .def(
+          "gather_rows",
+          [](vovp::VovpPlasmaManager &manager, std::string object_id,
+             const py::capsule &index_capsule, py::object out_capsule,
+             py::object out_object_id) -> py::object {
+            auto *index_ptr = reinterpret_cast<DLManagedTensor *>(
+                index_capsule.get_pointer());
+            DLManagedTensor *out_ptr = nullptr;
+            if (!out_capsule.is_none()) {
+              out_ptr = reinterpret_cast<DLManagedTensor *>(
+                  out_capsule.cast<py::capsule>().get_pointer());
+            }
+            ObjectID plasma_object_id = ToObjectID(object_id);
+            ObjectID plasma_out_id;
+            ObjectID *out_id_ptr = nullptr;
+            if (!out_object_id.is_none()) {
+              plasma_out_id = ToObjectID(out_object_id.cast<std::string>());
+              out_id_ptr = &plasma_out_id;
+            }
+            DLManagedTensor *result;
+            {
+              py::gil_scoped_release release;
+              result = manager.GatherRows(plasma_object_id, index_ptr, out_ptr,
+                                          out_id_ptr);
+            }
+            if (result == nullptr) {
+              return py::none();
+            }
+            return py::capsule(result, "dltensor", &DlpackCapsuleDestructor);
+          },
+          py::arg("object_id"), py::arg("index"), py::arg("out") = py::none(),
+          py::arg("out_object_id") = py::none())
+      .def("set_async_threads", &vovp::VovpPlasmaManager::SetAsyncThreads)
       .def("list",
            [](vovp::VovpPlasmaManager &manager) {
              ObjectTable table;
@@ -91,11 +582,220 @@ PYBIND11_MODULE(_vovp, m) {
                          << kv.second->ref_count;
              }
            })
-      .def("release",
-           [](vovp::VovpPlasmaManager &manager, std::string object_id) {
+      .def("flush", &vovp::VovpPlasmaManager::Flush,
+           py::call_guard<py::gil_scoped_release>())
+      .def("set_reclaim_options", &vovp::VovpPlasmaManager::SetReclaimOptions)
+      .def("cache_stats",
+           [](vovp::VovpPlasmaManager &manager) {
+             py::dict stats;
+             stats["hits"] = manager.object_cache.hits();
+             stats["misses"] = manager.object_cache.misses();
+             stats["entries"] = manager.object_cache.size();
+             return stats;
+           })
+      .def("stats",
+           [](vovp::VovpPlasmaManager &manager) {
+             py::dict stats;
+             stats["enabled"] = Metrics::kEnabled;
+             py::dict phases;
+             for (int i = 0; i < static_cast<int>(Phase::kNumPhases); i++) {
+               auto phase = static_cast<Phase>(i);
+               auto &latency = manager.metrics->Latency(phase);
+               uint64_t count = latency.Count();
+               if (count == 0) {
+                 continue;
+               }
+               py::dict entry;
+               entry["count"] = count;
+               entry["total_us"] = latency.SumNs() / 1e3;
+               entry["mean_us"] = latency.SumNs() / 1e3 / count;
+               entry["p50_us"] = latency.PercentileNs(0.5) / 1e3;
+               entry["p90_us"] = latency.PercentileNs(0.9) / 1e3;
+               entry["p99_us"] = latency.PercentileNs(0.99) / 1e3;
+               entry["max_us"] = latency.MaxNs() / 1e3;
+               entry["page_faults"] = manager.metrics->PageFaults(phase);
+               py::list histogram;
+               for (auto &bucket : latency.Buckets()) {
+                 histogram.append(
+                     py::make_tuple(bucket.first / 1e3, bucket.second));
+               }
+               entry["histogram"] = histogram;
+               phases[PhaseName(phase)] = entry;
+             }
+             stats["phases"] = phases;
+             py::dict bytes_copied;
+             bytes_copied["cpu"] = manager.metrics->CpuBytesCopied();
+             bytes_copied["gpu"] = manager.metrics->GpuBytesCopied();
+             stats["bytes_copied"] = bytes_copied;
+
+             int64_t live_tensors, live_bytes;
+             manager.ctx_pool->LiveStats(&live_tensors, &live_bytes);
+             stats["live_tensors"] = live_tensors;
+             stats["live_tensor_bytes"] = live_bytes;
+
+             // Store-wide occupancy, one round trip to the store
+             ObjectTable table;
+             {
+               py::gil_scoped_release release;
+               VOVP_CHECK_ARROW(manager.client->List(&table));
+             }
+             int64_t store_bytes = 0;
+             for (const auto &kv : table) {
+               store_bytes += kv.second->data_size + kv.second->metadata_size;
+             }
+             stats["store_objects"] = table.size();
+             stats["store_bytes"] = store_bytes;
+             stats["store_capacity"] = manager.client->store_capacity();
+
+             py::dict spill;
+             spill["enabled"] = static_cast<bool>(manager.spill);
+             if (manager.spill) {
+               spill["directory"] = manager.spill->directory();
+               spill["spilled_objects"] = manager.spill->spilled_objects();
+               spill["spilled_bytes"] = manager.spill->spilled_bytes();
+               spill["restored_objects"] = manager.spill->restored_objects();
+               spill["restored_bytes"] = manager.spill->restored_bytes();
+             }
+             stats["spill"] = spill;
+             return stats;
+           })
+      .def("open_channel",
+           [](vovp::VovpPlasmaManager &manager, std::string object_id,
+              int64_t num_slots, int64_t slot_bytes) {
              ObjectID plasma_object_id = ToObjectID(object_id);
-             manager.Release(plasma_object_id);
-           });
+             return manager.OpenChannel(plasma_object_id, num_slots,
+                                        slot_bytes);
+           },
+           py::call_guard<py::gil_scoped_release>())
+      .def("enable_spill", &vovp::VovpPlasmaManager::EnableSpill)
+      .def("prefetch",
+           [](vovp::VovpPlasmaManager &manager,
+              std::vector<std::string> object_ids) {
+             std::vector<ObjectID> plasma_object_ids;
+             for (auto &object_id : object_ids) {
+               plasma_object_ids.push_back(ToObjectID(object_id));
+             }
+             manager.Prefetch(plasma_object_ids);
+           })
+      .def("pin",
+           [](vovp::VovpPlasmaManager &manager, std::string object_id) {
+             manager.Pin(ToObjectID(object_id));
+           })
+      .def("unpin",
+           [](vovp::VovpPlasmaManager &manager, std::string object_id) {
+             manager.Unpin(ToObjectID(object_id));
+           })
+      .def(
+          "snapshot",
+          [](vovp::VovpPlasmaManager &manager, std::string path,
+             std::vector<std::string> object_ids) {
+            std::vector<ObjectID> plasma_object_ids;
+            for (auto &object_id : object_ids) {
+              plasma_object_ids.push_back(ToObjectID(object_id));
+            }
+            py::gil_scoped_release release;
+            return manager.Snapshot(path, plasma_object_ids);
+          },
+          py::arg("path"), py::arg("object_ids") = std::vector<std::string>())
+      .def("restore", &vovp::VovpPlasmaManager::Restore, py::arg("path"),
+           py::arg("use_mmap") = false,
+           py::call_guard<py::gil_scoped_release>())
+      .def("reset_stats",
+           [](vovp::VovpPlasmaManager &manager) { manager.metrics->Reset(); })
+      .def("reset_cache_stats",
+           [](vovp::VovpPlasmaManager &manager) {
+             manager.object_cache.ResetCounters();
+           })
+      .def("set_cache_enabled",
+           [](vovp::VovpPlasmaManager &manager, bool enabled) {
+             manager.object_cache.SetEnabled(enabled);
+           })
+      .def("set_copy_options",
+           [](vovp::VovpPlasmaManager &manager, int num_threads,
+              int64_t parallel_threshold, int64_t bytes_per_thread,
+              int64_t nontemporal_threshold, bool numa_pin,
+              int64_t prefault_threshold, int64_t huge_page_align_threshold) {
+             CopyOptions options;
+             options.num_threads = num_threads;
+             options.parallel_threshold = parallel_threshold;
+             options.bytes_per_thread = bytes_per_thread;
+             options.nontemporal_threshold = nontemporal_threshold;
+             options.numa_pin = numa_pin;
+             options.prefault_threshold = prefault_threshold;
+             options.huge_page_align_threshold = huge_page_align_threshold;
+             CopyEngine::Global().SetOptions(options);
+           })
+      .def("copy_options",
+           [](vovp::VovpPlasmaManager &manager) {
+             auto options = CopyEngine::Global().options();
+             py::dict ret;
+             ret["num_threads"] = options.num_threads;
+             ret["parallel_threshold"] = options.parallel_threshold;
+             ret["bytes_per_thread"] = options.bytes_per_thread;
+             ret["nontemporal_threshold"] = options.nontemporal_threshold;
+             ret["numa_pin"] = options.numa_pin;
+             ret["prefault_threshold"] = options.prefault_threshold;
+             ret["huge_page_align_threshold"] =
+                 options.huge_page_align_threshold;
+             return ret;
+           })
+      .def(
+          "release",
+          [](vovp::VovpPlasmaManager &manager, const py::capsule &pycapsule) {
+            manager.Release(
+                reinterpret_cast<DLManagedTensor *>(pycapsule.get_pointer()));
+          },
+          py::call_guard<py::gil_scoped_release>())
+      .def(
+          "delete",
+          [](vovp::VovpPlasmaManager &manager, std::string object_id) {
+            ObjectID plasma_object_id = ToObjectID(object_id);
+            manager.Delete(plasma_object_id);
+          },
+          py::call_guard<py::gil_scoped_release>());
+
+  py::class_<vovp::TensorChannel, std::shared_ptr<vovp::TensorChannel>>(
+      m, "TensorChannel")
+      .def("send",
+           [](vovp::TensorChannel &channel, const py::capsule &pycapsule,
+              int64_t timeout_ms) {
+             // The tensor is copied, the capsule stays with the caller
+             auto *dlm_ptr =
+                 reinterpret_cast<DLManagedTensor *>(pycapsule.get_pointer());
+             py::gil_scoped_release release;
+             return channel.Send(dlm_ptr, timeout_ms);
+           })
+      .def("recv",
+           [](vovp::TensorChannel &channel, int64_t timeout_ms,
+              py::object out_capsule) -> py::object {
+             DLManagedTensor *out = nullptr;
+             if (!out_capsule.is_none()) {
+               out = reinterpret_cast<DLManagedTensor *>(
+                   out_capsule.cast<py::capsule>().get_pointer());
+             }
+             DLManagedTensor *result = nullptr;
+             bool received;
+             {
+               py::gil_scoped_release release;
+               received = channel.Receive(timeout_ms, out, &result);
+             }
+             if (!received) {
+               return py::none();
+             }
+             if (result == nullptr) {
+               return py::bool_(true);
+             }
+             return py::capsule(result, "dltensor", &DlpackCapsuleDestructor);
+           })
+      .def("size", &vovp::TensorChannel::Size)
+      .def_property_readonly("num_slots", &vovp::TensorChannel::num_slots)
+      .def_property_readonly("slot_bytes", &vovp::TensorChannel::slot_bytes);
+
+  py::class_<TensorFuture, std::shared_ptr<TensorFuture>>(m, "TensorFuture")
+      .def("done", &TensorFuture::Done)
+      .def("wait", &TensorFuture::Wait,
+           py::call_guard<py::gil_scoped_release>())
+      .def("result", &TensorFuture::Result);
 
 #ifdef VERSION_INFO
   m.attr("__version__") = MACRO_STRINGIFY(VERSION_INFO);
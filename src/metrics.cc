@@ -0,0 +1,113 @@
+#include "vovp/metrics.h"
+#include <algorithm>
+#include <sys/resource.h>
+
+namespace vovp {
+
+const char *PhaseName(Phase phase) {
+  switch (phase) {
+  case Phase::kCreate:
+    return "create";
+  case Phase::kCopy:
+    return "copy";
+  case Phase::kSeal:
+    return "seal";
+  case Phase::kGet:
+    return "get";
+  case Phase::kRelease:
+    return "release";
+  case Phase::kDelete:
+    return "delete";
+  case Phase::kAbort:
+    return "abort";
+  case Phase::kCreateBatch:
+    return "create_batch";
+  case Phase::kUpdate:
+    return "update";
+  case Phase::kPrefault:
+    return "prefault";
+  case Phase::kCompress:
+    return "compress";
+  case Phase::kDecompress:
+    return "decompress";
+  case Phase::kHash:
+    return "hash";
+  default:
+    return "unknown";
+  }
+}
+
+LatencyHistogram::LatencyHistogram() { Reset(); }
+
+uint64_t LatencyHistogram::BucketUpperBound(int bucket) {
+  if (bucket < 4) {
+    return bucket + 1;
+  }
+  int exp = bucket / 4 + 1;
+  uint64_t mantissa = bucket % 4;
+  return (5 + mantissa) << (exp - 2);
+}
+
+uint64_t LatencyHistogram::PercentileNs(double q) const {
+  uint64_t total = Count();
+  if (total == 0) {
+    return 0;
+  }
+  uint64_t rank = static_cast<uint64_t>(q * (total - 1)) + 1;
+  uint64_t seen = 0;
+  for (int i = 0; i < kNumBuckets; i++) {
+    seen += buckets[i].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      // The bucket bound can exceed the largest sample recorded
+      return std::min(BucketUpperBound(i), MaxNs());
+    }
+  }
+  return MaxNs();
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> LatencyHistogram::Buckets() const {
+  std::vector<std::pair<uint64_t, uint64_t>> ret;
+  for (int i = 0; i < kNumBuckets; i++) {
+    uint64_t n = buckets[i].load(std::memory_order_relaxed);
+    if (n > 0) {
+      ret.emplace_back(BucketUpperBound(i), n);
+    }
+  }
+  return ret;
+}
+
+void LatencyHistogram::Reset() {
+  for (auto &bucket : buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  count.store(0, std::memory_order_relaxed);
+  sum_ns.store(0, std::memory_order_relaxed);
+  max_ns.store(0, std::memory_order_relaxed);
+}
+
+Metrics::Metrics() : cpu_bytes_copied(0), gpu_bytes_copied(0) {
+  for (auto &faults : page_faults) {
+    faults.store(0, std::memory_order_relaxed);
+  }
+}
+
+void Metrics::Reset() {
+  for (auto &histogram : latency) {
+    histogram.Reset();
+  }
+  for (auto &faults : page_faults) {
+    faults.store(0, std::memory_order_relaxed);
+  }
+  cpu_bytes_copied.store(0, std::memory_order_relaxed);
+  gpu_bytes_copied.store(0, std::memory_order_relaxed);
+}
+
+int64_t ScopedPageFaultCounter::ProcessPageFaults() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  return usage.ru_minflt + usage.ru_majflt;
+}
+
+} // namespace vovp
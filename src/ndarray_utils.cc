@@ -2,7 +2,11 @@
 #include "vovp/utils.h"
 #include <dmlc/memory_io.h>
 #include <vovp/ndarray_utils.h>
+#include <vovp/serializer.h>
+#include <vovp/tensor_header.h>
 
+#include <algorithm>
+#include <cstdlib>
 #include <plasma/client.h>
 #include <plasma/common.h>
 
@@ -33,16 +37,215 @@ bool IsContiguous(DLManagedTensor *data_) {
   return true;
 }
 
+void PlasmaTensorCtx::Init(std::shared_ptr<Buffer> buffer,
+                           std::shared_ptr<PlasmaClient> plasma_client,
+                           ObjectID object_id, bool release_when_destruct,
+                           bool try_delete_when_destruct,
+                           const std::shared_ptr<ReclaimQueue> &reclaimer) {
+  this->buffer = std::move(buffer);
+  this->plasma_client = std::move(plasma_client);
+  this->object_id = object_id;
+  this->try_delete_when_destruct = try_delete_when_destruct;
+  this->reclaimer = reclaimer;
+  this->data_size = this->buffer ? this->buffer->size() : 0;
+  tensor.manager_ctx = this;
+  tensor.dl_tensor.dtype.lanes = 1;
+  tensor.dl_tensor.byte_offset = 0;
+  released = false;
+  if (release_when_destruct) {
+    tensor.deleter = &PlasmaTensorCtxReleaseDeleter;
+  } else {
+    tensor.deleter = &PlasmaTensorCtxNoReleaseDeleter;
+  }
+}
+
+void PlasmaTensorCtx::SetNDim(int ndim) {
+  tensor.dl_tensor.ndim = ndim;
+  if (ndim <= kInlineDims) {
+    tensor.dl_tensor.shape = inline_shape;
+    tensor.dl_tensor.strides = inline_strides;
+  } else {
+    shape.resize(ndim);
+    strides.resize(ndim);
+    tensor.dl_tensor.shape = shape.data();
+    tensor.dl_tensor.strides = strides.data();
+  }
+}
+
+void PlasmaTensorCtx::SetContiguousStrides() {
+  int ndim = tensor.dl_tensor.ndim;
+  int64_t *shape_arr = tensor.dl_tensor.shape;
+  int64_t *stride_arr = tensor.dl_tensor.strides;
+  if (ndim > 0) {
+    stride_arr[ndim - 1] = 1;
+  }
+  for (int i = ndim - 2; i >= 0; --i) {
+    stride_arr[i] = shape_arr[i + 1] * stride_arr[i + 1];
+  }
+}
+
+bool PlasmaTensorCtx::ReleaseReference() {
+  if (released) {
+    return false;
+  }
+  released = true;
+  if (tensor.deleter == &PlasmaTensorCtxNoReleaseDeleter) {
+    // Views from Get hold their reference through the buffer
+    buffer.reset();
+    return true;
+  }
+  if (unsealed && !unsealed->ReleaseView()) {
+    // Not sealed yet: Seal releases the creation reference instead
+    return true;
+  }
+  if (reclaimer) {
+    reclaimer->EnqueueRelease(object_id);
+  } else {
+    VOVP_CHECK_ARROW(plasma_client->Release(object_id));
+  }
+  return true;
+}
+
+void PlasmaTensorCtx::Reset() {
+  buffer.reset();
+  if (try_delete_when_destruct) {
+    if (reclaimer) {
+      reclaimer->EnqueueDelete(object_id);
+    } else {
+      VOVP_CHECK_ARROW(plasma_client->Delete(object_id));
+    }
+    try_delete_when_destruct = false;
+  }
+  reclaimer.reset();
+  unsealed.reset();
+  plasma_client.reset();
+}
+
+PlasmaTensorCtxPool::~PlasmaTensorCtxPool() {
+  for (auto ctx : free_list) {
+    delete ctx;
+  }
+}
+
+PlasmaTensorCtx *PlasmaTensorCtxPool::Acquire() {
+  PlasmaTensorCtx *ctx = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!free_list.empty()) {
+      ctx = free_list.back();
+      free_list.pop_back();
+    }
+  }
+  if (ctx == nullptr) {
+    ctx = new PlasmaTensorCtx();
+  }
+  ctx->pool = shared_from_this();
+  return ctx;
+}
+
+void PlasmaTensorCtxPool::Track(PlasmaTensorCtx *ctx) {
+  ctx->tracked = true;
+  live_count.fetch_add(1, std::memory_order_relaxed);
+  live_bytes.fetch_add(ctx->data_size, std::memory_order_relaxed);
+}
+
+void PlasmaTensorCtxPool::Untrack(PlasmaTensorCtx *ctx) {
+  if (ctx->tracked) {
+    ctx->tracked = false;
+    live_count.fetch_sub(1, std::memory_order_relaxed);
+    live_bytes.fetch_sub(ctx->data_size, std::memory_order_relaxed);
+  }
+}
+
+void PlasmaTensorCtxPool::LiveStats(int64_t *count, int64_t *bytes) {
+  *count = live_count.load(std::memory_order_relaxed);
+  *bytes = live_bytes.load(std::memory_order_relaxed);
+}
+
+void PlasmaTensorCtxPool::Put(PlasmaTensorCtx *ctx) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (free_list.size() < capacity) {
+      free_list.push_back(ctx);
+      return;
+    }
+  }
+  delete ctx;
+}
+
+PlasmaTensorCtx *
+NewPlasmaTensorCtx(const std::shared_ptr<PlasmaTensorCtxPool> &pool) {
+  if (pool) {
+    return pool->Acquire();
+  }
+  return new PlasmaTensorCtx();
+}
+
+void FreePlasmaTensorCtx(PlasmaTensorCtx *ctx) {
+  // Pooled contexts must not keep the pool alive while sitting in it
+  auto pool = std::move(ctx->pool);
+  if (pool) {
+    pool->Untrack(ctx);
+  }
+  ctx->Reset();
+  if (pool) {
+    pool->Put(ctx);
+  } else {
+    delete ctx;
+  }
+}
+
 void PlasmaTensorCtxNoReleaseDeleter(DLManagedTensor *arg) {
   PlasmaTensorCtx *owner = static_cast<PlasmaTensorCtx *>(arg->manager_ctx);
-  delete owner;
+  FreePlasmaTensorCtx(owner);
 }
 
 void PlasmaTensorCtxReleaseDeleter(DLManagedTensor *arg) {
   PlasmaTensorCtx *owner = static_cast<PlasmaTensorCtx *>(arg->manager_ctx);
-  auto status = owner->plasma_client->Release(owner->object_id);
-  VOVP_CHECK_ARROW(status);
-  delete owner;
+  owner->ReleaseReference();
+  FreePlasmaTensorCtx(owner);
+}
+
+namespace {
+struct HostTensorCtx {
+  std::vector<int64_t> shape;
+  std::vector<int64_t> strides;
+  void *data = nullptr;
+  DLManagedTensor tensor;
+
+  ~HostTensorCtx() { std::free(data); }
+};
+
+void HostTensorCtxDeleter(DLManagedTensor *arg) {
+  delete static_cast<HostTensorCtx *>(arg->manager_ctx);
+}
+} // namespace
+
+DLManagedTensor *NewHostTensor(const int64_t *shape, int ndim,
+                               DLDataType dtype) {
+  auto ctx = new HostTensorCtx();
+  ctx->shape.assign(shape, shape + ndim);
+  ctx->strides.resize(ndim, 1);
+  for (int i = ndim - 2; i >= 0; --i) {
+    ctx->strides[i] = shape[i + 1] * ctx->strides[i + 1];
+  }
+  int64_t size = dtype.bits / 8;
+  for (int i = 0; i < ndim; i++) {
+    size *= shape[i];
+  }
+  CHECK_EQ(posix_memalign(&ctx->data, 64, std::max<int64_t>(size, 1)), 0)
+      << "Failed to allocate " << size << " bytes";
+  DLTensor &dl_tensor = ctx->tensor.dl_tensor;
+  dl_tensor.data = ctx->data;
+  dl_tensor.ctx = {kDLCPU, 0};
+  dl_tensor.ndim = ndim;
+  dl_tensor.dtype = dtype;
+  dl_tensor.shape = ctx->shape.data();
+  dl_tensor.strides = ctx->strides.data();
+  dl_tensor.byte_offset = 0;
+  ctx->tensor.manager_ctx = ctx;
+  ctx->tensor.deleter = &HostTensorCtxDeleter;
+  return &ctx->tensor;
 }
 
 void *GetPointerFromBuffer(std::shared_ptr<Buffer> buffer,
@@ -69,13 +272,16 @@ void *GetPointerFromBuffer(std::shared_ptr<Buffer> buffer,
   }
 }
 
-DLManagedTensor *GetPlasmaBufferToDlpack(std::shared_ptr<Buffer> buffer,
-                                         std::shared_ptr<Buffer> metadatabuffer,
-                                         std::shared_ptr<PlasmaClient> client,
-                                         ObjectID object_id) {
-  auto ptensor_ctx =
-      new PlasmaTensorCtx(buffer, client, object_id, false, true);
-  void *read_ptr;
+DLManagedTensor *GetPlasmaBufferToDlpack(
+    std::shared_ptr<Buffer> buffer, std::shared_ptr<Buffer> metadatabuffer,
+    std::shared_ptr<PlasmaClient> client, ObjectID object_id,
+    bool try_delete_when_destruct,
+    const std::shared_ptr<PlasmaTensorCtxPool> &pool,
+    const std::shared_ptr<ReclaimQueue> &reclaimer) {
+  auto ptensor_ctx = NewPlasmaTensorCtx(pool);
+  ptensor_ctx->Init(buffer, client, object_id, false, try_delete_when_destruct,
+                    reclaimer);
+  const uint8_t *read_ptr;
   std::vector<uint8_t> read_data;
   if (!buffer->is_cpu()) {
 #ifdef VOVP_CUDA
@@ -87,59 +293,71 @@ DLManagedTensor *GetPlasmaBufferToDlpack(std::shared_ptr<Buffer> buffer,
     LOG(FATAL) << "Unsupport CUDA operation";
 #endif
   } else {
-    read_ptr = const_cast<uint8_t *>(metadatabuffer->data());
+    read_ptr = metadatabuffer->data();
   }
 
-  dmlc::MemoryFixedSizeStream strm_(read_ptr, metadatabuffer->size());
-  auto strm = static_cast<dmlc::Stream *>(&strm_);
   auto dltensor = &ptensor_ctx->tensor;
-  strm->Read(&dltensor->dl_tensor.ctx);
-  strm->Read(&dltensor->dl_tensor.dtype);
-  int ndim = 0;
-  strm->Read(&ndim);
-  ptensor_ctx->shape.resize(ndim);
-  strm->ReadArray(&ptensor_ctx->shape[0], ndim);
-
-  dltensor->dl_tensor.ndim = ndim;
-  std::vector<int64_t> *shape_arr = &ptensor_ctx->shape;
-  std::vector<int64_t> *stride_arr = &ptensor_ctx->strides;
-  shape_arr->resize(ndim);
-  stride_arr->resize(ndim, 1);
-  for (int i = ndim - 2; i >= 0; --i) {
-    (*stride_arr)[i] = (*shape_arr)[i + 1] * (*stride_arr)[i + 1];
+  TensorHeader header;
+  if (DecodeTensorHeader(read_ptr, metadatabuffer->size(), &header)) {
+    dltensor->dl_tensor.ctx.device_type =
+        static_cast<DLDeviceType>(header.device_type);
+    dltensor->dl_tensor.ctx.device_id = header.device_id;
+    dltensor->dl_tensor.dtype = header.dtype;
+    if (header.byte_offset != 0 && buffer->is_cpu()) {
+      // Fold the offset into the data pointer, as DLPack consumers such as
+      // PyTorch ignore byte_offset
+      buffer = arrow::SliceBuffer(buffer, header.byte_offset,
+                                  buffer->size() - header.byte_offset);
+      ptensor_ctx->buffer = buffer;
+      ptensor_ctx->data_size = buffer->size();
+    } else {
+      dltensor->dl_tensor.byte_offset = header.byte_offset;
+    }
+    ptensor_ctx->SetNDim(header.ndim);
+    DecodeTensorHeaderArrays(read_ptr, header.ndim, dltensor->dl_tensor.shape,
+                             dltensor->dl_tensor.strides);
+  } else {
+    // Objects written before the binary header was introduced
+    dmlc::MemoryFixedSizeStream strm_(const_cast<uint8_t *>(read_ptr),
+                                      metadatabuffer->size());
+    auto strm = static_cast<dmlc::Stream *>(&strm_);
+    strm->Read(&dltensor->dl_tensor.ctx);
+    strm->Read(&dltensor->dl_tensor.dtype);
+    int ndim = 0;
+    strm->Read(&ndim);
+    ptensor_ctx->SetNDim(ndim);
+    strm->ReadArray(dltensor->dl_tensor.shape, ndim);
+    ptensor_ctx->SetContiguousStrides();
   }
-  dltensor->dl_tensor.strides = &ptensor_ctx->strides[0];
-  dltensor->dl_tensor.shape = &ptensor_ctx->shape[0];
-  dltensor->manager_ctx = ptensor_ctx;
   ptensor_ctx->tensor.dl_tensor.data =
       GetPointerFromBuffer(buffer, dltensor->dl_tensor.ctx.device_type);
+  if (pool) {
+    pool->Track(ptensor_ctx);
+  }
   return &ptensor_ctx->tensor;
 };
 
 DLManagedTensor *CreatePlasmaBufferToDlpack(
     DLManagedTensor *dlm_tensor, std::shared_ptr<Buffer> buffer,
     std::shared_ptr<PlasmaClient> client, ObjectID object_id,
-    bool try_delete_when_destruct) {
-  auto ptensor_ctx =
-      new PlasmaTensorCtx(buffer, client, object_id, true,
-                          try_delete_when_destruct);
+    bool try_delete_when_destruct,
+    const std::shared_ptr<PlasmaTensorCtxPool> &pool,
+    const std::shared_ptr<ReclaimQueue> &reclaimer) {
+  auto ptensor_ctx = NewPlasmaTensorCtx(pool);
+  ptensor_ctx->Init(buffer, client, object_id, true, try_delete_when_destruct,
+                    reclaimer);
   ptensor_ctx->tensor.dl_tensor.ctx = dlm_tensor->dl_tensor.ctx;
   ptensor_ctx->tensor.dl_tensor.dtype = dlm_tensor->dl_tensor.dtype;
-  ptensor_ctx->tensor.dl_tensor.ndim = dlm_tensor->dl_tensor.ndim;
   ptensor_ctx->tensor.dl_tensor.data =
       GetPointerFromBuffer(buffer, dlm_tensor->dl_tensor.ctx.device_type);
-  std::vector<int64_t> *shape_arr = &ptensor_ctx->shape;
-  std::vector<int64_t> *stride_arr = &ptensor_ctx->strides;
-  int ndim = ptensor_ctx->tensor.dl_tensor.ndim;
-  stride_arr->resize(ndim, 1);
-  shape_arr->resize(ndim);
-  ptensor_ctx->tensor.dl_tensor.strides = &ptensor_ctx->strides[0];
-  ptensor_ctx->tensor.dl_tensor.shape = &ptensor_ctx->shape[0];
+  int ndim = dlm_tensor->dl_tensor.ndim;
+  ptensor_ctx->SetNDim(ndim);
   for (int i = 0; i < ndim; i++) {
-    (*shape_arr)[i] = dlm_tensor->dl_tensor.shape[i];
+    ptensor_ctx->tensor.dl_tensor.shape[i] = dlm_tensor->dl_tensor.shape[i];
   }
-  for (int i = ndim - 2; i >= 0; --i) {
-    (*stride_arr)[i] = (*shape_arr)[i + 1] * (*stride_arr)[i + 1];
+  ptensor_ctx->SetContiguousStrides();
+  if (pool) {
+    pool->Track(ptensor_ctx);
   }
 
   return &ptensor_ctx->tensor;
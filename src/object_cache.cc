@@ -0,0 +1,86 @@
+#include "vovp/object_cache.h"
+#include <algorithm>
+
+namespace vovp {
+
+bool ObjectCache::Lookup(const ObjectID &object_id,
+                         std::shared_ptr<Buffer> *data,
+                         std::shared_ptr<Buffer> *metadata) {
+  if (!enabled_) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(object_id);
+    if (it != entries.end()) {
+      *data = it->second.data.lock();
+      if (*data) {
+        *metadata = it->second.metadata;
+        hits_++;
+        return true;
+      }
+      entries.erase(it);
+    }
+  }
+  misses_++;
+  return false;
+}
+
+void ObjectCache::Insert(const ObjectID &object_id,
+                         const std::shared_ptr<Buffer> &data,
+                         const std::shared_ptr<Buffer> &metadata) {
+  if (!enabled_ || !data->is_cpu()) {
+    return;
+  }
+  auto metadata_copy = Buffer::FromString(
+      std::string(reinterpret_cast<const char *>(metadata->data()),
+                  metadata->size()));
+  std::lock_guard<std::mutex> lock(mutex);
+  if (entries.size() >= next_sweep_size) {
+    SweepExpired();
+  }
+  auto &entry = entries[object_id];
+  entry.data = data;
+  entry.metadata = std::move(metadata_copy);
+}
+
+void ObjectCache::Erase(const ObjectID &object_id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.erase(object_id);
+}
+
+void ObjectCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.clear();
+}
+
+void ObjectCache::SetEnabled(bool enabled) {
+  enabled_ = enabled;
+  if (!enabled) {
+    Clear();
+  }
+}
+
+size_t ObjectCache::size() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.size();
+}
+
+void ObjectCache::ResetCounters() {
+  hits_ = 0;
+  misses_ = 0;
+}
+
+void ObjectCache::SweepExpired() {
+  for (auto it = entries.begin(); it != entries.end();) {
+    if (it->second.data.expired()) {
+      it = entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  // Amortize sweeps over the inserts that refill the map
+  next_sweep_size = std::max<size_t>(64, 2 * entries.size());
+}
+
+} // namespace vovp
@@ -0,0 +1,71 @@
+#include "vovp/object_version.h"
+#include "vovp/copy_engine.h"
+
+#include <cstring>
+#include <new>
+#include <thread>
+
+namespace vovp {
+
+ObjectVersion *InitObjectVersion(uint8_t *buffer, int64_t data_size) {
+  uint8_t *ptr = buffer + ObjectVersionOffset(data_size);
+  std::memset(ptr, 0, sizeof(ObjectVersion));
+  auto version = new (ptr) ObjectVersion();
+  version->magic = kObjectVersionMagic;
+  version->sequence.store(0, std::memory_order_release);
+  return version;
+}
+
+ObjectVersion *FindObjectVersion(const uint8_t *buffer, int64_t buffer_size,
+                                 int64_t data_size) {
+  if (buffer_size != VersionedObjectSize(data_size)) {
+    return nullptr;
+  }
+  auto version = reinterpret_cast<ObjectVersion *>(
+      const_cast<uint8_t *>(buffer) + ObjectVersionOffset(data_size));
+  if (version->magic != kObjectVersionMagic) {
+    return nullptr;
+  }
+  return version;
+}
+
+uint64_t BeginObjectWrite(ObjectVersion *version) {
+  uint64_t sequence = version->sequence.load(std::memory_order_relaxed);
+  while (true) {
+    if (sequence % 2 == 0 &&
+        version->sequence.compare_exchange_weak(sequence, sequence + 1,
+                                                std::memory_order_acquire)) {
+      break;
+    }
+    if (sequence % 2 == 1) {
+      std::this_thread::yield();
+      sequence = version->sequence.load(std::memory_order_relaxed);
+    }
+  }
+  // Keep the data stores after the sequence becomes odd
+  std::atomic_thread_fence(std::memory_order_release);
+  return sequence + 1;
+}
+
+void EndObjectWrite(ObjectVersion *version, uint64_t sequence) {
+  version->sequence.store(sequence + 1, std::memory_order_release);
+}
+
+uint64_t ReadObjectConsistent(const ObjectVersion *version, void *dst,
+                              const void *src, int64_t size) {
+  while (true) {
+    uint64_t before = version->sequence.load(std::memory_order_acquire);
+    if (before % 2 == 1) {
+      std::this_thread::yield();
+      continue;
+    }
+    CopyEngine::Global().Memcpy(dst, src, size);
+    // Keep the data loads before the second sequence load
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (version->sequence.load(std::memory_order_relaxed) == before) {
+      return before;
+    }
+  }
+}
+
+} // namespace vovp
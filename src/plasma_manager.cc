@@ -1,5 +1,12 @@
 #include "vovp/utils.h"
+#include <vovp/copy_engine.h>
+#include <vovp/copy_utils.h>
 #include <vovp/plasma_manager.h>
+#include <vovp/tensor_header.h>
+
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
 #ifdef VOVP_CUDA
 #include <arrow/gpu/cuda_memory.h>
 #endif
@@ -23,12 +30,301 @@ ObjectID random_object_id() {
   return result;
 }
 
-VovpPlasmaManager::VovpPlasmaManager(std::string socket_name) {
-  client = std::shared_ptr<PlasmaClient>(
-      new PlasmaClient(),
-      [](PlasmaClient *client) { check_arrow_status(client->Disconnect()); });
-  auto status = client->Connect(socket_name, "", 0, 10);
-  CHECK(status.ok()) << "Connection failed: " << status.ToString();
+// Small CPU tensors in a batched put are created and sealed together in one
+// CreateAndSealBatch request, and their views mapped by one batched Get.
+// Staging them in strings for the request costs less than a round trip each.
+static constexpr int64_t kBatchInlineThreshold = 1 << 20;
+
+static int GetDeviceNum(const DLContext &ctx) {
+  if (ctx.device_type == kDLGPU) {
+    return 1 + ctx.device_id;
+  }
+  return 0;
+}
+
+// Whether a size reaches a CopyOptions threshold, -1 disabling it
+static bool ReachesThreshold(int64_t size, int64_t threshold) {
+  return threshold >= 0 && size >= threshold;
+}
+
+// Move the data of a new CPU object, allocated with kHugePageSize bytes of
+// slack, to the next huge page boundary and return the slice it occupies.
+// The object is not sealed yet, so the offset can still be recorded in the
+// tensor header plasma copied right after the data buffer.
+static std::shared_ptr<Buffer> AlignToHugePage(std::shared_ptr<Buffer> buffer,
+                                               int64_t data_size) {
+  auto address = buffer->address();
+  uint64_t offset = (address + kHugePageSize - 1) /
+                        kHugePageSize * kHugePageSize - address;
+  std::memcpy(buffer->mutable_data() + buffer->size() +
+                  offsetof(TensorHeader, byte_offset),
+              &offset, sizeof(offset));
+  return arrow::SliceMutableBuffer(buffer, offset, data_size);
+}
+
+// Prefer the node of the store for the pages of a new CPU object
+static void BindToStoreNode(const ConnectionPool &store, Buffer *buffer) {
+  if (store.node() >= 0 && buffer->is_cpu()) {
+    StoreRouter::BindToNode(buffer->mutable_data(), buffer->size(),
+                            store.node());
+  }
+}
+
+// Count object of the shared object `shared_id`, kept mapped by `buffer`.
+// With `create`, a missing one is created with no aliases; otherwise null
+// is returned.
+static AliasCount *OpenAliasCount(PlasmaClient *client,
+                                  const ObjectID &shared_id, bool create,
+                                  std::shared_ptr<Buffer> *buffer) {
+  auto count_id = AliasCountID(shared_id);
+  bool created = false;
+  if (create) {
+    std::shared_ptr<Buffer> created_buffer;
+    auto status = client->Create(count_id, sizeof(AliasCount), nullptr, 0,
+                                 &created_buffer, 0);
+    created = status.ok();
+    if (created) {
+      InitAliasCount(created_buffer->mutable_data());
+      VOVP_CHECK_ARROW(client->Seal(count_id));
+    } else if (!IsPlasmaObjectExists(status)) {
+      check_arrow_status(status);
+    }
+  }
+  // Another client may not have sealed the one it created yet
+  std::vector<ObjectBuffer> obj_buffers;
+  auto status = client->Get({count_id}, create ? 1000 : 0, &obj_buffers);
+  if (created) {
+    VOVP_CHECK_ARROW(client->Release(count_id));
+  }
+  if (!status.ok() || !obj_buffers[0].data) {
+    CHECK(!create) << "Unable to open alias count " << count_id.hex() << ": "
+                   << status.ToString();
+    return nullptr;
+  }
+  *buffer = obj_buffers[0].data;
+  return FindAliasCount((*buffer)->data(), (*buffer)->size());
+}
+
+// Count one alias of `shared_id` less, deleting the shared object with the
+// last one
+static void RemoveSharedAlias(PlasmaClient *client,
+                              const ObjectID &shared_id) {
+  std::shared_ptr<Buffer> buffer;
+  auto count = OpenAliasCount(client, shared_id, false, &buffer);
+  if (count == nullptr || !RemoveAlias(count)) {
+    return;
+  }
+  buffer.reset();
+  // Views of the shared object keep it until they are freed
+  auto status =
+      client->Delete(std::vector<ObjectID>{shared_id, AliasCountID(shared_id)});
+  if (!status.ok()) {
+    LOG(WARNING) << "Delete " << shared_id.hex()
+                 << " failed: " << status.ToString();
+  }
+}
+
+// If `object_id` is an alias, drop it from its count before it is deleted
+// or written over. Also runs on the reclaim threads, so errors are ignored
+// and nothing but `client` is used.
+static void DropAlias(PlasmaClient *client, const ObjectID &object_id) {
+  ObjectID shared_id;
+  {
+    std::vector<ObjectBuffer> obj_buffers;
+    auto status = client->Get({object_id}, 0, &obj_buffers);
+    if (!status.ok() || !obj_buffers[0].data ||
+        !obj_buffers[0].data->is_cpu()) {
+      return;
+    }
+    auto &metadata = obj_buffers[0].metadata;
+    if (!DecodeAliasHeader(metadata->data(), metadata->size(), &shared_id) ||
+        !MarkAliasDropped(metadata->data())) {
+      return;
+    }
+  }
+  RemoveSharedAlias(client, shared_id);
+}
+
+// Whether a shared object holds the tensor with `header` and the `size`
+// bytes at `src`. Large objects carry huge page slack, their data starting
+// at the byte offset recorded in their header.
+static bool SameContents(const Buffer &data, const Buffer &metadata,
+                         const std::string &header, const void *src,
+                         int64_t size) {
+  TensorHeader stored;
+  if (!data.is_cpu() ||
+      metadata.size() != static_cast<int64_t>(header.size()) ||
+      !DecodeTensorHeader(metadata.data(), metadata.size(), &stored) ||
+      (data.size() != size && data.size() != size + kHugePageSize) ||
+      stored.byte_offset > static_cast<uint64_t>(data.size() - size)) {
+    return false;
+  }
+  std::string unaligned(reinterpret_cast<const char *>(metadata.data()),
+                        metadata.size());
+  std::memset(&unaligned[offsetof(TensorHeader, byte_offset)], 0,
+              sizeof(stored.byte_offset));
+  return unaligned == header &&
+         ContentEqual(data.data() + stored.byte_offset, src, size);
+}
+
+VovpPlasmaManager::VovpPlasmaManager(std::string socket_name,
+                                     int num_connections)
+    : VovpPlasmaManager(std::vector<std::string>{socket_name}, {},
+                        num_connections) {}
+
+VovpPlasmaManager::VovpPlasmaManager(
+    const std::vector<std::string> &socket_names, const std::vector<int> &nodes,
+    int num_connections)
+    : ctx_pool(std::make_shared<PlasmaTensorCtxPool>()),
+      metrics(std::make_shared<Metrics>()), socket_names(socket_names) {
+  CHECK(!socket_names.empty()) << "No store socket";
+  if (socket_names.size() > 1) {
+    router = std::make_shared<StoreRouter>(socket_names, nodes,
+                                           num_connections, metrics);
+    connections = router->Store(0);
+  } else {
+    connections = std::make_shared<ConnectionPool>(socket_names[0],
+                                                   num_connections, metrics);
+  }
+  client = connections->Primary().client;
+  reclaimer = connections->Primary().reclaimer;
+}
+
+void VovpPlasmaManager::Flush() {
+  for (int i = 0; i < NumStores(); i++) {
+    (router ? router->Store(i) : connections)->Flush();
+  }
+}
+
+void VovpPlasmaManager::SetReclaimOptions(size_t flush_threshold,
+                                          int64_t flush_interval_ms) {
+  for (int i = 0; i < NumStores(); i++) {
+    (router ? router->Store(i) : connections)
+        ->SetReclaimOptions(flush_threshold, flush_interval_ms);
+  }
+}
+
+void VovpPlasmaManager::SetPlacement(Placement placement) {
+  if (router) {
+    router->SetPlacement(placement);
+  }
+}
+
+void VovpPlasmaManager::SetNodeHint(int node) {
+  StoreRouter::SetNodeHint(node);
+}
+
+ConnectionPool &VovpPlasmaManager::PlaceObject(const ObjectID &object_id,
+                                               bool replace) {
+  if (!router) {
+    return *connections;
+  }
+  int store = router->Place();
+  if (replace) {
+    // A put of the ID on another node leaves the old copies behind
+    uint64_t stale = router->Copies(object_id) & ~(uint64_t(1) << store);
+    for (int i = 0; stale != 0; i++, stale >>= 1) {
+      if (stale & 1) {
+        auto &other = *router->Store(i);
+        other.FlushPending();
+        auto conn = other.Acquire();
+        VOVP_METRICS_SCOPE(metrics.get(), kDelete);
+        if (count_aliases) {
+          DropAlias(conn->client.get(), object_id);
+        }
+        VOVP_CHECK_ARROW(conn->client->Delete(object_id));
+      }
+    }
+    router->Assign(object_id, store);
+  } else {
+    router->AddCopy(object_id, store);
+  }
+  return *router->Store(store);
+}
+
+ConnectionPool &VovpPlasmaManager::FindObject(const ObjectID &object_id,
+                                              int64_t timeout_ms) {
+  if (!router) {
+    return *connections;
+  }
+  int store = router->Locate(object_id);
+  if (store < 0 && timeout_ms != 0) {
+    if (WaitTensor(object_id, timeout_ms)) {
+      store = router->Locate(object_id);
+    }
+    if (store < 0) {
+      throw ObjectTimeoutError("Timed out waiting for object " +
+                               object_id.hex());
+    }
+  }
+  return *router->Store(store < 0 ? router->LocalStore() : store);
+}
+
+int VovpPlasmaManager::Replicate(ObjectID &object_id) {
+  if (!router) {
+    return 0;
+  }
+  std::shared_ptr<Buffer> data;
+  std::shared_ptr<Buffer> metadata;
+  {
+    auto conn = FindObject(object_id).Acquire();
+    GetObjectBuffers(conn->client.get(), object_id, &data, &metadata);
+  }
+  CHECK(data->is_cpu()) << "Only CPU objects can be replicated";
+  int copies = 0;
+  uint64_t holders = router->Copies(object_id);
+  for (size_t i = 0; i < router->size(); i++) {
+    if (holders >> i & 1) {
+      continue;
+    }
+    auto &store = *router->Store(i);
+    store.FlushPending();
+    auto conn = store.Acquire();
+    std::shared_ptr<Buffer> buffer;
+    {
+      VOVP_METRICS_SCOPE(metrics.get(), kCreate);
+      auto status =
+          CreateObject(conn->client.get(), object_id, data->size(),
+                       metadata->data(), metadata->size(), &buffer, 0);
+      // Another process replicated it first
+      if (!IsPlasmaObjectExists(status)) {
+        check_arrow_status(status);
+      }
+    }
+    if (buffer) {
+      BindToStoreNode(store, buffer.get());
+      {
+        VOVP_METRICS_SCOPE(metrics.get(), kCopy);
+        VOVP_METRICS_ADD_BYTES(metrics, kDLCPU, data->size());
+        CopyEngine::Global().Memcpy(buffer->mutable_data(), data->data(),
+                                    data->size());
+      }
+      {
+        VOVP_METRICS_SCOPE(metrics.get(), kSeal);
+        check_arrow_status(conn->client->Seal(object_id));
+      }
+      VOVP_CHECK_ARROW(conn->client->Release(object_id));
+      copies++;
+    }
+    router->AddCopy(object_id, i);
+  }
+  return copies;
+}
+
+std::vector<int> VovpPlasmaManager::ObjectNodes(const ObjectID &object_id) {
+  std::vector<int> nodes;
+  if (!router) {
+    nodes.push_back(connections->node());
+    return nodes;
+  }
+  router->Locate(object_id);
+  uint64_t copies = router->Copies(object_id);
+  for (size_t i = 0; i < router->size(); i++) {
+    if (copies >> i & 1) {
+      nodes.push_back(router->Store(i)->node());
+    }
+  }
+  return nodes;
 }
 
 // VovpPlasmaManager::Release(std::string& object_id);
@@ -41,55 +337,344 @@ VovpPlasmaManager::VovpPlasmaManager(std::string socket_name) {
 //   *>(dlm_tensor->manager_ctx); return owner;
 // }
 
-void VovpPlasmaManager::Release(ObjectID &plasma_object_id) {
-  // auto plasma_object_id = ToObjectID(object_id);
-  VOVP_CHECK_ARROW(client->Release(plasma_object_id));
+void VovpPlasmaManager::Delete(ObjectID &object_id) {
+  object_cache.Erase(object_id);
+  if (spill) {
+    spill->Forget(object_id);
+  }
+  VOVP_METRICS_SCOPE(metrics.get(), kDelete);
+  if (!router) {
+    auto conn = connections->Acquire();
+    DropAlias(conn->client.get(), object_id);
+    VOVP_CHECK_ARROW(conn->client->Delete(object_id));
+    return;
+  }
+  // Every copy, or every store if the object is unknown here
+  uint64_t copies = router->Copies(object_id);
+  for (size_t i = 0; i < router->size(); i++) {
+    if (copies == 0 || (copies >> i & 1)) {
+      auto conn = router->Store(i)->Acquire();
+      DropAlias(conn->client.get(), object_id);
+      VOVP_CHECK_ARROW(conn->client->Delete(object_id));
+    }
+  }
+  router->Forget(object_id);
+}
+
+void VovpPlasmaManager::Release(DLManagedTensor *dlm_tensor) {
+  VOVP_METRICS_SCOPE(metrics.get(), kRelease);
+  // Only the view knows which connection took its reference; releasing
+  // whichever connection has the object in use could take another view's
+  bool is_view = dlm_tensor->deleter == &PlasmaTensorCtxReleaseDeleter ||
+                 dlm_tensor->deleter == &PlasmaTensorCtxNoReleaseDeleter;
+  auto ctx = static_cast<PlasmaTensorCtx *>(dlm_tensor->manager_ctx);
+  if (!is_view || ctx->pool != ctx_pool) {
+    throw std::invalid_argument(
+        "Tensor is not a view of a store object from this client");
+  }
+  if (!ctx->ReleaseReference()) {
+    throw std::invalid_argument("No reference to release on object " +
+                                ctx->object_id.hex());
+  }
+}
+
+Status VovpPlasmaManager::CreateObject(PlasmaClient *client,
+                                       const ObjectID &object_id,
+                                       int64_t data_size,
+                                       const uint8_t *metadata,
+                                       int64_t metadata_size,
+                                       std::shared_ptr<Buffer> *buffer,
+                                       int device_num) {
+  for (int attempt = 0;; attempt++) {
+    auto status = client->Create(object_id, data_size, metadata,
+                                 metadata_size, buffer, device_num);
+    if (status.ok() && spill) {
+      // A spilled copy of an earlier object with this ID is stale now
+      spill->Forget(object_id);
+    }
+    if (status.ok() || !spill || !IsPlasmaStoreFull(status) ||
+        device_num != 0 || attempt == 3) {
+      return status;
+    }
+    // Freed space may be fragmented, so retry a few times
+    if (spill->Evict(data_size + metadata_size) == 0) {
+      return status;
+    }
+  }
+}
+
+void VovpPlasmaManager::RestoreSpilled(
+    const std::vector<ObjectID> &object_ids) {
+  if (!spill) {
+    return;
+  }
+  std::vector<std::shared_future<void>> restores;
+  for (auto &object_id : object_ids) {
+    if (spill->Contains(object_id)) {
+      restores.push_back(spill->RestoreAsync(object_id));
+    }
+  }
+  for (auto &restore : restores) {
+    // Rethrows a failed restore
+    restore.get();
+  }
+}
+
+void VovpPlasmaManager::EnableSpill(const std::string &directory) {
+  CHECK(!router) << "Spilling is not supported with several stores";
+  spill = std::make_shared<SpillStore>(directory, connections);
+}
+
+void VovpPlasmaManager::Prefetch(const std::vector<ObjectID> &object_ids) {
+  CHECK(spill) << "Spilling is not enabled";
+  for (auto &object_id : object_ids) {
+    if (spill->Contains(object_id)) {
+      spill->RestoreAsync(object_id);
+    }
+  }
+}
+
+void VovpPlasmaManager::Pin(const ObjectID &object_id) {
+  CHECK(spill) << "Spilling is not enabled";
+  spill->Pin(object_id);
+}
+
+void VovpPlasmaManager::Unpin(const ObjectID &object_id) {
+  CHECK(spill) << "Spilling is not enabled";
+  spill->Unpin(object_id);
+}
+
+int64_t VovpPlasmaManager::Snapshot(const std::string &path,
+                                    const std::vector<ObjectID> &object_ids) {
+  auto conn = connections->Acquire();
+  std::vector<ObjectID> ids = object_ids;
+  if (ids.empty()) {
+    ObjectTable table;
+    VOVP_CHECK_ARROW(conn->client->List(&table));
+    for (const auto &kv : table) {
+      if (kv.second->state == ObjectState::PLASMA_SEALED &&
+          kv.second->device_num == 0) {
+        ids.push_back(kv.first);
+      }
+    }
+  }
+  return WriteSnapshot(conn->client.get(), path, ids, SnapshotOptions());
+}
+
+int64_t VovpPlasmaManager::Restore(const std::string &path, bool use_mmap) {
+  auto conn = connections->Acquire();
+  PlasmaClient *client = conn->client.get();
+  SnapshotOptions options;
+  options.use_mmap = use_mmap;
+  return ReadSnapshot(
+      client, path,
+      [this, client](const ObjectID &object_id, int64_t data_size,
+                     const uint8_t *metadata, int64_t metadata_size,
+                     std::shared_ptr<Buffer> *buffer) {
+        return CreateObject(client, object_id, data_size, metadata,
+                            metadata_size, buffer, 0);
+      },
+      options);
+}
+
+std::shared_ptr<TensorChannel>
+VovpPlasmaManager::OpenChannel(ObjectID &object_id, int64_t num_slots,
+                               int64_t slot_bytes, int64_t timeout_ms) {
+  auto conn = connections->Acquire();
+  std::shared_ptr<Buffer> buffer;
+  auto status = CreateObject(conn->client.get(), object_id,
+                             TensorChannel::BufferSize(num_slots, slot_bytes),
+                             nullptr, 0, &buffer, 0);
+  bool created = status.ok();
+  if (created) {
+    TensorChannel::Init(buffer->mutable_data(), num_slots, slot_bytes);
+    VOVP_CHECK_ARROW(conn->client->Seal(object_id));
+  } else if (!IsPlasmaObjectExists(status)) {
+    check_arrow_status(status);
+  }
+  // The channel holds the reference of this Get, which keeps the object
+  // from being evicted or spilled while it is open
+  std::vector<ObjectBuffer> obj_buffers;
+  VOVP_CHECK_ARROW(conn->client->Get({object_id}, timeout_ms, &obj_buffers));
+  if (created) {
+    VOVP_CHECK_ARROW(conn->client->Release(object_id));
+  }
+  CHECK(obj_buffers[0].data) << "Unable to open channel " << object_id.hex();
+  return std::make_shared<TensorChannel>(obj_buffers[0].data, metrics);
+}
+
+std::shared_ptr<SealNotifier> VovpPlasmaManager::GetSealNotifier() {
+  std::lock_guard<std::mutex> lock(notifier_mutex);
+  if (!seal_notifier) {
+    seal_notifier = std::make_shared<SealNotifier>(socket_names);
+  }
+  return seal_notifier;
+}
+
+int VovpPlasmaManager::WaitAny(const std::vector<ObjectID> &object_ids,
+                               int64_t timeout_ms) {
+  auto poll = [this, &object_ids]() {
+    if (router) {
+      for (size_t i = 0; i < object_ids.size(); i++) {
+        if (router->Locate(object_ids[i]) >= 0) {
+          return static_cast<int>(i);
+        }
+      }
+      return -1;
+    }
+    auto conn = connections->Acquire();
+    for (size_t i = 0; i < object_ids.size(); i++) {
+      bool sealed = false;
+      VOVP_CHECK_ARROW(conn->client->Contains(object_ids[i], &sealed));
+      // A get restores spilled objects
+      if (sealed || (spill && spill->Contains(object_ids[i]))) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  };
+  int found = poll();
+  if (found >= 0 || timeout_ms == 0) {
+    return found;
+  }
+  return GetSealNotifier()->WaitAny(object_ids, timeout_ms, poll);
+}
+
+bool VovpPlasmaManager::WaitTensor(const ObjectID &object_id,
+                                   int64_t timeout_ms) {
+  return WaitAny({object_id}, timeout_ms) == 0;
+}
+
+std::shared_ptr<AsyncWorker> VovpPlasmaManager::GetAsyncWorker() {
+  std::lock_guard<std::mutex> lock(async_mutex);
+  if (!async_worker) {
+    async_worker = std::make_shared<AsyncWorker>(num_async_threads);
+  }
+  return async_worker;
+}
+
+void VovpPlasmaManager::SetAsyncThreads(int num_threads) {
+  CHECK_GT(num_threads, 0);
+  std::shared_ptr<AsyncWorker> old_worker;
+  {
+    std::lock_guard<std::mutex> lock(async_mutex);
+    num_async_threads = num_threads;
+    old_worker = std::move(async_worker);
+  }
+  // The last reference finishes the queued tasks before the threads exit
+  old_worker.reset();
+}
+
+std::future<DLManagedTensor *> VovpPlasmaManager::PutDlpackTensorAsync(
+    DLManagedTensor *dlm_tensor, ObjectID object_id,
+    bool try_delete_when_destruct, bool try_delete_before_create) {
+  // Placed for the calling thread, not the worker
+  int node = router ? router->Store(router->Place())->node() : -1;
+  return GetAsyncWorker()->Submit([=]() mutable {
+    ScopedNodeHint hint(node);
+    return PutDlpackTensor(dlm_tensor, object_id, try_delete_when_destruct,
+                           try_delete_before_create);
+  });
+}
+
+std::future<DLManagedTensor *>
+VovpPlasmaManager::GetDlpackTensorAsync(ObjectID object_id) {
+  return GetAsyncWorker()->Submit(
+      [=]() mutable { return GetDlpackTensor(object_id); });
 }
 
 DLManagedTensor *VovpPlasmaManager::PutDlpackTensor(
     DLManagedTensor *dlm_tensor, ObjectID &plasma_object_id, bool try_delete_when_destruct,
     bool try_delete_before_create) {
-  CHECK(IsContiguous(dlm_tensor));
+  return PutTensorObject(dlm_tensor, plasma_object_id, try_delete_when_destruct,
+                         try_delete_before_create, false);
+}
 
+DLManagedTensor *VovpPlasmaManager::PutTensorObject(
+    DLManagedTensor *dlm_tensor, ObjectID &plasma_object_id,
+    bool try_delete_when_destruct, bool try_delete_before_create,
+    bool versioned, bool *existed) {
   // auto plasma_object_id = ToObjectID(object_id);
   auto dl_tensor = &(dlm_tensor->dl_tensor);
   auto ndim = dlm_tensor->dl_tensor.ndim;
-  int64_t data_size = dl_tensor->dtype.bits / 8;
-  for (int i = 0; i < ndim; i++) {
-    data_size *= dl_tensor->shape[i];
-  }
-  std::string metadata;
-  metadata.reserve(64);
-  dmlc::MemoryStringStream strm_(&metadata);
-  auto strm = static_cast<dmlc::Stream *>(&strm_);
-  strm->Write(dl_tensor->ctx);
-  strm->Write(dl_tensor->dtype);
-  strm->Write(ndim);
-  strm->WriteArray(dl_tensor->shape, ndim);
+  int64_t data_size = GetDataSize(dl_tensor->dtype, dl_tensor->shape, ndim);
+  CHECK(!versioned || dl_tensor->ctx.device_type == kDLCPU);
+  auto copy_options = CopyEngine::Global().options();
+  // Versioned objects keep their trailer at a fixed place after the data
+  bool huge_page_align =
+      !versioned && dl_tensor->ctx.device_type == kDLCPU &&
+      ReachesThreshold(data_size, copy_options.huge_page_align_threshold);
+  int64_t buffer_size =
+      versioned ? VersionedObjectSize(data_size) : data_size;
+  if (huge_page_align) {
+    buffer_size += kHugePageSize;
+  }
+  std::string metadata = EncodeTensorHeader(dl_tensor->ctx, dl_tensor->dtype,
+                                            ndim, dl_tensor->shape);
 
   std::shared_ptr<Buffer> buffer;
   auto metadata_ptr = reinterpret_cast<const uint8_t *>(metadata.c_str());
-  int device_num = 0;
-  if (dl_tensor->ctx.device_type == kDLCPU) {
-    device_num = 0;
-  } else if (dl_tensor->ctx.device_type == kDLGPU) {
-    device_num = 1 + dl_tensor->ctx.device_id;
-  }
+  int device_num = GetDeviceNum(dl_tensor->ctx);
 
+  object_cache.Erase(plasma_object_id);
+  auto &store = PlaceObject(plasma_object_id, try_delete_before_create);
+  // A queued release or delete may still refer to this ID
+  store.FlushPending();
+  auto conn = store.Acquire();
   if (try_delete_before_create) {
-    VOVP_CHECK_ARROW(client->Delete(plasma_object_id));
+    VOVP_METRICS_SCOPE(metrics.get(), kDelete);
+    if (count_aliases) {
+      DropAlias(conn->client.get(), plasma_object_id);
+    }
+    VOVP_CHECK_ARROW(conn->client->Delete(plasma_object_id));
   }
-  auto status = client->Create(plasma_object_id, data_size, metadata_ptr,
-                               metadata.size(), &buffer, device_num);
-  check_arrow_status(status);
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kCreate);
+    auto status = CreateObject(conn->client.get(), plasma_object_id,
+                               buffer_size, metadata_ptr, metadata.size(),
+                               &buffer, device_num);
+    if (existed != nullptr) {
+      *existed = IsPlasmaObjectExists(status);
+      if (*existed) {
+        return nullptr;
+      }
+    }
+    check_arrow_status(status);
+  }
+  BindToStoreNode(store, buffer.get());
+  if (versioned) {
+    InitObjectVersion(buffer->mutable_data(), data_size);
+  }
+  // Part of the buffer holding the tensor
+  auto data_buffer =
+      huge_page_align ? AlignToHugePage(buffer, data_size) : buffer;
   // Copy tensor data to plasma buffer
+  VOVP_METRICS_ADD_BYTES(metrics, dl_tensor->ctx.device_type, data_size);
   if (dl_tensor->ctx.device_type == kDLCPU) {
-    arrow::io::FixedSizeBufferWriter writer(std::move(buffer));
-    writer.set_memcopy_threads(4);
-    auto result = writer.Write(dl_tensor->data, data_size);
-    check_arrow_status(result);
+    if (ReachesThreshold(data_size, copy_options.prefault_threshold)) {
+      VOVP_METRICS_SCOPE(metrics.get(), kPrefault);
+      VOVP_METRICS_PAGE_FAULTS(metrics.get(), kPrefault);
+      CopyEngine::Global().Prefault(data_buffer->mutable_data(), data_size);
+    }
+    VOVP_METRICS_SCOPE(metrics.get(), kCopy);
+    // Small copies would mostly measure the cost of counting
+    VOVP_METRICS_PAGE_FAULTS(
+        data_size >= kHugePageSize ? metrics.get() : nullptr, kCopy);
+    if (IsContiguous(dlm_tensor)) {
+      CopyEngine::Global().Memcpy(
+          data_buffer->mutable_data(),
+          static_cast<char *>(dl_tensor->data) + dl_tensor->byte_offset,
+          data_size);
+    } else {
+      // Gather straight into the store buffer instead of going through a
+      // contiguous temporary
+      StridedCopy(data_buffer->mutable_data(), *dl_tensor);
+    }
   } else if (dl_tensor->ctx.device_type == kDLGPU) {
 #ifdef VOVP_CUDA
+    VOVP_METRICS_SCOPE(metrics.get(), kCopy);
+    CHECK(IsContiguous(dlm_tensor))
+        << "Non-contiguous GPU tensors are not supported";
     auto result = CudaBuffer::FromBuffer(buffer);
     if (result.ok()) {
       auto gpu_buffer = result.ValueOrDie();
@@ -104,76 +689,1440 @@ DLManagedTensor *VovpPlasmaManager::PutDlpackTensor(
   }
 
   auto plasma_dlm_tensor = CreatePlasmaBufferToDlpack(
-      dlm_tensor, buffer, client, plasma_object_id, try_delete_when_destruct);
-  check_arrow_status(client->Seal(plasma_object_id));
+      dlm_tensor, data_buffer, conn->client, plasma_object_id,
+      try_delete_when_destruct, ctx_pool, conn->reclaimer);
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kSeal);
+    check_arrow_status(conn->client->Seal(plasma_object_id));
+  }
+  if (spill) {
+    spill->Touch(plasma_object_id);
+  }
 
   return plasma_dlm_tensor;
 }
 
+DLManagedTensor *VovpPlasmaManager::PutDedupTensor(
+    DLManagedTensor *dlm_tensor, ObjectID &object_id,
+    bool try_delete_before_create) {
+  auto dl_tensor = &dlm_tensor->dl_tensor;
+  if (dl_tensor->ctx.device_type != kDLCPU || !IsContiguous(dlm_tensor)) {
+    return PutDlpackTensor(dlm_tensor, object_id, false,
+                           try_delete_before_create);
+  }
+  int64_t data_size =
+      GetDataSize(dl_tensor->dtype, dl_tensor->shape, dl_tensor->ndim);
+  std::string header = EncodeTensorHeader(dl_tensor->ctx, dl_tensor->dtype,
+                                          dl_tensor->ndim, dl_tensor->shape);
+  const char *src =
+      static_cast<const char *>(dl_tensor->data) + dl_tensor->byte_offset;
+  CountAliases();
+  // An alias and its shared object live in the same store
+  ScopedNodeHint hint(router ? router->Store(router->Place())->node()
+                             : StoreRouter::NodeHint());
+  ObjectID shared_id;
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kHash);
+    // The header is part of the key: equal bytes of another dtype or shape
+    // are a different tensor
+    auto header_digest = ContentHash(header.data(), header.size());
+    shared_id = DedupObjectID(ContentHash(src, data_size, header_digest.lo));
+  }
+
+  bool collision = false;
+  auto result =
+      GetDedupTensor(shared_id, header, src, data_size, 0, &collision);
+  if (result == nullptr && !collision) {
+    bool existed = false;
+    result = PutTensorObject(dlm_tensor, shared_id, false, false, false,
+                             &existed);
+    if (existed) {
+      // Another client is storing the same contents, share its object once
+      // sealed
+      result = GetDedupTensor(shared_id, header, src, data_size, 10000,
+                              &collision);
+    }
+  }
+  if (!collision) {
+    // Counted before an alias this put replaces is dropped, which could
+    // otherwise take the count to zero
+    auto conn = (router ? *router->Store(router->Place()) : *connections)
+                    .Acquire();
+    std::shared_ptr<Buffer> count_buffer;
+    auto count =
+        OpenAliasCount(conn->client.get(), shared_id, true, &count_buffer);
+    CHECK(count != nullptr) << "Object " << AliasCountID(shared_id).hex()
+                            << " is not an alias count";
+    if (!AddAlias(count)) {
+      // The last alias was just dropped and the object is being deleted
+      result->deleter(result);
+      collision = true;
+    }
+  }
+  if (collision) {
+    // Digests collide, both tensors keep their own copy
+    return PutDlpackTensor(dlm_tensor, object_id, false,
+                           try_delete_before_create);
+  }
+
+  std::string alias = EncodeAliasHeader(shared_id);
+  object_cache.Erase(object_id);
+  auto &store = PlaceObject(object_id, try_delete_before_create);
+  store.FlushPending();
+  auto conn = store.Acquire();
+  if (try_delete_before_create) {
+    VOVP_METRICS_SCOPE(metrics.get(), kDelete);
+    DropAlias(conn->client.get(), object_id);
+    VOVP_CHECK_ARROW(conn->client->Delete(object_id));
+  }
+  std::shared_ptr<Buffer> buffer;
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kCreate);
+    auto status = CreateObject(
+        conn->client.get(), object_id, 0,
+        reinterpret_cast<const uint8_t *>(alias.data()), alias.size(),
+        &buffer, 0);
+    if (!status.ok()) {
+      result->deleter(result);
+      RemoveSharedAlias(conn->client.get(), shared_id);
+      check_arrow_status(status);
+    }
+  }
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kSeal);
+    check_arrow_status(conn->client->Seal(object_id));
+  }
+  VOVP_CHECK_ARROW(conn->client->Release(object_id));
+  return result;
+}
+
+DLManagedTensor *VovpPlasmaManager::GetDedupTensor(
+    ObjectID &shared_id, const std::string &header, const void *src,
+    int64_t size, int64_t timeout_ms, bool *collision) {
+  std::shared_ptr<Buffer> data;
+  std::shared_ptr<Buffer> metadata;
+  // The store an alias would be placed in
+  auto &store = router ? *router->Store(router->Place()) : *connections;
+  auto conn = store.Acquire();
+  if (timeout_ms > 0) {
+    GetObjectBuffers(conn->client.get(), shared_id, &data, &metadata,
+                     timeout_ms);
+  } else if (!TryGetObjectBuffers(conn->client.get(), shared_id, 0, &data,
+                                  &metadata)) {
+    return nullptr;
+  }
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kHash);
+    // A matching digest is only a hint, the bytes decide
+    *collision = !SameContents(*data, *metadata, header, src, size);
+  }
+  if (*collision) {
+    return nullptr;
+  }
+  if (router) {
+    router->AddCopy(shared_id, router->Place());
+  }
+  return GetPlasmaBufferToDlpack(data, metadata, conn->client, shared_id,
+                                 false, ctx_pool, conn->reclaimer);
+}
+
+bool VovpPlasmaManager::ResolveAlias(PlasmaClient *client,
+                                     const ObjectID &object_id,
+                                     std::shared_ptr<Buffer> *data,
+                                     std::shared_ptr<Buffer> *metadata) {
+  ObjectID target;
+  if (!(*data)->is_cpu() ||
+      !DecodeAliasHeader((*metadata)->data(), (*metadata)->size(), &target)) {
+    return true;
+  }
+  CountAliases();
+  // The shared object is sealed before any alias of it is created, so it
+  // can only be missing if it was deleted or evicted
+  return TryGetObjectBuffers(client, target, 0, data, metadata);
+}
+
+void VovpPlasmaManager::CountAliases() {
+  if (count_aliases.load(std::memory_order_acquire)) {
+    return;
+  }
+  std::call_once(alias_once, [this]() {
+    for (int i = 0; i < NumStores(); i++) {
+      auto &store = router ? *router->Store(i) : *connections;
+      store.SetDeleteHook(DropAlias);
+    }
+    count_aliases.store(true, std::memory_order_release);
+  });
+}
+
+void VovpPlasmaManager::GetObjectBuffers(PlasmaClient *client,
+                                         const ObjectID &object_id,
+                                         std::shared_ptr<Buffer> *data,
+                                         std::shared_ptr<Buffer> *metadata,
+                                         int64_t timeout_ms) {
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(std::max<int64_t>(timeout_ms, 0));
+  // Waiting happens on the seal notifications rather than in a blocking Get,
+  // which would hold the connection for the whole wait
+  while (!TryGetObjectBuffers(client, object_id, 0, data, metadata)) {
+    int64_t remaining = -1;
+    if (timeout_ms >= 0) {
+      remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      deadline - std::chrono::steady_clock::now())
+                      .count();
+      if (remaining <= 0) {
+        throw ObjectTimeoutError("Timed out waiting for object " +
+                                 object_id.hex());
+      }
+    }
+    // May wake for an object that is deleted again before the Get
+    if (router) {
+      // Copies on the other stores do not end the wait
+      std::vector<ObjectID> object_ids = {object_id};
+      GetSealNotifier()->WaitAny(object_ids, remaining, [&]() {
+        bool sealed = false;
+        VOVP_CHECK_ARROW(client->Contains(object_id, &sealed));
+        return sealed ? 0 : -1;
+      });
+    } else {
+      WaitTensor(object_id, remaining);
+    }
+  }
+}
+
+bool VovpPlasmaManager::TryGetObjectBuffers(PlasmaClient *client,
+                                            const ObjectID &object_id,
+                                            int64_t timeout_ms,
+                                            std::shared_ptr<Buffer> *data,
+                                            std::shared_ptr<Buffer> *metadata) {
+  if (spill) {
+    spill->Touch(object_id);
+  }
+  if (object_cache.Lookup(object_id, data, metadata)) {
+    return true;
+  }
+  std::vector<ObjectBuffer> obj_buffers;
+  std::vector<ObjectID> object_ids = {object_id};
+  RestoreSpilled(object_ids);
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kGet);
+    VOVP_CHECK_ARROW(client->Get(object_ids, timeout_ms, &obj_buffers));
+  }
+  if (!obj_buffers[0].data) {
+    return false;
+  }
+  *data = obj_buffers[0].data;
+  *metadata = obj_buffers[0].metadata;
+  if (!ResolveAlias(client, object_id, data, metadata)) {
+    return false;
+  }
+  object_cache.Insert(object_id, *data, *metadata);
+  return true;
+}
+
+// Whether a stored object has the dtype and shape of `tensor` and a plain
+// row-major CPU layout, so `tensor` can be written over it
+static bool SameLayout(const Buffer &metadata, const DLTensor &tensor) {
+  TensorHeader header;
+  if (!DecodeTensorHeader(metadata.data(), metadata.size(), &header)) {
+    return false;
+  }
+  if (header.device_type != kDLCPU || header.byte_offset != 0 ||
+      header.ndim != tensor.ndim || header.dtype.code != tensor.dtype.code ||
+      header.dtype.bits != tensor.dtype.bits ||
+      header.dtype.lanes != tensor.dtype.lanes) {
+    return false;
+  }
+  std::vector<int64_t> shape(header.ndim), strides(header.ndim);
+  DecodeTensorHeaderArrays(metadata.data(), header.ndim, shape.data(),
+                           strides.data());
+  int64_t expected = 1;
+  for (int i = header.ndim - 1; i >= 0; --i) {
+    if (shape[i] != tensor.shape[i] || (shape[i] > 1 && strides[i] != expected)) {
+      return false;
+    }
+    expected *= shape[i];
+  }
+  return true;
+}
+
+DLManagedTensor *VovpPlasmaManager::UpdateDlpackTensor(
+    DLManagedTensor *dlm_tensor, ObjectID &object_id, bool *in_place) {
+  auto dl_tensor = &dlm_tensor->dl_tensor;
+  if (in_place != nullptr) {
+    *in_place = false;
+  }
+  if (dl_tensor->ctx.device_type != kDLCPU) {
+    return PutTensorObject(dlm_tensor, object_id, false, true, false);
+  }
+  int64_t data_size =
+      GetDataSize(dl_tensor->dtype, dl_tensor->shape, dl_tensor->ndim);
+  // Replicas are replaced rather than updated one by one
+  if (!router || __builtin_popcountll(router->Copies(object_id)) <= 1) {
+    std::shared_ptr<Buffer> data;
+    std::shared_ptr<Buffer> metadata;
+    auto conn = FindObject(object_id, 0).Acquire();
+    ObjectVersion *version = nullptr;
+    if (TryGetObjectBuffers(conn->client.get(), object_id, 0, &data,
+                            &metadata) &&
+        data->is_cpu() && SameLayout(*metadata, *dl_tensor)) {
+      version = FindObjectVersion(data->data(), data->size(), data_size);
+    }
+    if (version != nullptr) {
+      // Store memory is mapped writable in every client
+      auto dst = const_cast<uint8_t *>(data->data());
+      {
+        VOVP_METRICS_SCOPE(metrics.get(), kUpdate);
+        VOVP_METRICS_ADD_BYTES(metrics, kDLCPU, data_size);
+        uint64_t sequence = BeginObjectWrite(version);
+        try {
+          if (IsContiguous(dlm_tensor)) {
+            CopyEngine::Global().Memcpy(
+                dst,
+                static_cast<char *>(dl_tensor->data) + dl_tensor->byte_offset,
+                data_size);
+          } else {
+            StridedCopy(dst, *dl_tensor);
+          }
+        } catch (...) {
+          // Readers would otherwise wait forever on the odd sequence
+          EndObjectWrite(version, sequence);
+          throw;
+        }
+        EndObjectWrite(version, sequence);
+      }
+      if (in_place != nullptr) {
+        *in_place = true;
+      }
+      // Like the view of a new object, freeing it leaves the object
+      return GetPlasmaBufferToDlpack(data, metadata, conn->client, object_id,
+                                     false, ctx_pool, conn->reclaimer);
+    }
+  }
+  // New object or changed layout
+  return PutTensorObject(dlm_tensor, object_id, false, true, true);
+}
+
+DLManagedTensor *VovpPlasmaManager::ReadDlpackTensor(ObjectID &object_id,
+                                                     uint64_t *version) {
+  std::shared_ptr<Buffer> data;
+  std::shared_ptr<Buffer> metadata;
+  {
+    auto conn = FindObject(object_id).Acquire();
+    GetObjectBuffers(conn->client.get(), object_id, &data, &metadata);
+  }
+  if (data->is_cpu() &&
+      IsCompressedHeader(metadata->data(), metadata->size())) {
+    // Compressed objects are never updated
+    *version = 0;
+    return DecompressTensor(*data, *metadata, 0, -1);
+  }
+  // Temporary view that neither releases nor deletes the object
+  auto src = GetPlasmaBufferToDlpack(data, metadata, client, object_id, false,
+                                     ctx_pool);
+  const DLTensor &src_tensor = src->dl_tensor;
+  if (src_tensor.ctx.device_type != kDLCPU) {
+    src->deleter(src);
+    LOG(FATAL) << "read_tensor only supports CPU tensors";
+  }
+  int64_t data_size =
+      GetDataSize(src_tensor.dtype, src_tensor.shape, src_tensor.ndim);
+  auto result = NewHostTensor(src_tensor.shape, src_tensor.ndim,
+                              src_tensor.dtype);
+  auto src_ptr =
+      static_cast<const char *>(src_tensor.data) + src_tensor.byte_offset;
+  *version = 0;
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kCopy);
+    VOVP_METRICS_ADD_BYTES(metrics, kDLCPU, data_size);
+    auto object_version =
+        FindObjectVersion(data->data(), data->size(), data_size);
+    if (object_version != nullptr) {
+      *version = ReadObjectConsistent(object_version, result->dl_tensor.data,
+                                      src_ptr, data_size);
+    } else {
+      // Plain objects never change once sealed
+      CopyEngine::Global().Memcpy(result->dl_tensor.data, src_ptr, data_size);
+    }
+  }
+  src->deleter(src);
+  return result;
+}
+
+int64_t VovpPlasmaManager::TensorVersion(ObjectID &object_id) {
+  std::shared_ptr<Buffer> data;
+  std::shared_ptr<Buffer> metadata;
+  auto conn = FindObject(object_id).Acquire();
+  GetObjectBuffers(conn->client.get(), object_id, &data, &metadata);
+  TensorHeader header;
+  if (!data->is_cpu() ||
+      !DecodeTensorHeader(metadata->data(), metadata->size(), &header)) {
+    return -1;
+  }
+  std::vector<int64_t> shape(header.ndim), strides(header.ndim);
+  DecodeTensorHeaderArrays(metadata->data(), header.ndim, shape.data(),
+                           strides.data());
+  auto version =
+      FindObjectVersion(data->data(), data->size(),
+                        GetDataSize(header.dtype, shape.data(), header.ndim));
+  if (version == nullptr) {
+    return -1;
+  }
+  return version->sequence.load(std::memory_order_acquire);
+}
+
 DLManagedTensor *
-VovpPlasmaManager::GetDlpackTensor(ObjectID &plasma_object_id) {
+VovpPlasmaManager::GetDlpackTensor(ObjectID &plasma_object_id,
+                                   int64_t timeout_ms,
+                                   bool try_delete_when_destruct) {
   // auto plasma_object_id = ToObjectID(object_id);
-  std::vector<ObjectBuffer> obj_buffers;
-  std::vector<ObjectID> object_ids = {plasma_object_id};
-  VOVP_CHECK_ARROW(client->Get(object_ids, 1000, &obj_buffers));
-  CHECK(obj_buffers[0].data)
-      << "Unable to get tensor " << plasma_object_id.hex();
+  std::shared_ptr<Buffer> data;
+  std::shared_ptr<Buffer> metadata;
+  auto &store = FindObject(plasma_object_id, timeout_ms);
+  // Cached and sealed objects need no wait. The buffers hold their own
+  // reference, so the view may use another connection for its delete.
+  bool found;
+  {
+    auto conn = store.Acquire();
+    found = TryGetObjectBuffers(conn->client.get(), plasma_object_id, 0, &data,
+                                &metadata);
+  }
+  // Wait before taking a connection again, so that a long wait does not
+  // hold one
+  if (!found && !router && timeout_ms != 0 &&
+      !WaitTensor(plasma_object_id, timeout_ms)) {
+    throw ObjectTimeoutError("Timed out waiting for object " +
+                             plasma_object_id.hex());
+  }
+  auto conn = store.Acquire();
+  if (!found) {
+    GetObjectBuffers(conn->client.get(), plasma_object_id, &data, &metadata,
+                     timeout_ms);
+  }
+  CHECK(!data->is_cpu() || !IsSparseHeader(metadata->data(), metadata->size()))
+      << "Object " << plasma_object_id.hex()
+      << " is a sparse matrix, use get_sparse";
+  if (data->is_cpu() &&
+      IsCompressedHeader(metadata->data(), metadata->size())) {
+    // The object itself stays compressed
+    return DecompressTensor(*data, *metadata, 0, -1);
+  }
   auto dlm_tensor = GetPlasmaBufferToDlpack(
-      obj_buffers[0].data, obj_buffers[0].metadata, client, plasma_object_id);
+      data, metadata, conn->client, plasma_object_id, try_delete_when_destruct,
+      ctx_pool, conn->reclaimer);
   return dlm_tensor;
 }
 
+DLManagedTensor *VovpPlasmaManager::GatherRows(ObjectID &object_id,
+                                               DLManagedTensor *index,
+                                               DLManagedTensor *out,
+                                               ObjectID *out_object_id) {
+  std::shared_ptr<Buffer> data;
+  std::shared_ptr<Buffer> metadata;
+  {
+    auto conn = FindObject(object_id).Acquire();
+    GetObjectBuffers(conn->client.get(), object_id, &data, &metadata);
+  }
+  CHECK(!data->is_cpu() ||
+        !IsCompressedHeader(metadata->data(), metadata->size()))
+      << "gather_rows does not support compressed tensors";
+  CHECK(!data->is_cpu() || !IsSparseHeader(metadata->data(), metadata->size()))
+      << "gather_rows does not support sparse matrices";
+  // Temporary view that neither releases nor deletes the source object
+  auto src = GetPlasmaBufferToDlpack(data, metadata, client, object_id, false,
+                                     ctx_pool);
+  const DLTensor &src_tensor = src->dl_tensor;
+  DLManagedTensor *result = nullptr;
+  try {
+    CHECK(src_tensor.ctx.device_type == kDLCPU)
+        << "gather_rows only supports CPU tensors";
+    CHECK_GE(src_tensor.ndim, 1);
+    CHECK_EQ(index->dl_tensor.ndim, 1) << "Index must be 1-D";
+    int ndim = src_tensor.ndim;
+    int64_t row_bytes = GetDataSize(src_tensor.dtype, src_tensor.shape + 1,
+                                    ndim - 1);
+    std::vector<int64_t> shape(src_tensor.shape, src_tensor.shape + ndim);
+    shape[0] = index->dl_tensor.shape[0];
+
+    void *dst = nullptr;
+    if (out != nullptr) {
+      const DLTensor &out_tensor = out->dl_tensor;
+      CHECK(out_tensor.ctx.device_type == kDLCPU && IsContiguous(out));
+      CHECK(out_tensor.dtype.code == src_tensor.dtype.code &&
+            out_tensor.dtype.bits == src_tensor.dtype.bits)
+          << "Output dtype does not match the stored tensor";
+      CHECK(out_tensor.ndim == ndim &&
+            std::equal(shape.begin(), shape.end(), out_tensor.shape))
+          << "Output shape does not match the gathered rows";
+      dst = static_cast<char *>(out_tensor.data) + out_tensor.byte_offset;
+    } else if (out_object_id != nullptr) {
+      result = CreateTensor(*out_object_id, shape.data(), ndim,
+                            src_tensor.dtype, src_tensor.ctx, false);
+      dst = result->dl_tensor.data;
+    } else {
+      result = NewHostTensor(shape.data(), ndim, src_tensor.dtype);
+      dst = result->dl_tensor.data;
+    }
+    VOVP_METRICS_SCOPE(metrics.get(), kCopy);
+    VOVP_METRICS_ADD_BYTES(metrics, kDLCPU, shape[0] * row_bytes);
+    vovp::GatherRows(dst, src_tensor.data, src_tensor.shape[0], row_bytes,
+                     index->dl_tensor);
+  } catch (...) {
+    // The source view is freed on every path, with the reference it holds
+    src->deleter(src);
+    if (result != nullptr) {
+      result->deleter(result);
+      if (out_object_id != nullptr) {
+        Abort(*out_object_id);
+      }
+    }
+    throw;
+  }
+  src->deleter(src);
+  if (out_object_id != nullptr && out == nullptr) {
+    Seal(*out_object_id);
+  }
+  return result;
+}
+
+void VovpPlasmaManager::PutBundle(ObjectID &object_id,
+                                  const std::vector<std::string> &names,
+                                  const std::vector<DLManagedTensor *> &tensors,
+                                  bool try_delete_before_create) {
+  std::vector<const DLTensor *> dl_tensors;
+  for (auto tensor : tensors) {
+    CHECK(tensor->dl_tensor.ctx.device_type == kDLCPU)
+        << "Bundles only hold CPU tensors";
+    dl_tensors.push_back(&tensor->dl_tensor);
+  }
+  std::vector<int64_t> offsets;
+  int64_t data_size;
+  std::string metadata =
+      EncodeBundleHeader(names, dl_tensors, &offsets, &data_size);
+  auto meta_ptr = reinterpret_cast<const uint8_t *>(metadata.c_str());
+
+  object_cache.Erase(object_id);
+  auto &store = PlaceObject(object_id, try_delete_before_create);
+  store.FlushPending();
+  auto conn = store.Acquire();
+  if (try_delete_before_create) {
+    VOVP_METRICS_SCOPE(metrics.get(), kDelete);
+    if (count_aliases) {
+      DropAlias(conn->client.get(), object_id);
+    }
+    VOVP_CHECK_ARROW(conn->client->Delete(object_id));
+  }
+  std::shared_ptr<Buffer> buffer;
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kCreate);
+    auto status = CreateObject(conn->client.get(), object_id, data_size,
+                               meta_ptr, metadata.size(), &buffer, 0);
+    check_arrow_status(status);
+  }
+  BindToStoreNode(store, buffer.get());
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kCopy);
+    VOVP_METRICS_ADD_BYTES(metrics, kDLCPU, data_size);
+    for (size_t i = 0; i < tensors.size(); i++) {
+      const DLTensor &tensor = tensors[i]->dl_tensor;
+      uint8_t *dst = buffer->mutable_data() + offsets[i];
+      if (IsContiguous(tensors[i])) {
+        CopyEngine::Global().Memcpy(
+            dst, static_cast<char *>(tensor.data) + tensor.byte_offset,
+            GetDataSize(tensor.dtype, tensor.shape, tensor.ndim));
+      } else {
+        StridedCopy(dst, tensor);
+      }
+    }
+  }
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kSeal);
+    check_arrow_status(conn->client->Seal(object_id));
+  }
+  VOVP_CHECK_ARROW(conn->client->Release(object_id));
+  if (spill) {
+    spill->Touch(object_id);
+  }
+}
+
+std::vector<std::pair<std::string, DLManagedTensor *>>
+VovpPlasmaManager::GetBundle(ObjectID &object_id) {
+  std::shared_ptr<Buffer> data;
+  std::shared_ptr<Buffer> metadata;
+  auto conn = FindObject(object_id).Acquire();
+  GetObjectBuffers(conn->client.get(), object_id, &data, &metadata);
+  std::vector<BundleMember> members;
+  CHECK(data->is_cpu() &&
+        DecodeBundleHeader(metadata->data(), metadata->size(), &members))
+      << "Object " << object_id.hex() << " is not a bundle";
+  std::vector<std::pair<std::string, DLManagedTensor *>> result;
+  result.reserve(members.size());
+  for (auto &member : members) {
+    CHECK_LE(member.data_offset + member.data_size, data->size())
+        << "Corrupt bundle " << object_id.hex();
+    // Each slice keeps the object's buffer, and so its reference, alive.
+    // Members are not tracked by the context pool: their ObjectID names the
+    // bundle, not a tensor.
+    auto slice = arrow::SliceBuffer(data, member.data_offset, member.data_size);
+    auto header = std::make_shared<Buffer>(member.tensor_header,
+                                           member.tensor_header_size);
+    result.emplace_back(member.name,
+                        GetPlasmaBufferToDlpack(slice, header, conn->client,
+                                                object_id, false, nullptr,
+                                                conn->reclaimer));
+  }
+  return result;
+}
+
+void VovpPlasmaManager::PutCompressedTensor(DLManagedTensor *dlm_tensor,
+                                            ObjectID &object_id,
+                                            const std::string &codec,
+                                            int64_t block_size,
+                                            bool try_delete_before_create) {
+  const DLTensor &tensor = dlm_tensor->dl_tensor;
+  CHECK(tensor.ctx.device_type == kDLCPU)
+      << "Only CPU tensors can be compressed";
+  auto codec_type = ParseCompression(codec);
+  int64_t raw_size = GetDataSize(tensor.dtype, tensor.shape, tensor.ndim);
+  const uint8_t *src =
+      static_cast<const uint8_t *>(tensor.data) + tensor.byte_offset;
+  std::vector<uint8_t> contiguous;
+  if (!IsContiguous(dlm_tensor)) {
+    contiguous.resize(raw_size);
+    StridedCopy(contiguous.data(), tensor);
+    src = contiguous.data();
+  }
+  std::vector<std::string> blocks;
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kCompress);
+    blocks = CompressBlocks(codec_type, src, raw_size, block_size);
+  }
+  int64_t data_size;
+  std::string metadata = EncodeCompressedHeader(
+      codec_type, block_size, raw_size,
+      EncodeTensorHeader(tensor.ctx, tensor.dtype, tensor.ndim, tensor.shape),
+      blocks, &data_size);
+  auto meta_ptr = reinterpret_cast<const uint8_t *>(metadata.c_str());
+
+  object_cache.Erase(object_id);
+  auto &store = PlaceObject(object_id, try_delete_before_create);
+  store.FlushPending();
+  auto conn = store.Acquire();
+  if (try_delete_before_create) {
+    VOVP_METRICS_SCOPE(metrics.get(), kDelete);
+    if (count_aliases) {
+      DropAlias(conn->client.get(), object_id);
+    }
+    VOVP_CHECK_ARROW(conn->client->Delete(object_id));
+  }
+  std::shared_ptr<Buffer> buffer;
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kCreate);
+    auto status = CreateObject(conn->client.get(), object_id, data_size,
+                               meta_ptr, metadata.size(), &buffer, 0);
+    check_arrow_status(status);
+  }
+  BindToStoreNode(store, buffer.get());
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kCopy);
+    VOVP_METRICS_ADD_BYTES(metrics, kDLCPU, data_size);
+    uint8_t *dst = buffer->mutable_data();
+    for (auto &block : blocks) {
+      std::memcpy(dst, block.data(), block.size());
+      dst += block.size();
+    }
+  }
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kSeal);
+    check_arrow_status(conn->client->Seal(object_id));
+  }
+  VOVP_CHECK_ARROW(conn->client->Release(object_id));
+  if (spill) {
+    spill->Touch(object_id);
+  }
+}
+
+DLManagedTensor *VovpPlasmaManager::DecompressTensor(const Buffer &data,
+                                                     const Buffer &metadata,
+                                                     int64_t start,
+                                                     int64_t stop) {
+  CompressedLayout layout;
+  TensorHeader header;
+  CHECK(DecodeCompressedHeader(metadata.data(), metadata.size(), &layout) &&
+        DecodeTensorHeader(layout.tensor_header,
+                           layout.header.tensor_header_size, &header))
+      << "Corrupt compressed tensor";
+  std::vector<int64_t> shape(header.ndim), strides(header.ndim);
+  DecodeTensorHeaderArrays(layout.tensor_header, header.ndim, shape.data(),
+                           strides.data());
+  int64_t begin = 0;
+  int64_t end = layout.header.raw_size;
+  if (stop >= 0) {
+    CHECK_GE(header.ndim, 1) << "Cannot read rows of a scalar";
+    CHECK(0 <= start && start <= stop && stop <= shape[0])
+        << "Rows [" << start << ", " << stop << ") are out of range";
+    int64_t row_bytes =
+        GetDataSize(header.dtype, shape.data() + 1, header.ndim - 1);
+    begin = start * row_bytes;
+    end = stop * row_bytes;
+    shape[0] = stop - start;
+  }
+  auto result = NewHostTensor(shape.data(), header.ndim, header.dtype);
+  try {
+    VOVP_METRICS_SCOPE(metrics.get(), kDecompress);
+    DecompressRange(layout, data.data(), data.size(), begin, end,
+                    static_cast<uint8_t *>(result->dl_tensor.data));
+  } catch (...) {
+    result->deleter(result);
+    throw;
+  }
+  return result;
+}
+
+DLManagedTensor *VovpPlasmaManager::ReadTensorRows(ObjectID &object_id,
+                                                   int64_t start,
+                                                   int64_t stop) {
+  std::shared_ptr<Buffer> data;
+  std::shared_ptr<Buffer> metadata;
+  {
+    auto conn = FindObject(object_id).Acquire();
+    GetObjectBuffers(conn->client.get(), object_id, &data, &metadata);
+  }
+  if (data->is_cpu() &&
+      IsCompressedHeader(metadata->data(), metadata->size())) {
+    return DecompressTensor(*data, *metadata, start, stop);
+  }
+  // Temporary view that neither releases nor deletes the object
+  auto src = GetPlasmaBufferToDlpack(data, metadata, client, object_id, false,
+                                     ctx_pool);
+  const DLTensor &src_tensor = src->dl_tensor;
+  if (src_tensor.ctx.device_type != kDLCPU || src_tensor.ndim < 1 ||
+      start < 0 || start > stop || stop > src_tensor.shape[0]) {
+    src->deleter(src);
+    LOG(FATAL) << "Rows [" << start << ", " << stop
+               << ") are not in a stored CPU tensor";
+  }
+  int ndim = src_tensor.ndim;
+  int64_t row_bytes =
+      GetDataSize(src_tensor.dtype, src_tensor.shape + 1, ndim - 1);
+  std::vector<int64_t> shape(src_tensor.shape, src_tensor.shape + ndim);
+  shape[0] = stop - start;
+  auto result = NewHostTensor(shape.data(), ndim, src_tensor.dtype);
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kCopy);
+    VOVP_METRICS_ADD_BYTES(metrics, kDLCPU, shape[0] * row_bytes);
+    // Puts always store row-major data
+    CopyEngine::Global().Memcpy(result->dl_tensor.data,
+                                static_cast<const char *>(src_tensor.data) +
+                                    src_tensor.byte_offset +
+                                    start * row_bytes,
+                                shape[0] * row_bytes);
+  }
+  src->deleter(src);
+  return result;
+}
+
+// Array of a sparse matrix as the kernels see it
+static ArrayRef ToArrayRef(DLManagedTensor *tensor) {
+  const DLTensor &dl_tensor = tensor->dl_tensor;
+  return ArrayRef{static_cast<char *>(dl_tensor.data) + dl_tensor.byte_offset,
+                  dl_tensor.dtype, dl_tensor.shape[0]};
+}
+
+static ArrayRef StoredArray(const Buffer &buffer, const SparseArray &array) {
+  return ArrayRef{const_cast<uint8_t *>(buffer.data()) + array.offset,
+                  array.dtype, static_cast<int64_t>(array.length)};
+}
+
+static int64_t ArraySize(const SparseArray &array) {
+  int64_t length = array.length;
+  return GetDataSize(array.dtype, &length, 1);
+}
+
+// Index arrays keep their type unless a narrower one holds `max_value`
+static DLDataType StoredIndexType(const DLDataType &dtype, int64_t max_value) {
+  DLDataType narrow = NarrowIndexType(max_value);
+  return dtype.bits < narrow.bits ? dtype : narrow;
+}
+
+// Type of the indices of a matrix once decoded
+static DLDataType DecodedIndexType(const SparseHeader &header) {
+  return NarrowIndexType(header.num_cols - 1);
+}
+
+void VovpPlasmaManager::PutSparse(ObjectID &object_id, SparseFormat format,
+                                  int64_t num_rows, int64_t num_cols,
+                                  DLManagedTensor *first,
+                                  DLManagedTensor *second,
+                                  DLManagedTensor *values, bool delta_encode,
+                                  bool try_delete_before_create) {
+  bool csr = format == SparseFormat::kCSR;
+  CHECK(num_rows >= 0 && num_cols >= 0)
+      << "Invalid shape (" << num_rows << ", " << num_cols << ")";
+  std::vector<DLManagedTensor *> inputs = {first, second};
+  if (values != nullptr) {
+    inputs.push_back(values);
+  }
+  for (size_t i = 0; i < inputs.size(); i++) {
+    const DLTensor &tensor = inputs[i]->dl_tensor;
+    CHECK(tensor.ctx.device_type == kDLCPU && tensor.ndim == 1 &&
+          IsContiguous(inputs[i]))
+        << SparseArrayName(format, i) << " must be a 1-D contiguous CPU array";
+    CHECK(i == 2 || (tensor.dtype.code == kDLInt && tensor.dtype.lanes == 1))
+        << SparseArrayName(format, i) << " must hold signed integers";
+  }
+  ArrayRef first_ref = ToArrayRef(first);
+  ArrayRef second_ref = ToArrayRef(second);
+  int64_t nnz = second_ref.length;
+  int64_t lo, hi;
+  if (csr) {
+    CHECK_EQ(first_ref.length, num_rows + 1)
+        << "indptr must have num_rows + 1 entries";
+    CHECK(IndexRange(first_ref, &lo, &hi) && lo == 0 && hi == nnz &&
+          IsNonDecreasing(first_ref))
+        << "indptr must grow from 0 to the number of entries";
+  } else {
+    CHECK_EQ(first_ref.length, nnz) << "row and col must have the same length";
+    CHECK(!IndexRange(first_ref, &lo, &hi) || (lo >= 0 && hi < num_rows))
+        << "Row indices must be in [0, " << num_rows << ")";
+  }
+  CHECK(!IndexRange(second_ref, &lo, &hi) || (lo >= 0 && hi < num_cols))
+      << "Column indices must be in [0, " << num_cols << ")";
+  CHECK(values == nullptr || values->dl_tensor.shape[0] == nnz)
+      << "data must have one value per entry";
+
+  std::vector<SparseArray> arrays(inputs.size());
+  arrays[0] = {0, static_cast<uint64_t>(first_ref.length),
+               StoredIndexType(first_ref.dtype, csr ? nnz : num_rows - 1),
+               kSparsePlain};
+  arrays[1] = {0, static_cast<uint64_t>(nnz),
+               StoredIndexType(second_ref.dtype, num_cols - 1), kSparsePlain};
+  if (delta_encode) {
+    CHECK(csr) << "Only the indices of CSR matrices can be delta encoded";
+    DLDataType delta_type = RowDeltaType(first_ref, second_ref);
+    // Unsorted rows, or differences as wide as the indices, are kept plain
+    if (delta_type.bits != 0 && delta_type.bits < arrays[1].dtype.bits) {
+      arrays[1].dtype = delta_type;
+      arrays[1].encoding = kSparseRowDelta;
+    }
+  }
+  if (values != nullptr) {
+    arrays[2] = {0, static_cast<uint64_t>(nnz), values->dl_tensor.dtype,
+                 kSparsePlain};
+  }
+  int64_t data_size;
+  std::string metadata = EncodeSparseHeader(format, num_rows, num_cols, nnz,
+                                            &arrays, &data_size);
+  auto meta_ptr = reinterpret_cast<const uint8_t *>(metadata.c_str());
+
+  object_cache.Erase(object_id);
+  auto &store = PlaceObject(object_id, try_delete_before_create);
+  store.FlushPending();
+  auto conn = store.Acquire();
+  if (try_delete_before_create) {
+    VOVP_METRICS_SCOPE(metrics.get(), kDelete);
+    if (count_aliases) {
+      DropAlias(conn->client.get(), object_id);
+    }
+    VOVP_CHECK_ARROW(conn->client->Delete(object_id));
+  }
+  std::shared_ptr<Buffer> buffer;
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kCreate);
+    auto status = CreateObject(conn->client.get(), object_id, data_size,
+                               meta_ptr, metadata.size(), &buffer, 0);
+    check_arrow_status(status);
+  }
+  BindToStoreNode(store, buffer.get());
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kCopy);
+    VOVP_METRICS_ADD_BYTES(metrics, kDLCPU, data_size);
+    ConvertIndices(first_ref, StoredArray(*buffer, arrays[0]));
+    if (arrays[1].encoding == kSparseRowDelta) {
+      EncodeRowDelta(first_ref, second_ref, StoredArray(*buffer, arrays[1]));
+    } else {
+      ConvertIndices(second_ref, StoredArray(*buffer, arrays[1]));
+    }
+    if (values != nullptr) {
+      CopyEngine::Global().Memcpy(buffer->mutable_data() + arrays[2].offset,
+                                  ToArrayRef(values).data,
+                                  ArraySize(arrays[2]));
+    }
+  }
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kSeal);
+    check_arrow_status(conn->client->Seal(object_id));
+  }
+  VOVP_CHECK_ARROW(conn->client->Release(object_id));
+  if (spill) {
+    spill->Touch(object_id);
+  }
+}
+
+void VovpPlasmaManager::GetSparseBuffers(PlasmaClient *client,
+                                         ObjectID &object_id,
+                                         std::shared_ptr<Buffer> *data,
+                                         SparseHeader *header) {
+  std::shared_ptr<Buffer> metadata;
+  GetObjectBuffers(client, object_id, data, &metadata);
+  CHECK((*data)->is_cpu() &&
+        DecodeSparseHeader(metadata->data(), metadata->size(), header))
+      << "Object " << object_id.hex() << " is not a sparse matrix";
+  for (int i = 0; i < header->num_arrays; i++) {
+    const SparseArray &array = header->arrays[i];
+    CHECK(array.offset + ArraySize(array) <=
+              static_cast<uint64_t>((*data)->size()) &&
+          (array.encoding == kSparsePlain ||
+           (i == 1 && header->format ==
+                          static_cast<uint8_t>(SparseFormat::kCSR))))
+        << "Corrupt sparse matrix " << object_id.hex();
+  }
+}
+
+std::vector<std::pair<std::string, DLManagedTensor *>>
+VovpPlasmaManager::GetSparse(ObjectID &object_id, SparseHeader *header) {
+  std::shared_ptr<Buffer> data;
+  auto conn = FindObject(object_id).Acquire();
+  GetSparseBuffers(conn->client.get(), object_id, &data, header);
+  auto format = static_cast<SparseFormat>(header->format);
+  DLContext ctx;
+  ctx.device_type = kDLCPU;
+  ctx.device_id = 0;
+  std::vector<std::pair<std::string, DLManagedTensor *>> result;
+  for (int i = 0; i < header->num_arrays; i++) {
+    const SparseArray &array = header->arrays[i];
+    int64_t length = array.length;
+    DLManagedTensor *tensor;
+    if (array.encoding == kSparseRowDelta) {
+      tensor = NewHostTensor(&length, 1, DecodedIndexType(*header));
+      VOVP_METRICS_SCOPE(metrics.get(), kDecompress);
+      DecodeRowDelta(StoredArray(*data, header->arrays[0]),
+                     StoredArray(*data, array), ToArrayRef(tensor));
+    } else {
+      // As with bundle members, the slice keeps the object's reference
+      auto slice = arrow::SliceBuffer(data, array.offset, ArraySize(array));
+      std::string tensor_header = EncodeTensorHeader(ctx, array.dtype, 1,
+                                                     &length);
+      auto header_buffer = std::make_shared<Buffer>(
+          reinterpret_cast<const uint8_t *>(tensor_header.data()),
+          tensor_header.size());
+      tensor = GetPlasmaBufferToDlpack(slice, header_buffer, conn->client,
+                                       object_id, false, nullptr,
+                                       conn->reclaimer);
+    }
+    result.emplace_back(SparseArrayName(format, i), tensor);
+  }
+  return result;
+}
+
+void VovpPlasmaManager::TransposeSparse(ObjectID &object_id,
+                                        ObjectID &out_object_id,
+                                        bool try_delete_before_create) {
+  CHECK(!(object_id == out_object_id)) << "Cannot transpose in place";
+  std::shared_ptr<Buffer> data;
+  SparseHeader header;
+  {
+    auto conn = FindObject(object_id).Acquire();
+    GetSparseBuffers(conn->client.get(), object_id, &data, &header);
+  }
+  CHECK(header.format == static_cast<uint8_t>(SparseFormat::kCSR))
+      << "Only CSR matrices can be transposed";
+  ArrayRef indptr = StoredArray(*data, header.arrays[0]);
+  ArrayRef indices = StoredArray(*data, header.arrays[1]);
+  std::vector<uint8_t> decoded;
+  if (header.arrays[1].encoding == kSparseRowDelta) {
+    ArrayRef plain{nullptr, DecodedIndexType(header), indices.length};
+    decoded.resize(indices.length * plain.dtype.bits / 8);
+    plain.data = decoded.data();
+    VOVP_METRICS_SCOPE(metrics.get(), kDecompress);
+    DecodeRowDelta(indptr, indices, plain);
+    indices = plain;
+  }
+  bool has_values = header.num_arrays > 2;
+  ArrayRef values;
+  if (has_values) {
+    values = StoredArray(*data, header.arrays[2]);
+  }
+  uint64_t nnz = header.nnz;
+  std::vector<SparseArray> arrays(3);
+  arrays[0] = {0, static_cast<uint64_t>(header.num_cols + 1),
+               NarrowIndexType(header.nnz), kSparsePlain};
+  arrays[1] = {0, nnz, NarrowIndexType(header.num_rows - 1), kSparsePlain};
+  arrays[2] = {0, nnz,
+               has_values ? values.dtype : NarrowIndexType(header.nnz - 1),
+               kSparsePlain};
+  int64_t data_size;
+  std::string metadata =
+      EncodeSparseHeader(SparseFormat::kCSR, header.num_cols, header.num_rows,
+                         header.nnz, &arrays, &data_size);
+  auto meta_ptr = reinterpret_cast<const uint8_t *>(metadata.c_str());
+
+  object_cache.Erase(out_object_id);
+  auto &store = PlaceObject(out_object_id, try_delete_before_create);
+  store.FlushPending();
+  auto conn = store.Acquire();
+  if (try_delete_before_create) {
+    VOVP_METRICS_SCOPE(metrics.get(), kDelete);
+    if (count_aliases) {
+      DropAlias(conn->client.get(), out_object_id);
+    }
+    VOVP_CHECK_ARROW(conn->client->Delete(out_object_id));
+  }
+  std::shared_ptr<Buffer> buffer;
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kCreate);
+    auto status = CreateObject(conn->client.get(), out_object_id, data_size,
+                               meta_ptr, metadata.size(), &buffer, 0);
+    check_arrow_status(status);
+  }
+  BindToStoreNode(store, buffer.get());
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kCopy);
+    VOVP_METRICS_ADD_BYTES(metrics, kDLCPU, data_size);
+    TransposeCSR(header.num_rows, header.num_cols, indptr, indices,
+                 has_values ? &values : nullptr,
+                 StoredArray(*buffer, arrays[0]),
+                 StoredArray(*buffer, arrays[1]),
+                 StoredArray(*buffer, arrays[2]));
+  }
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kSeal);
+    check_arrow_status(conn->client->Seal(out_object_id));
+  }
+  VOVP_CHECK_ARROW(conn->client->Release(out_object_id));
+  if (spill) {
+    spill->Touch(out_object_id);
+  }
+}
+
+std::vector<std::pair<std::string, DLManagedTensor *>>
+VovpPlasmaManager::SliceSparseRows(ObjectID &object_id,
+                                   DLManagedTensor *rows) {
+  std::shared_ptr<Buffer> data;
+  SparseHeader header;
+  {
+    auto conn = FindObject(object_id).Acquire();
+    GetSparseBuffers(conn->client.get(), object_id, &data, &header);
+  }
+  CHECK(header.format == static_cast<uint8_t>(SparseFormat::kCSR))
+      << "Only rows of CSR matrices can be sliced";
+  const DLTensor &index = rows->dl_tensor;
+  CHECK(index.ctx.device_type == kDLCPU && index.ndim == 1 &&
+        IsContiguous(rows) && index.dtype.code == kDLInt)
+      << "Rows must be a 1-D contiguous CPU integer array";
+  ArrayRef indptr = StoredArray(*data, header.arrays[0]);
+  ArrayRef indices = StoredArray(*data, header.arrays[1]);
+  uint32_t encoding = header.arrays[1].encoding;
+  std::vector<int64_t> out_indptr;
+  SliceRowsIndptr(indptr, ToArrayRef(rows), &out_indptr);
+
+  int64_t num_offsets = out_indptr.size();
+  int64_t out_nnz = out_indptr.back();
+  std::vector<std::pair<std::string, DLManagedTensor *>> result;
+  result.emplace_back("indptr", NewHostTensor(&num_offsets, 1, IntType(64)));
+  result.emplace_back("indices",
+                      NewHostTensor(&out_nnz, 1,
+                                    encoding == kSparseRowDelta
+                                        ? DecodedIndexType(header)
+                                        : indices.dtype));
+  ArrayRef values;
+  ArrayRef out_values;
+  bool has_values = header.num_arrays > 2;
+  if (has_values) {
+    values = StoredArray(*data, header.arrays[2]);
+    result.emplace_back("data", NewHostTensor(&out_nnz, 1, values.dtype));
+    out_values = ToArrayRef(result[2].second);
+  }
+  VOVP_METRICS_SCOPE(metrics.get(), kCopy);
+  std::memcpy(result[0].second->dl_tensor.data, out_indptr.data(),
+              num_offsets * sizeof(int64_t));
+  SliceRows(indptr, indices, encoding, has_values ? &values : nullptr,
+            ToArrayRef(rows), out_indptr, ToArrayRef(result[1].second),
+            has_values ? &out_values : nullptr);
+  return result;
+}
+
+bool VovpPlasmaManager::CompressionInfo(ObjectID &object_id,
+                                        CompressedHeader *header,
+                                        int64_t *compressed_size) {
+  std::shared_ptr<Buffer> data;
+  std::shared_ptr<Buffer> metadata;
+  auto conn = FindObject(object_id).Acquire();
+  GetObjectBuffers(conn->client.get(), object_id, &data, &metadata);
+  CompressedLayout layout;
+  if (!data->is_cpu() ||
+      !DecodeCompressedHeader(metadata->data(), metadata->size(), &layout)) {
+    return false;
+  }
+  *header = layout.header;
+  *compressed_size = data->size();
+  return true;
+}
+
 DLManagedTensor *VovpPlasmaManager::CreateTensor(ObjectID &object_id,
                                                  int64_t *shape, int ndim,
                                                  DLDataType dtype,
-                                                 DLContext ctx) {
-  int64_t data_size = dtype.bits / 8;
-  for (int i = 0; i < ndim; i++) {
-    data_size *= shape[i];
-  }
-
-  std::string metadata;
-  metadata.reserve(64);
-  dmlc::MemoryStringStream strm_(&metadata);
-  auto strm = static_cast<dmlc::Stream *>(&strm_);
-  strm->Write(ctx);
-  strm->Write(dtype);
-  strm->Write(ndim);
-  strm->WriteArray(shape, ndim);
-
-  int device_num = 0;
-  if (ctx.device_type == kDLCPU) {
-    device_num = 0;
-  } else if (ctx.device_type == kDLGPU) {
-    device_num = 1 + ctx.device_id;
-  }
+                                                 DLContext ctx, bool seal) {
+  int64_t data_size = GetDataSize(dtype, shape, ndim);
+  std::string metadata = EncodeTensorHeader(ctx, dtype, ndim, shape);
+  int device_num = GetDeviceNum(ctx);
   const uint8_t *meta_ptr = reinterpret_cast<const uint8_t *>(metadata.c_str());
+  auto copy_options = CopyEngine::Global().options();
+  bool huge_page_align =
+      ctx.device_type == kDLCPU &&
+      ReachesThreshold(data_size, copy_options.huge_page_align_threshold);
 
+  object_cache.Erase(object_id);
+  auto &store = PlaceObject(object_id, true);
+  store.FlushPending();
+  auto conn = store.Acquire();
   std::shared_ptr<Buffer> buffer;
-  auto status = client->Create(object_id, data_size, meta_ptr, metadata.size(),
-                               &buffer, device_num);
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kCreate);
+    auto status = CreateObject(
+        conn->client.get(), object_id,
+        huge_page_align ? data_size + kHugePageSize : data_size, meta_ptr,
+        metadata.size(), &buffer, device_num);
+    check_arrow_status(status);
+  }
+  BindToStoreNode(store, buffer.get());
+  if (huge_page_align) {
+    buffer = AlignToHugePage(buffer, data_size);
+  }
+  // The caller writes the tensor next, hand it pages that are already mapped
+  if (ctx.device_type == kDLCPU &&
+      ReachesThreshold(data_size, copy_options.prefault_threshold)) {
+    VOVP_METRICS_SCOPE(metrics.get(), kPrefault);
+    VOVP_METRICS_PAGE_FAULTS(metrics.get(), kPrefault);
+    CopyEngine::Global().Prefault(buffer->mutable_data(), data_size);
+  }
 
-  auto ptensor_ctx =
-      new PlasmaTensorCtx(buffer, client, object_id, true, false);
+  auto ptensor_ctx = NewPlasmaTensorCtx(ctx_pool);
+  ptensor_ctx->Init(buffer, conn->client, object_id, true, false,
+                    conn->reclaimer);
   auto dltensor = &ptensor_ctx->tensor;
   dltensor->dl_tensor.ctx = ctx;
   dltensor->dl_tensor.dtype = dtype;
-  dltensor->dl_tensor.ndim = ndim;
   dltensor->dl_tensor.data =
       GetPointerFromBuffer(buffer, dltensor->dl_tensor.ctx.device_type);
-  std::vector<int64_t> *shape_arr = &ptensor_ctx->shape;
-  ptensor_ctx->shape.assign(shape, shape + ndim);
-  std::vector<int64_t> *stride_arr = &ptensor_ctx->strides;
-  stride_arr->resize(ndim, 1);
-  for (int i = ndim - 2; i >= 0; --i) {
-    (*stride_arr)[i] = (*shape_arr)[i + 1] * (*stride_arr)[i + 1];
-  }
-  dltensor->dl_tensor.strides = &ptensor_ctx->strides[0];
-  dltensor->dl_tensor.shape = &ptensor_ctx->shape[0];
+  ptensor_ctx->SetNDim(ndim);
+  std::copy(shape, shape + ndim, dltensor->dl_tensor.shape);
+  ptensor_ctx->SetContiguousStrides();
+  ctx_pool->Track(ptensor_ctx);
 
-  check_arrow_status(client->Seal(object_id));
+  if (spill) {
+    spill->Touch(object_id);
+  }
+  if (seal) {
+    VOVP_METRICS_SCOPE(metrics.get(), kSeal);
+    check_arrow_status(conn->client->Seal(object_id));
+  } else {
+    auto unsealed = std::make_shared<UnsealedObject>();
+    unsealed->client = conn->client;
+    ptensor_ctx->unsealed = unsealed;
+    std::lock_guard<std::mutex> lock(unsealed_mutex);
+    unsealed_objects[object_id] = unsealed;
+  }
 
   return dltensor;
 };
 
+std::shared_ptr<UnsealedObject>
+VovpPlasmaManager::TakeUnsealed(ObjectID &object_id) {
+  std::lock_guard<std::mutex> lock(unsealed_mutex);
+  auto it = unsealed_objects.find(object_id);
+  CHECK(it != unsealed_objects.end())
+      << "No unsealed object " << object_id.hex();
+  auto unsealed = it->second;
+  unsealed_objects.erase(it);
+  return unsealed;
+}
+
+void VovpPlasmaManager::Seal(ObjectID &object_id) {
+  auto unsealed = TakeUnsealed(object_id);
+  std::lock_guard<std::mutex> lock(unsealed->mutex);
+  VOVP_METRICS_SCOPE(metrics.get(), kSeal);
+  check_arrow_status(unsealed->client->Seal(object_id));
+  unsealed->state = UnsealedObject::kSealed;
+  if (!unsealed->view_alive) {
+    VOVP_CHECK_ARROW(unsealed->client->Release(object_id));
+  }
+}
+
+void VovpPlasmaManager::Abort(ObjectID &object_id) {
+  auto unsealed = TakeUnsealed(object_id);
+  std::lock_guard<std::mutex> lock(unsealed->mutex);
+  VOVP_METRICS_SCOPE(metrics.get(), kAbort);
+  check_arrow_status(unsealed->client->Abort(object_id));
+  unsealed->state = UnsealedObject::kAborted;
+}
+
+std::vector<DLManagedTensor *> VovpPlasmaManager::PutDlpackTensors(
+    std::vector<DLManagedTensor *> &dlm_tensors,
+    std::vector<ObjectID> &object_ids, bool try_delete_when_destruct,
+    bool try_delete_before_create) {
+  CHECK_EQ(dlm_tensors.size(), object_ids.size());
+  // The whole batch goes to one store, including its large tensors
+  ScopedNodeHint hint(router ? router->Store(router->Place())->node()
+                             : StoreRouter::NodeHint());
+  ConnectionPool *store = connections.get();
+  for (auto &object_id : object_ids) {
+    object_cache.Erase(object_id);
+    store = &PlaceObject(object_id, try_delete_before_create);
+  }
+  store->FlushPending();
+  if (try_delete_before_create) {
+    auto conn = store->Acquire();
+    VOVP_METRICS_SCOPE(metrics.get(), kDelete);
+    if (count_aliases) {
+      for (auto &object_id : object_ids) {
+        DropAlias(conn->client.get(), object_id);
+      }
+    }
+    VOVP_CHECK_ARROW(conn->client->Delete(object_ids));
+  }
+
+  std::vector<DLManagedTensor *> results(dlm_tensors.size(), nullptr);
+  // Objects stored under the caller's IDs, deleted again if the put fails
+  std::vector<bool> stored(dlm_tensors.size(), false);
+  try {
+    std::vector<size_t> batch_index;
+    for (size_t i = 0; i < dlm_tensors.size(); i++) {
+      auto dl_tensor = &(dlm_tensors[i]->dl_tensor);
+      int64_t data_size =
+          GetDataSize(dl_tensor->dtype, dl_tensor->shape, dl_tensor->ndim);
+      if (dl_tensor->ctx.device_type != kDLCPU ||
+          data_size > kBatchInlineThreshold ||
+          !IsContiguous(dlm_tensors[i])) {
+        // Large or device tensors go through the copy engine
+        results[i] = PutDlpackTensor(dlm_tensors[i], object_ids[i],
+                                     try_delete_when_destruct, false);
+        stored[i] = true;
+        continue;
+      }
+      batch_index.push_back(i);
+    }
+    if (!batch_index.empty()) {
+      PutBatch(*store, dlm_tensors, object_ids, batch_index,
+               try_delete_when_destruct, &results, &stored);
+    }
+  } catch (...) {
+    for (auto *result : results) {
+      if (result != nullptr) {
+        result->deleter(result);
+      }
+    }
+    std::vector<ObjectID> rollback_ids;
+    for (size_t i = 0; i < stored.size(); i++) {
+      if (stored[i]) {
+        rollback_ids.push_back(object_ids[i]);
+      }
+    }
+    if (!rollback_ids.empty()) {
+      // The releases of the views go first so the deletes take effect
+      store->FlushPending();
+      auto conn = store->Acquire();
+      auto status = conn->client->Delete(rollback_ids);
+      if (!status.ok()) {
+        LOG(WARNING) << "Rolling back a batched put failed: "
+                     << status.ToString();
+      }
+      for (auto &object_id : rollback_ids) {
+        object_cache.Erase(object_id);
+        if (router) {
+          router->Forget(object_id);
+        }
+      }
+    }
+    throw;
+  }
+  return results;
+}
+
+void VovpPlasmaManager::PutBatch(ConnectionPool &store,
+                                 std::vector<DLManagedTensor *> &dlm_tensors,
+                                 std::vector<ObjectID> &object_ids,
+                                 const std::vector<size_t> &batch_index,
+                                 bool try_delete_when_destruct,
+                                 std::vector<DLManagedTensor *> *results,
+                                 std::vector<bool> *stored) {
+  std::vector<ObjectID> batch_ids;
+  std::vector<std::string> batch_data;
+  std::vector<std::string> batch_metadata;
+  for (size_t i : batch_index) {
+    auto dl_tensor = &(dlm_tensors[i]->dl_tensor);
+    int64_t data_size =
+        GetDataSize(dl_tensor->dtype, dl_tensor->shape, dl_tensor->ndim);
+    batch_ids.push_back(object_ids[i]);
+    batch_data.emplace_back(static_cast<const char *>(dl_tensor->data) +
+                                dl_tensor->byte_offset,
+                            data_size);
+    batch_metadata.push_back(EncodeTensorHeader(
+        dl_tensor->ctx, dl_tensor->dtype, dl_tensor->ndim, dl_tensor->shape));
+    VOVP_METRICS_ADD_BYTES(metrics, kDLCPU, data_size);
+  }
+  auto conn = store.Acquire();
+  Status status;
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kCreateBatch);
+    status = conn->client->CreateAndSealBatch(batch_ids, batch_data,
+                                              batch_metadata);
+  }
+  if (!status.ok() && spill && IsPlasmaStoreFull(status)) {
+    // Make room by spilling, one object at a time
+    for (size_t i : batch_index) {
+      (*results)[i] = PutDlpackTensor(dlm_tensors[i], object_ids[i],
+                                      try_delete_when_destruct, false);
+      (*stored)[i] = true;
+    }
+    return;
+  }
+  check_arrow_status(status);
+  for (size_t i : batch_index) {
+    (*stored)[i] = true;
+    if (spill) {
+      // A spilled copy of an earlier object with this ID is stale now
+      spill->Forget(object_ids[i]);
+    }
+  }
+  // Sealed objects hold no reference of this client, the views take theirs
+  // in one more request
+  std::vector<ObjectBuffer> obj_buffers;
+  {
+    VOVP_METRICS_SCOPE(metrics.get(), kGet);
+    VOVP_CHECK_ARROW(conn->client->Get(batch_ids, 0, &obj_buffers));
+  }
+  for (size_t j = 0; j < batch_index.size(); j++) {
+    size_t i = batch_index[j];
+    CHECK(obj_buffers[j].data) << "Object " << object_ids[i].hex()
+                               << " was evicted right after its put";
+    (*results)[i] = GetPlasmaBufferToDlpack(
+        obj_buffers[j].data, obj_buffers[j].metadata, conn->client,
+        object_ids[i], try_delete_when_destruct, ctx_pool, conn->reclaimer);
+    if (spill) {
+      spill->Touch(object_ids[i]);
+    }
+  }
+}
+
+std::vector<DLManagedTensor *>
+VovpPlasmaManager::GetDlpackTensors(std::vector<ObjectID> &object_ids,
+                                    int64_t timeout_ms) {
+  if (!router) {
+    return GetDlpackTensorsFrom(*connections, object_ids, timeout_ms);
+  }
+  // One batched get per store holding some of the objects
+  std::vector<std::vector<size_t>> groups(router->size());
+  for (size_t i = 0; i < object_ids.size(); i++) {
+    ConnectionPool *store = &FindObject(object_ids[i], timeout_ms);
+    for (size_t j = 0; j < router->size(); j++) {
+      if (router->Store(j).get() == store) {
+        groups[j].push_back(i);
+      }
+    }
+  }
+  std::vector<DLManagedTensor *> results(object_ids.size());
+  for (size_t j = 0; j < groups.size(); j++) {
+    if (groups[j].empty()) {
+      continue;
+    }
+    std::vector<ObjectID> group_ids;
+    for (size_t i : groups[j]) {
+      group_ids.push_back(object_ids[i]);
+    }
+    auto group_results =
+        GetDlpackTensorsFrom(*router->Store(j), group_ids, timeout_ms);
+    for (size_t k = 0; k < groups[j].size(); k++) {
+      results[groups[j][k]] = group_results[k];
+    }
+  }
+  return results;
+}
+
+std::vector<DLManagedTensor *>
+VovpPlasmaManager::GetDlpackTensorsFrom(ConnectionPool &store,
+                                        std::vector<ObjectID> &object_ids,
+                                        int64_t timeout_ms) {
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(std::max<int64_t>(timeout_ms, 0));
+  std::vector<ObjectBuffer> obj_buffers(object_ids.size());
+  std::vector<size_t> miss_index;
+  std::vector<ObjectID> miss_ids;
+  for (size_t i = 0; i < object_ids.size(); i++) {
+    if (!object_cache.Lookup(object_ids[i], &obj_buffers[i].data,
+                             &obj_buffers[i].metadata)) {
+      miss_index.push_back(i);
+      miss_ids.push_back(object_ids[i]);
+    }
+  }
+  while (!miss_ids.empty()) {
+    RestoreSpilled(miss_ids);
+    std::vector<ObjectBuffer> miss_buffers;
+    std::vector<size_t> still_index;
+    std::vector<ObjectID> still_ids;
+    {
+      auto conn = store.Acquire();
+      {
+        VOVP_METRICS_SCOPE(metrics.get(), kGet);
+        VOVP_CHECK_ARROW(conn->client->Get(miss_ids, 0, &miss_buffers));
+      }
+      for (size_t j = 0; j < miss_ids.size(); j++) {
+        if (!miss_buffers[j].data) {
+          still_index.push_back(miss_index[j]);
+          still_ids.push_back(miss_ids[j]);
+          continue;
+        }
+        if (!ResolveAlias(conn->client.get(), miss_ids[j],
+                          &miss_buffers[j].data, &miss_buffers[j].metadata)) {
+          throw ObjectTimeoutError("Object " + miss_ids[j].hex() +
+                                   " is an alias of a deleted object");
+        }
+        object_cache.Insert(miss_ids[j], miss_buffers[j].data,
+                            miss_buffers[j].metadata);
+        obj_buffers[miss_index[j]] = miss_buffers[j];
+      }
+    }
+    miss_index.swap(still_index);
+    miss_ids.swap(still_ids);
+    if (miss_ids.empty()) {
+      break;
+    }
+    int64_t remaining = -1;
+    if (timeout_ms >= 0) {
+      remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      deadline - std::chrono::steady_clock::now())
+                      .count();
+      if (remaining <= 0) {
+        throw ObjectTimeoutError("Timed out waiting for object " +
+                                 miss_ids[0].hex());
+      }
+    }
+    // Wait on the seal notifications without holding a connection; the
+    // other missing objects are usually sealed by then
+    std::vector<ObjectID> wait_ids = {miss_ids[0]};
+    GetSealNotifier()->WaitAny(wait_ids, remaining, [&]() {
+      bool sealed = false;
+      auto conn = store.Acquire();
+      VOVP_CHECK_ARROW(conn->client->Contains(wait_ids[0], &sealed));
+      return sealed || (spill && spill->Contains(wait_ids[0])) ? 0 : -1;
+    });
+  }
+  auto conn = store.Acquire();
+  std::vector<DLManagedTensor *> results;
+  results.reserve(object_ids.size());
+  for (size_t i = 0; i < object_ids.size(); i++) {
+    auto &data = obj_buffers[i].data;
+    auto &metadata = obj_buffers[i].metadata;
+    if (data->is_cpu() &&
+        IsCompressedHeader(metadata->data(), metadata->size())) {
+      results.push_back(DecompressTensor(*data, *metadata, 0, -1));
+      continue;
+    }
+    results.push_back(GetPlasmaBufferToDlpack(obj_buffers[i].data,
+                                              obj_buffers[i].metadata,
+                                              conn->client, object_ids[i], true,
+                                              ctx_pool, conn->reclaimer));
+  }
+  return results;
+}
+
 } // namespace vovp
@@ -0,0 +1,119 @@
+#include "vovp/reclaim_queue.h"
+#include <chrono>
+#include <dmlc/logging.h>
+
+namespace vovp {
+
+ReclaimQueue::ReclaimQueue(std::shared_ptr<PlasmaClient> client,
+                           size_t flush_threshold, int64_t flush_interval_ms,
+                           std::shared_ptr<Metrics> metrics)
+    : client(client), metrics(metrics), flush_threshold(flush_threshold),
+      flush_interval_ms(flush_interval_ms) {
+  pending_releases.reserve(flush_threshold);
+  pending_deletes.reserve(flush_threshold);
+  worker = std::thread(&ReclaimQueue::Run, this);
+}
+
+ReclaimQueue::~ReclaimQueue() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+  }
+  cond.notify_one();
+  worker.join();
+  Flush();
+}
+
+void ReclaimQueue::EnqueueRelease(const ObjectID &object_id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  pending_releases.push_back(object_id);
+  if (pending_releases.size() + pending_deletes.size() >= flush_threshold) {
+    cond.notify_one();
+  }
+}
+
+void ReclaimQueue::EnqueueDelete(const ObjectID &object_id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  pending_deletes.push_back(object_id);
+  if (pending_releases.size() + pending_deletes.size() >= flush_threshold) {
+    cond.notify_one();
+  }
+}
+
+bool ReclaimQueue::Empty() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return pending_releases.empty() && pending_deletes.empty();
+}
+
+void ReclaimQueue::SetOptions(size_t flush_threshold,
+                              int64_t flush_interval_ms) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->flush_threshold = flush_threshold;
+    this->flush_interval_ms = flush_interval_ms;
+  }
+  cond.notify_one();
+}
+
+void ReclaimQueue::SetDeleteHook(DeleteHook hook) {
+  std::lock_guard<std::mutex> lock(mutex);
+  delete_hook = std::move(hook);
+}
+
+void ReclaimQueue::Flush() {
+  std::lock_guard<std::mutex> flush_lock(flush_mutex);
+  std::vector<ObjectID> releases;
+  std::vector<ObjectID> deletes;
+  DeleteHook hook;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    releases.swap(pending_releases);
+    deletes.swap(pending_deletes);
+    hook = delete_hook;
+    pending_releases.reserve(flush_threshold);
+    pending_deletes.reserve(flush_threshold);
+  }
+  // Errors are only logged: this may run on the background thread, and the
+  // objects may already be gone
+  for (auto &object_id : releases) {
+    VOVP_METRICS_SCOPE(metrics.get(), kRelease);
+    auto status = client->Release(object_id);
+    if (!status.ok()) {
+      LOG(WARNING) << "Release " << object_id.hex()
+                   << " failed: " << status.ToString();
+    }
+  }
+  if (hook) {
+    for (auto &object_id : deletes) {
+      hook(client.get(), object_id);
+    }
+  }
+  if (!deletes.empty()) {
+    VOVP_METRICS_SCOPE(metrics.get(), kDelete);
+    auto status = client->Delete(deletes);
+    if (!status.ok()) {
+      LOG(WARNING) << "Delete failed: " << status.ToString();
+    }
+  }
+}
+
+void ReclaimQueue::Run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopped) {
+    // Woken early when the threshold is hit or the options change
+    if (pending_releases.size() + pending_deletes.size() < flush_threshold) {
+      cond.wait_for(lock, std::chrono::milliseconds(flush_interval_ms));
+    }
+    if (stopped) {
+      break;
+    }
+    if (pending_releases.empty() && pending_deletes.empty()) {
+      continue;
+    }
+    lock.unlock();
+    Flush();
+    lock.lock();
+  }
+}
+
+} // namespace vovp
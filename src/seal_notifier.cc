@@ -0,0 +1,147 @@
+#include "vovp/seal_notifier.h"
+#include "vovp/utils.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace vovp {
+
+SealNotifier::SealNotifier(const std::string &socket_name)
+    : SealNotifier(std::vector<std::string>{socket_name}) {}
+
+SealNotifier::SealNotifier(const std::vector<std::string> &socket_names) {
+  for (auto &socket_name : socket_names) {
+    auto client = std::shared_ptr<PlasmaClient>(
+        new PlasmaClient(), [](PlasmaClient *client) {
+          check_arrow_status(client->Disconnect());
+          delete client;
+        });
+    auto status = client->Connect(socket_name, "", 0, 10);
+    CHECK(status.ok()) << "Connection failed: " << status.ToString();
+    int fd = -1;
+    VOVP_CHECK_ARROW(client->Subscribe(&fd));
+    clients.push_back(client);
+    notification_fds.push_back(fd);
+  }
+  thread = std::thread([this]() { Run(); });
+}
+
+SealNotifier::~SealNotifier() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+  }
+  // Unblocks the read in GetNotification, or the poll
+  for (int fd : notification_fds) {
+    shutdown(fd, SHUT_RDWR);
+  }
+  thread.join();
+  for (int fd : notification_fds) {
+    close(fd);
+  }
+}
+
+void SealNotifier::Run() {
+  std::vector<pollfd> fds(notification_fds.size());
+  for (size_t i = 0; i < fds.size(); i++) {
+    fds[i].fd = notification_fds[i];
+    fds[i].events = POLLIN;
+  }
+  while (true) {
+    // With several stores, read from one that has a notification
+    size_t ready = 0;
+    if (fds.size() > 1) {
+      if (poll(fds.data(), fds.size(), -1) < 0 && errno == EINTR) {
+        continue;
+      }
+      while (ready + 1 < fds.size() && fds[ready].revents == 0) {
+        ready++;
+      }
+    }
+    ObjectID object_id;
+    int64_t data_size;
+    int64_t metadata_size;
+    auto status = clients[ready]->GetNotification(
+        notification_fds[ready], &object_id, &data_size, &metadata_size);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!status.ok()) {
+      if (!stopped) {
+        LOG(WARNING) << "Seal notifications stopped: " << status.ToString();
+        stopped = true;
+      }
+      for (auto waiter : waiters) {
+        waiter->cv.notify_one();
+      }
+      return;
+    }
+    // A negative size announces a deletion
+    if (data_size < 0) {
+      continue;
+    }
+    for (auto waiter : waiters) {
+      if (waiter->found >= 0) {
+        continue;
+      }
+      auto &ids = *waiter->object_ids;
+      for (size_t i = 0; i < ids.size(); i++) {
+        if (ids[i] == object_id) {
+          waiter->found = static_cast<int>(i);
+          waiter->cv.notify_one();
+          break;
+        }
+      }
+    }
+  }
+}
+
+int SealNotifier::WaitAny(const std::vector<ObjectID> &object_ids,
+                          int64_t timeout_ms,
+                          const std::function<int()> &poll) {
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(std::max<int64_t>(timeout_ms, 0));
+  Waiter waiter;
+  waiter.object_ids = &object_ids;
+  std::list<Waiter *>::iterator it;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    it = waiters.insert(waiters.end(), &waiter);
+  }
+  int found = poll();
+  std::unique_lock<std::mutex> lock(mutex);
+  if (found < 0 && !stopped) {
+    auto ready = [&]() { return waiter.found >= 0 || stopped; };
+    if (timeout_ms < 0) {
+      waiter.cv.wait(lock, ready);
+    } else {
+      waiter.cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
+    }
+    found = waiter.found;
+  }
+  waiters.erase(it);
+  if (found >= 0 || !stopped) {
+    return found;
+  }
+  lock.unlock();
+  // Without notifications, poll until the deadline rather than have every
+  // caller spin on an immediate -1
+  std::chrono::steady_clock::duration delay = std::chrono::microseconds(100);
+  while ((found = poll()) < 0) {
+    if (timeout_ms >= 0) {
+      auto remaining = deadline - std::chrono::steady_clock::now();
+      if (remaining <= std::chrono::steady_clock::duration::zero()) {
+        break;
+      }
+      delay = std::min(delay, remaining);
+    }
+    std::this_thread::sleep_for(delay);
+    delay = std::min<std::chrono::steady_clock::duration>(
+        delay * 2, std::chrono::milliseconds(10));
+  }
+  return found;
+}
+
+} // namespace vovp
@@ -0,0 +1,324 @@
+#include "vovp/snapshot.h"
+#include "vovp/copy_engine.h"
+#include "vovp/utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace vovp {
+
+namespace {
+
+int64_t AlignUp(int64_t size) {
+  return (size + kSnapshotAlign - 1) / kSnapshotAlign * kSnapshotAlign;
+}
+
+// One read or write request between store memory and the file
+struct IoChunk {
+  uint8_t *ptr;
+  int64_t offset;
+  int64_t size;
+};
+
+bool PwriteAll(int fd, const uint8_t *ptr, int64_t size, int64_t offset) {
+  while (size > 0) {
+    ssize_t n = pwrite(fd, ptr, size, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    ptr += n;
+    offset += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool PreadAll(int fd, uint8_t *ptr, int64_t size, int64_t offset) {
+  while (size > 0) {
+    ssize_t n = pread(fd, ptr, size, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    ptr += n;
+    offset += n;
+    size -= n;
+  }
+  return true;
+}
+
+void AppendChunks(uint8_t *ptr, int64_t offset, int64_t size,
+                  int64_t chunk_bytes, std::vector<IoChunk> *chunks) {
+  for (int64_t done = 0; done < size; done += chunk_bytes) {
+    chunks->push_back(
+        {ptr + done, offset + done, std::min(chunk_bytes, size - done)});
+  }
+}
+
+// Run `io` on every chunk from the copy engine threads. Consecutive chunks
+// go to the same thread, so each thread streams through one file region.
+void RunChunks(const std::vector<IoChunk> &chunks, int num_threads,
+               const std::function<bool(const IoChunk &)> &io,
+               const std::string &what) {
+  if (chunks.empty()) {
+    return;
+  }
+  std::atomic<int> error(0);
+  int64_t num_chunks = chunks.size();
+  CopyEngine::Global().ParallelFor(
+      num_chunks,
+      static_cast<int>(std::min<int64_t>(std::max(num_threads, 1), num_chunks)),
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end && error == 0; i++) {
+          if (!io(chunks[i])) {
+            // Errors are raised on the calling thread
+            error = errno != 0 ? errno : EIO;
+          }
+        }
+      },
+      chunks[0].ptr);
+  CHECK_EQ(error.load(), 0) << what << " failed: " << std::strerror(error);
+}
+
+} // namespace
+
+int64_t WriteSnapshot(PlasmaClient *client, const std::string &path,
+                      const std::vector<ObjectID> &object_ids,
+                      const SnapshotOptions &options) {
+  ObjectTable table;
+  VOVP_CHECK_ARROW(client->List(&table));
+  std::vector<SnapshotEntry> entries;
+  for (auto &object_id : object_ids) {
+    auto it = table.find(object_id);
+    if (it == table.end() || it->second->state != ObjectState::PLASMA_SEALED) {
+      continue;
+    }
+    if (it->second->device_num != 0) {
+      LOG(WARNING) << "Not snapshotting device object " << object_id.hex();
+      continue;
+    }
+    SnapshotEntry entry;
+    std::memset(&entry, 0, sizeof(entry));
+    std::memcpy(entry.object_id, object_id.data(), kUniqueIDSize);
+    entry.metadata_size = it->second->metadata_size;
+    entry.data_size = it->second->data_size;
+    entries.push_back(entry);
+  }
+
+  // Lay out the metadata after the index and the data after the metadata
+  int64_t index_offset = kSnapshotAlign;
+  int64_t offset = index_offset + entries.size() * sizeof(SnapshotEntry);
+  for (auto &entry : entries) {
+    entry.metadata_offset = offset;
+    offset += entry.metadata_size;
+  }
+  for (auto &entry : entries) {
+    offset = AlignUp(offset);
+    entry.data_offset = offset;
+    offset += entry.data_size;
+  }
+  int64_t file_size = AlignUp(offset);
+
+  // Written under a temporary name and renamed once complete
+  std::string tmp_path = path + ".tmp";
+  int fd = open(tmp_path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+  CHECK_GE(fd, 0) << "Cannot create " << tmp_path << ": "
+                  << std::strerror(errno);
+  CHECK_EQ(ftruncate(fd, file_size), 0)
+      << "Cannot grow " << tmp_path << ": " << std::strerror(errno);
+
+  // Objects deleted since the List leave a hole and no index entry
+  std::vector<SnapshotEntry> written;
+  size_t begin = 0;
+  while (begin < entries.size()) {
+    size_t end = begin;
+    int64_t batch_bytes = 0;
+    std::vector<ObjectID> batch_ids;
+    while (end < entries.size() &&
+           (end == begin || batch_bytes < options.batch_bytes)) {
+      batch_ids.push_back(ObjectID::from_binary(std::string(
+          reinterpret_cast<const char *>(entries[end].object_id),
+          kUniqueIDSize)));
+      batch_bytes += entries[end].data_size;
+      end++;
+    }
+    std::vector<ObjectBuffer> buffers;
+    VOVP_CHECK_ARROW(client->Get(batch_ids, 0, &buffers));
+    std::vector<IoChunk> chunks;
+    for (size_t i = begin; i < end; i++) {
+      auto &buffer = buffers[i - begin];
+      auto &entry = entries[i];
+      if (!buffer.data || buffer.data->size() != entry.data_size) {
+        continue;
+      }
+      if (entry.metadata_size > 0) {
+        CHECK(PwriteAll(fd, buffer.metadata->data(), entry.metadata_size,
+                        entry.metadata_offset))
+            << "Writing " << tmp_path << " failed: " << std::strerror(errno);
+      }
+      AppendChunks(const_cast<uint8_t *>(buffer.data->data()),
+                   entry.data_offset, entry.data_size, options.chunk_bytes,
+                   &chunks);
+      written.push_back(entry);
+    }
+    RunChunks(chunks, options.num_threads,
+              [fd](const IoChunk &chunk) {
+                return PwriteAll(fd, chunk.ptr, chunk.size, chunk.offset);
+              },
+              "Writing " + tmp_path);
+    // Dropping the buffers releases the batch
+    begin = end;
+  }
+
+  SnapshotHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = kSnapshotMagic;
+  header.version = kSnapshotVersion;
+  header.num_objects = written.size();
+  header.index_offset = index_offset;
+  header.file_size = file_size;
+  bool ok = PwriteAll(fd, reinterpret_cast<const uint8_t *>(&header),
+                      sizeof(header), 0) &&
+            PwriteAll(fd, reinterpret_cast<const uint8_t *>(written.data()),
+                      written.size() * sizeof(SnapshotEntry), index_offset) &&
+            fsync(fd) == 0;
+  CHECK(ok) << "Writing " << tmp_path << " failed: " << std::strerror(errno);
+  close(fd);
+  CHECK_EQ(rename(tmp_path.c_str(), path.c_str()), 0)
+      << "Cannot rename " << tmp_path << ": " << std::strerror(errno);
+  return written.size();
+}
+
+int64_t ReadSnapshot(PlasmaClient *client, const std::string &path,
+                     const SnapshotCreateFn &create,
+                     const SnapshotOptions &options) {
+  int fd = open(path.c_str(), O_RDONLY);
+  CHECK_GE(fd, 0) << "Cannot open " << path << ": " << std::strerror(errno);
+  struct stat st;
+  CHECK_EQ(fstat(fd, &st), 0);
+  SnapshotHeader header;
+  CHECK(PreadAll(fd, reinterpret_cast<uint8_t *>(&header), sizeof(header), 0))
+      << "Cannot read " << path;
+  CHECK_EQ(header.magic, kSnapshotMagic) << "Not a snapshot: " << path;
+  CHECK_EQ(header.version, kSnapshotVersion)
+      << "Unsupported snapshot version " << header.version;
+  CHECK_LE(header.file_size, static_cast<uint64_t>(st.st_size))
+      << "Truncated snapshot " << path;
+
+  std::vector<SnapshotEntry> entries(header.num_objects);
+  CHECK(PreadAll(fd, reinterpret_cast<uint8_t *>(entries.data()),
+                 entries.size() * sizeof(SnapshotEntry), header.index_offset))
+      << "Cannot read the index of " << path;
+  // All metadata is packed in one region right after the index
+  int64_t metadata_begin =
+      header.index_offset + entries.size() * sizeof(SnapshotEntry);
+  int64_t metadata_end = metadata_begin;
+  for (auto &entry : entries) {
+    CHECK_LE(entry.data_offset + entry.data_size,
+             static_cast<int64_t>(header.file_size));
+    metadata_end =
+        std::max(metadata_end, entry.metadata_offset + entry.metadata_size);
+  }
+  std::vector<uint8_t> metadata(metadata_end - metadata_begin);
+  CHECK(PreadAll(fd, metadata.data(), metadata.size(), metadata_begin))
+      << "Cannot read the metadata of " << path;
+
+  const uint8_t *mapping = nullptr;
+  if (options.use_mmap && header.file_size > 0) {
+    void *ptr = mmap(nullptr, header.file_size, PROT_READ, MAP_SHARED, fd, 0);
+    CHECK(ptr != MAP_FAILED) << "Cannot map " << path << ": "
+                             << std::strerror(errno);
+    madvise(ptr, header.file_size, MADV_SEQUENTIAL);
+    mapping = static_cast<const uint8_t *>(ptr);
+  }
+
+  int64_t restored = 0;
+  size_t begin = 0;
+  // Objects of the current batch, the first `num_sealed` of them sealed
+  std::vector<ObjectID> batch_ids;
+  std::vector<std::shared_ptr<Buffer>> batch_buffers;
+  size_t num_sealed = 0;
+  try {
+    while (begin < entries.size()) {
+      batch_ids.clear();
+      batch_buffers.clear();
+      num_sealed = 0;
+      std::vector<IoChunk> chunks;
+      int64_t batch_bytes = 0;
+      size_t end = begin;
+      for (; end < entries.size() && (end == begin ||
+                                     batch_bytes < options.batch_bytes);
+           end++) {
+        auto &entry = entries[end];
+        auto object_id = ObjectID::from_binary(std::string(
+            reinterpret_cast<const char *>(entry.object_id), kUniqueIDSize));
+        std::shared_ptr<Buffer> buffer;
+        auto status = create(object_id, entry.data_size,
+                             metadata.data() +
+                                 (entry.metadata_offset - metadata_begin),
+                             entry.metadata_size, &buffer);
+        if (IsPlasmaObjectExists(status)) {
+          continue;
+        }
+        check_arrow_status(status);
+        batch_ids.push_back(object_id);
+        batch_buffers.push_back(buffer);
+        AppendChunks(buffer->mutable_data(), entry.data_offset,
+                     entry.data_size, options.chunk_bytes, &chunks);
+        batch_bytes += entry.data_size;
+      }
+      if (mapping != nullptr) {
+        RunChunks(chunks, options.num_threads,
+                  [mapping](const IoChunk &chunk) {
+                    std::memcpy(chunk.ptr, mapping + chunk.offset,
+                                chunk.size);
+                    return true;
+                  },
+                  "Copying from " + path);
+      } else {
+        RunChunks(chunks, options.num_threads,
+                  [fd](const IoChunk &chunk) {
+                    return PreadAll(fd, chunk.ptr, chunk.size, chunk.offset);
+                  },
+                  "Reading " + path);
+      }
+      for (auto &object_id : batch_ids) {
+        VOVP_CHECK_ARROW(client->Seal(object_id));
+        num_sealed++;
+        VOVP_CHECK_ARROW(client->Release(object_id));
+      }
+      restored += batch_ids.size();
+      begin = end;
+    }
+  } catch (...) {
+    // Unsealed objects would hold their memory and block their readers
+    batch_buffers.clear();
+    for (size_t i = num_sealed; i < batch_ids.size(); i++) {
+      client->Abort(batch_ids[i]);
+    }
+    if (mapping != nullptr) {
+      munmap(const_cast<uint8_t *>(mapping), header.file_size);
+    }
+    close(fd);
+    throw;
+  }
+
+  if (mapping != nullptr) {
+    munmap(const_cast<uint8_t *>(mapping), header.file_size);
+  }
+  close(fd);
+  return restored;
+}
+
+} // namespace vovp
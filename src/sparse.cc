@@ -0,0 +1,495 @@
+#include "vovp/sparse.h"
+#include "vovp/copy_engine.h"
+#include "vovp/utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+namespace vovp {
+
+// Run the statement with T typedef'd to the C type of an integer dtype
+#define VOVP_INT_TYPE_SWITCH(dtype, T, ...)                                    \
+  do {                                                                         \
+    CHECK((dtype).code == kDLInt && (dtype).lanes == 1)                        \
+        << "Expected a signed integer array";                                  \
+    switch ((dtype).bits) {                                                    \
+    case 8: {                                                                  \
+      typedef int8_t T;                                                        \
+      __VA_ARGS__;                                                             \
+      break;                                                                   \
+    }                                                                          \
+    case 16: {                                                                 \
+      typedef int16_t T;                                                       \
+      __VA_ARGS__;                                                             \
+      break;                                                                   \
+    }                                                                          \
+    case 32: {                                                                 \
+      typedef int32_t T;                                                       \
+      __VA_ARGS__;                                                             \
+      break;                                                                   \
+    }                                                                          \
+    case 64: {                                                                 \
+      typedef int64_t T;                                                       \
+      __VA_ARGS__;                                                             \
+      break;                                                                   \
+    }                                                                          \
+    default:                                                                   \
+      LOG(FATAL) << "Unsupported integer width " << (dtype).bits;              \
+    }                                                                          \
+  } while (0)
+
+namespace {
+
+// Index of an array read once per row, where a switch per access is cheap
+int64_t LoadIndex(const ArrayRef &array, int64_t i) {
+  switch (array.dtype.bits) {
+  case 8:
+    return static_cast<const int8_t *>(array.data)[i];
+  case 16:
+    return static_cast<const int16_t *>(array.data)[i];
+  case 32:
+    return static_cast<const int32_t *>(array.data)[i];
+  default:
+    return static_cast<const int64_t *>(array.data)[i];
+  }
+}
+
+void StoreIndex(const ArrayRef &array, int64_t i, int64_t value) {
+  switch (array.dtype.bits) {
+  case 8:
+    static_cast<int8_t *>(array.data)[i] = static_cast<int8_t>(value);
+    break;
+  case 16:
+    static_cast<int16_t *>(array.data)[i] = static_cast<int16_t>(value);
+    break;
+  case 32:
+    static_cast<int32_t *>(array.data)[i] = static_cast<int32_t>(value);
+    break;
+  default:
+    static_cast<int64_t *>(array.data)[i] = value;
+  }
+}
+
+int64_t ElementSize(const DLDataType &dtype) {
+  return (dtype.bits * dtype.lanes + 7) / 8;
+}
+
+// ParallelFor over `n` items of about `item_bytes` each
+void ParallelItems(int64_t n, int64_t item_bytes,
+                   const std::function<void(int64_t, int64_t)> &f,
+                   const void *dst_hint = nullptr) {
+  auto &engine = CopyEngine::Global();
+  engine.ParallelFor(n, engine.NumThreadsFor(n * item_bytes), f, dst_hint);
+}
+
+// Per-row work is spread by the average row size
+int64_t RowBytes(const ArrayRef &indptr, const ArrayRef &indices) {
+  int64_t num_rows = std::max<int64_t>(indptr.length - 1, 1);
+  return std::max<int64_t>(
+      1, indices.length * ElementSize(indices.dtype) / num_rows);
+}
+
+int DeltaBits(int64_t max_value) {
+  if (max_value <= std::numeric_limits<int8_t>::max()) {
+    return 8;
+  } else if (max_value <= std::numeric_limits<int16_t>::max()) {
+    return 16;
+  } else if (max_value <= std::numeric_limits<int32_t>::max()) {
+    return 32;
+  }
+  return 64;
+}
+
+// Copy `n` elements of `element_size` bytes from src[index[i]] to dst[i]
+void GatherElements(const uint8_t *src, const int64_t *index, int64_t n,
+                    int64_t element_size, uint8_t *dst) {
+  switch (element_size) {
+  case 4:
+    for (int64_t i = 0; i < n; i++) {
+      std::memcpy(dst + i * 4, src + index[i] * 4, 4);
+    }
+    break;
+  case 8:
+    for (int64_t i = 0; i < n; i++) {
+      std::memcpy(dst + i * 8, src + index[i] * 8, 8);
+    }
+    break;
+  default:
+    for (int64_t i = 0; i < n; i++) {
+      std::memcpy(dst + i * element_size, src + index[i] * element_size,
+                  element_size);
+    }
+  }
+}
+
+} // namespace
+
+const char *SparseArrayName(SparseFormat format, int index) {
+  static const char *kCSRNames[kMaxSparseArrays] = {"indptr", "indices",
+                                                    "data"};
+  static const char *kCOONames[kMaxSparseArrays] = {"row", "col", "data"};
+  CHECK(index >= 0 && index < kMaxSparseArrays);
+  return format == SparseFormat::kCSR ? kCSRNames[index] : kCOONames[index];
+}
+
+std::string EncodeSparseHeader(SparseFormat format, int64_t num_rows,
+                               int64_t num_cols, int64_t nnz,
+                               std::vector<SparseArray> *arrays,
+                               int64_t *data_size) {
+  CHECK(arrays->size() >= 2 && arrays->size() <= kMaxSparseArrays);
+  SparseHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = kSparseMagic;
+  header.version = kSparseVersion;
+  header.format = static_cast<uint8_t>(format);
+  header.num_arrays = static_cast<uint8_t>(arrays->size());
+  header.num_rows = num_rows;
+  header.num_cols = num_cols;
+  header.nnz = nnz;
+  uint64_t offset = 0;
+  for (size_t i = 0; i < arrays->size(); i++) {
+    SparseArray &array = (*arrays)[i];
+    offset = (offset + kSparseAlign - 1) / kSparseAlign * kSparseAlign;
+    array.offset = offset;
+    offset += array.length * ElementSize(array.dtype);
+    header.arrays[i] = array;
+  }
+  *data_size = offset;
+  return std::string(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+bool IsSparseHeader(const uint8_t *data, int64_t size) {
+  uint32_t magic;
+  if (size != static_cast<int64_t>(sizeof(SparseHeader))) {
+    return false;
+  }
+  std::memcpy(&magic, data, sizeof(magic));
+  return magic == kSparseMagic;
+}
+
+bool DecodeSparseHeader(const uint8_t *data, int64_t size,
+                        SparseHeader *header) {
+  if (!IsSparseHeader(data, size)) {
+    return false;
+  }
+  // Plasma places the metadata right after the data, so it is not aligned
+  std::memcpy(header, data, sizeof(*header));
+  return header->version == kSparseVersion &&
+         header->format <= static_cast<uint8_t>(SparseFormat::kCOO) &&
+         header->num_arrays >= 2 && header->num_arrays <= kMaxSparseArrays;
+}
+
+DLDataType IntType(int bits) {
+  DLDataType dtype;
+  dtype.code = kDLInt;
+  dtype.bits = static_cast<uint8_t>(bits);
+  dtype.lanes = 1;
+  return dtype;
+}
+
+DLDataType NarrowIndexType(int64_t max_value) {
+  return IntType(max_value <= std::numeric_limits<int32_t>::max() ? 32 : 64);
+}
+
+bool IndexRange(const ArrayRef &array, int64_t *min, int64_t *max) {
+  if (array.length == 0) {
+    return false;
+  }
+  std::mutex mutex;
+  *min = std::numeric_limits<int64_t>::max();
+  *max = std::numeric_limits<int64_t>::min();
+  VOVP_INT_TYPE_SWITCH(array.dtype, T, {
+    auto values = static_cast<const T *>(array.data);
+    ParallelItems(array.length, sizeof(T), [&](int64_t begin, int64_t end) {
+      int64_t lo = std::numeric_limits<int64_t>::max();
+      int64_t hi = std::numeric_limits<int64_t>::min();
+      for (int64_t i = begin; i < end; i++) {
+        lo = std::min<int64_t>(lo, values[i]);
+        hi = std::max<int64_t>(hi, values[i]);
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      *min = std::min(*min, lo);
+      *max = std::max(*max, hi);
+    });
+  });
+  return true;
+}
+
+bool IsNonDecreasing(const ArrayRef &array) {
+  std::atomic<bool> decreasing{false};
+  VOVP_INT_TYPE_SWITCH(array.dtype, T, {
+    auto values = static_cast<const T *>(array.data);
+    ParallelItems(array.length, sizeof(T), [&](int64_t begin, int64_t end) {
+      // Each range also checks the step into it
+      for (int64_t i = std::max<int64_t>(begin, 1); i < end; i++) {
+        if (values[i] < values[i - 1]) {
+          decreasing.store(true, std::memory_order_relaxed);
+          return;
+        }
+      }
+    });
+  });
+  return !decreasing;
+}
+
+void ConvertIndices(const ArrayRef &src, const ArrayRef &dst) {
+  CHECK_EQ(src.length, dst.length);
+  if (src.dtype.bits == dst.dtype.bits) {
+    CopyEngine::Global().Memcpy(dst.data, src.data,
+                                src.length * ElementSize(src.dtype));
+    return;
+  }
+  VOVP_INT_TYPE_SWITCH(src.dtype, S, {
+    VOVP_INT_TYPE_SWITCH(dst.dtype, D, {
+      auto in = static_cast<const S *>(src.data);
+      auto out = static_cast<D *>(dst.data);
+      ParallelItems(
+          src.length, sizeof(D),
+          [&](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; i++) {
+              out[i] = static_cast<D>(in[i]);
+            }
+          },
+          dst.data);
+    });
+  });
+}
+
+DLDataType RowDeltaType(const ArrayRef &indptr, const ArrayRef &indices) {
+  int64_t num_rows = indptr.length - 1;
+  std::atomic<bool> unsorted{false};
+  std::mutex mutex;
+  int64_t max_value = 0;
+  VOVP_INT_TYPE_SWITCH(indices.dtype, T, {
+    auto values = static_cast<const T *>(indices.data);
+    ParallelItems(
+        num_rows, RowBytes(indptr, indices), [&](int64_t begin, int64_t end) {
+          int64_t local_max = 0;
+          for (int64_t r = begin; r < end; r++) {
+            int64_t row_begin = LoadIndex(indptr, r);
+            int64_t row_end = LoadIndex(indptr, r + 1);
+            if (row_begin == row_end) {
+              continue;
+            }
+            local_max = std::max<int64_t>(local_max, values[row_begin]);
+            for (int64_t j = row_begin + 1; j < row_end; j++) {
+              int64_t delta = static_cast<int64_t>(values[j]) - values[j - 1];
+              if (delta < 0) {
+                unsorted.store(true, std::memory_order_relaxed);
+                return;
+              }
+              local_max = std::max(local_max, delta);
+            }
+          }
+          std::lock_guard<std::mutex> lock(mutex);
+          max_value = std::max(max_value, local_max);
+        });
+  });
+  return unsorted ? IntType(0) : IntType(DeltaBits(max_value));
+}
+
+void EncodeRowDelta(const ArrayRef &indptr, const ArrayRef &indices,
+                    const ArrayRef &deltas) {
+  int64_t num_rows = indptr.length - 1;
+  VOVP_INT_TYPE_SWITCH(indices.dtype, S, {
+    VOVP_INT_TYPE_SWITCH(deltas.dtype, D, {
+      auto in = static_cast<const S *>(indices.data);
+      auto out = static_cast<D *>(deltas.data);
+      ParallelItems(
+          num_rows, RowBytes(indptr, indices),
+          [&](int64_t begin, int64_t end) {
+            for (int64_t r = begin; r < end; r++) {
+              int64_t row_begin = LoadIndex(indptr, r);
+              int64_t row_end = LoadIndex(indptr, r + 1);
+              int64_t prev = 0;
+              for (int64_t j = row_begin; j < row_end; j++) {
+                out[j] = static_cast<D>(in[j] - prev);
+                prev = in[j];
+              }
+            }
+          },
+          deltas.data);
+    });
+  });
+}
+
+void DecodeRowDelta(const ArrayRef &indptr, const ArrayRef &deltas,
+                    const ArrayRef &indices) {
+  int64_t num_rows = indptr.length - 1;
+  VOVP_INT_TYPE_SWITCH(deltas.dtype, S, {
+    VOVP_INT_TYPE_SWITCH(indices.dtype, D, {
+      auto in = static_cast<const S *>(deltas.data);
+      auto out = static_cast<D *>(indices.data);
+      ParallelItems(
+          num_rows, RowBytes(indptr, indices),
+          [&](int64_t begin, int64_t end) {
+            for (int64_t r = begin; r < end; r++) {
+              int64_t row_begin = LoadIndex(indptr, r);
+              int64_t row_end = LoadIndex(indptr, r + 1);
+              int64_t value = 0;
+              for (int64_t j = row_begin; j < row_end; j++) {
+                value += in[j];
+                out[j] = static_cast<D>(value);
+              }
+            }
+          },
+          indices.data);
+    });
+  });
+}
+
+void TransposeCSR(int64_t num_rows, int64_t num_cols, const ArrayRef &indptr,
+                  const ArrayRef &indices, const ArrayRef *data,
+                  const ArrayRef &out_indptr, const ArrayRef &out_indices,
+                  const ArrayRef &out_data) {
+  int64_t nnz = indices.length;
+  CHECK_EQ(indptr.length, num_rows + 1);
+  CHECK_EQ(out_indptr.length, num_cols + 1);
+  CHECK(out_indices.length == nnz && out_data.length == nnz);
+  int64_t row_bytes = RowBytes(indptr, indices);
+
+  // Entries per column, then the start of each column
+  std::unique_ptr<std::atomic<int64_t>[]> cursor(
+      new std::atomic<int64_t>[num_cols + 1]);
+  ParallelItems(num_cols + 1, sizeof(int64_t),
+                [&](int64_t begin, int64_t end) {
+                  for (int64_t c = begin; c < end; c++) {
+                    cursor[c].store(0, std::memory_order_relaxed);
+                  }
+                });
+  VOVP_INT_TYPE_SWITCH(indices.dtype, T, {
+    auto cols = static_cast<const T *>(indices.data);
+    ParallelItems(num_rows, row_bytes, [&](int64_t begin, int64_t end) {
+      int64_t first = LoadIndex(indptr, begin);
+      int64_t last = LoadIndex(indptr, end);
+      for (int64_t j = first; j < last; j++) {
+        cursor[cols[j] + 1].fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+  });
+  for (int64_t c = 0; c < num_cols; c++) {
+    int64_t start = cursor[c].load(std::memory_order_relaxed);
+    StoreIndex(out_indptr, c, start);
+    cursor[c + 1].fetch_add(start, std::memory_order_relaxed);
+  }
+  StoreIndex(out_indptr, num_cols, nnz);
+  // The columns start where the previous ones end, so shift the starts
+  // down one column to use them as fill cursors
+  for (int64_t c = num_cols; c > 0; c--) {
+    cursor[c].store(cursor[c - 1].load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+  }
+  cursor[0].store(0, std::memory_order_relaxed);
+
+  // Input position of every output entry, in an arbitrary order within
+  // each column, then sorted: positions grow with the row, so that also
+  // sorts each output row by column
+  std::vector<int64_t> positions(nnz);
+  VOVP_INT_TYPE_SWITCH(indices.dtype, T, {
+    auto cols = static_cast<const T *>(indices.data);
+    ParallelItems(num_rows, row_bytes, [&](int64_t begin, int64_t end) {
+      int64_t first = LoadIndex(indptr, begin);
+      int64_t last = LoadIndex(indptr, end);
+      for (int64_t j = first; j < last; j++) {
+        int64_t slot =
+            cursor[cols[j] + 1].fetch_add(1, std::memory_order_relaxed);
+        positions[slot] = j;
+      }
+    });
+  });
+  ParallelItems(num_cols, std::max<int64_t>(1, nnz * 8 / std::max<int64_t>(
+                                                             num_cols, 1)),
+                [&](int64_t begin, int64_t end) {
+                  for (int64_t c = begin; c < end; c++) {
+                    std::sort(positions.begin() + LoadIndex(out_indptr, c),
+                              positions.begin() + LoadIndex(out_indptr, c + 1));
+                  }
+                });
+
+  VOVP_INT_TYPE_SWITCH(indptr.dtype, P, {
+    auto offsets = static_cast<const P *>(indptr.data);
+    ParallelItems(
+        nnz, 16,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t k = begin; k < end; k++) {
+            // Row of the entry: the last row starting at or before it
+            int64_t row = std::upper_bound(offsets, offsets + num_rows + 1,
+                                           positions[k]) -
+                          offsets - 1;
+            StoreIndex(out_indices, k, row);
+            if (data == nullptr) {
+              StoreIndex(out_data, k, positions[k]);
+            }
+          }
+          if (data != nullptr) {
+            int64_t element_size = ElementSize(data->dtype);
+            GatherElements(static_cast<const uint8_t *>(data->data),
+                           positions.data() + begin, end - begin,
+                           element_size,
+                           static_cast<uint8_t *>(out_data.data) +
+                               begin * element_size);
+          }
+        },
+        out_indices.data);
+  });
+}
+
+void SliceRowsIndptr(const ArrayRef &indptr, const ArrayRef &rows,
+                     std::vector<int64_t> *out_indptr) {
+  int64_t num_rows = indptr.length - 1;
+  out_indptr->resize(rows.length + 1);
+  (*out_indptr)[0] = 0;
+  for (int64_t i = 0; i < rows.length; i++) {
+    int64_t row = LoadIndex(rows, i);
+    CHECK(row >= 0 && row < num_rows)
+        << "Row " << row << " is out of range for " << num_rows << " rows";
+    (*out_indptr)[i + 1] = (*out_indptr)[i] + LoadIndex(indptr, row + 1) -
+                           LoadIndex(indptr, row);
+  }
+}
+
+void SliceRows(const ArrayRef &indptr, const ArrayRef &indices,
+               uint32_t encoding, const ArrayRef *data, const ArrayRef &rows,
+               const std::vector<int64_t> &out_indptr,
+               const ArrayRef &out_indices, const ArrayRef *out_data) {
+  int64_t out_nnz = out_indptr.back();
+  int64_t avg_bytes = std::max<int64_t>(
+      1, out_nnz * ElementSize(out_indices.dtype) /
+             std::max<int64_t>(rows.length, 1));
+  VOVP_INT_TYPE_SWITCH(indices.dtype, S, {
+    VOVP_INT_TYPE_SWITCH(out_indices.dtype, D, {
+      auto in = static_cast<const S *>(indices.data);
+      auto out = static_cast<D *>(out_indices.data);
+      ParallelItems(
+          rows.length, avg_bytes,
+          [&](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; i++) {
+              int64_t row = LoadIndex(rows, i);
+              int64_t row_begin = LoadIndex(indptr, row);
+              int64_t row_end = LoadIndex(indptr, row + 1);
+              D *dst = out + out_indptr[i];
+              int64_t value = 0;
+              for (int64_t j = row_begin; j < row_end; j++) {
+                value = encoding == kSparseRowDelta ? value + in[j] : in[j];
+                dst[j - row_begin] = static_cast<D>(value);
+              }
+              if (data != nullptr) {
+                int64_t element_size = ElementSize(data->dtype);
+                std::memcpy(static_cast<uint8_t *>(out_data->data) +
+                                out_indptr[i] * element_size,
+                            static_cast<const uint8_t *>(data->data) +
+                                row_begin * element_size,
+                            (row_end - row_begin) * element_size);
+              }
+            }
+          },
+          out_indices.data);
+    });
+  });
+}
+
+} // namespace vovp
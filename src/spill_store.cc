@@ -0,0 +1,302 @@
+#include "vovp/spill_store.h"
+#include "vovp/copy_engine.h"
+#include "vovp/utils.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace vovp {
+
+namespace {
+
+constexpr uint32_t kSpillMagic = 0x4c505356; // "VSPL"
+constexpr int64_t kSpillAlign = 64;
+
+// Layout of a spill file: this header, the metadata, then the data at a
+// 64-byte aligned offset
+struct SpillHeader {
+  uint32_t magic;
+  uint32_t reserved;
+  int64_t data_size;
+  int64_t metadata_size;
+  int64_t data_offset;
+};
+
+int64_t AlignUp(int64_t size) {
+  return (size + kSpillAlign - 1) / kSpillAlign * kSpillAlign;
+}
+
+// Returns false with errno set if the write fails
+bool WriteAll(int fd, const uint8_t *data, int64_t size, int64_t offset) {
+  while (size > 0) {
+    ssize_t n = pwrite(fd, data, size, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      if (n == 0) {
+        errno = ENOSPC;
+      }
+      return false;
+    }
+    data += n;
+    size -= n;
+    offset += n;
+  }
+  return true;
+}
+
+// Read-only mapping of a spill file
+struct SpillFile {
+  uint8_t *base = nullptr;
+  int64_t size = 0;
+  SpillHeader header;
+
+  ~SpillFile() {
+    if (base != nullptr) {
+      munmap(base, size);
+    }
+  }
+
+  // Returns false if there is no spill file at `path`
+  bool Open(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      CHECK_EQ(errno, ENOENT) << "Cannot open " << path << ": "
+                              << std::strerror(errno);
+      return false;
+    }
+    struct stat st;
+    CHECK_EQ(fstat(fd, &st), 0);
+    size = st.st_size;
+    CHECK_GE(size, static_cast<int64_t>(sizeof(SpillHeader)))
+        << "Truncated spill file " << path;
+    void *ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    CHECK(ptr != MAP_FAILED) << "Cannot map " << path << ": "
+                             << std::strerror(errno);
+    base = static_cast<uint8_t *>(ptr);
+    std::memcpy(&header, base, sizeof(header));
+    CHECK_EQ(header.magic, kSpillMagic) << "Not a spill file: " << path;
+    CHECK_LE(header.data_offset + header.data_size, size)
+        << "Truncated spill file " << path;
+    return true;
+  }
+
+  const uint8_t *metadata() const { return base + sizeof(SpillHeader); }
+  const uint8_t *data() const { return base + header.data_offset; }
+};
+
+} // namespace
+
+SpillStore::SpillStore(const std::string &directory,
+                       std::shared_ptr<ConnectionPool> connections)
+    : directory_(directory), connections(connections) {
+  CHECK_EQ(mkdir(directory.c_str(), 0700) == 0 || errno == EEXIST, true)
+      << "Cannot create spill directory " << directory << ": "
+      << std::strerror(errno);
+}
+
+std::string SpillStore::PathOf(const ObjectID &object_id) const {
+  return directory_ + "/" + object_id.hex() + ".spill";
+}
+
+void SpillStore::Touch(const ObjectID &object_id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  last_access[object_id] = ++clock;
+}
+
+void SpillStore::Pin(const ObjectID &object_id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  pinned.insert(object_id);
+}
+
+void SpillStore::Unpin(const ObjectID &object_id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  pinned.erase(object_id);
+}
+
+bool SpillStore::Contains(const ObjectID &object_id) const {
+  struct stat st;
+  return stat(PathOf(object_id).c_str(), &st) == 0;
+}
+
+bool SpillStore::Spill(PlasmaClient *client, const ObjectID &object_id) {
+  std::vector<ObjectBuffer> buffers;
+  VOVP_CHECK_ARROW(client->Get({object_id}, 0, &buffers));
+  if (!buffers[0].data) {
+    return false;
+  }
+  auto &data = buffers[0].data;
+  auto &metadata = buffers[0].metadata;
+  int64_t metadata_size = metadata ? metadata->size() : 0;
+  SpillHeader header = {kSpillMagic, 0, data->size(), metadata_size,
+                        AlignUp(sizeof(SpillHeader) + metadata_size)};
+  int64_t file_size = header.data_offset + header.data_size;
+
+  // Written under a temporary name and renamed, so a concurrent restore
+  // never sees a partial file. Plain writes rather than a mapping, so that a
+  // full disk is an error instead of a SIGBUS.
+  std::string path = PathOf(object_id);
+  std::string tmp_path = path + ".tmp";
+  int fd = open(tmp_path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0600);
+  CHECK_GE(fd, 0) << "Cannot create " << tmp_path << ": "
+                  << std::strerror(errno);
+  std::vector<uint8_t> head(header.data_offset, 0);
+  std::memcpy(head.data(), &header, sizeof(header));
+  if (metadata_size > 0) {
+    std::memcpy(head.data() + sizeof(header), metadata->data(), metadata_size);
+  }
+  struct stat st;
+  bool written = WriteAll(fd, head.data(), head.size(), 0) &&
+                 WriteAll(fd, data->data(), header.data_size,
+                          header.data_offset) &&
+                 fstat(fd, &st) == 0;
+  int error = errno;
+  close(fd);
+  if (!written) {
+    unlink(tmp_path.c_str());
+    LOG(FATAL) << "Cannot write " << tmp_path << ": " << std::strerror(error);
+  }
+  // Restore trusts the header sizes, so a short file must not be published
+  if (st.st_size != file_size) {
+    unlink(tmp_path.c_str());
+    LOG(FATAL) << "Spill file " << tmp_path << " has " << st.st_size
+               << " bytes, expected " << file_size;
+  }
+  CHECK_EQ(rename(tmp_path.c_str(), path.c_str()), 0)
+      << "Cannot rename " << tmp_path << ": " << std::strerror(errno);
+  return true;
+}
+
+void SpillStore::Forget(const ObjectID &object_id) {
+  std::string path = PathOf(object_id);
+  CHECK(unlink(path.c_str()) == 0 || errno == ENOENT)
+      << "Cannot remove " << path << ": " << std::strerror(errno);
+  std::lock_guard<std::mutex> lock(mutex);
+  last_access.erase(object_id);
+}
+
+int64_t SpillStore::Evict(int64_t needed) {
+  std::lock_guard<std::mutex> evict_lock(evict_mutex);
+  auto conn = connections->Acquire();
+  ObjectTable table;
+  VOVP_CHECK_ARROW(conn->client->List(&table));
+
+  struct Candidate {
+    ObjectID object_id;
+    uint64_t last_access;
+    int64_t create_time;
+    int64_t size;
+  };
+  std::vector<Candidate> candidates;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &kv : table) {
+      const auto &entry = *kv.second;
+      if (entry.state != ObjectState::PLASMA_SEALED || entry.ref_count > 0 ||
+          entry.device_num != 0 || pinned.count(kv.first)) {
+        continue;
+      }
+      auto it = last_access.find(kv.first);
+      candidates.push_back({kv.first,
+                            it == last_access.end() ? 0 : it->second,
+                            entry.create_time,
+                            entry.data_size + entry.metadata_size});
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate &a, const Candidate &b) {
+              if (a.last_access != b.last_access) {
+                return a.last_access < b.last_access;
+              }
+              return a.create_time < b.create_time;
+            });
+
+  int64_t freed = 0;
+  for (auto &candidate : candidates) {
+    if (freed >= needed) {
+      break;
+    }
+    if (!Spill(conn->client.get(), candidate.object_id)) {
+      continue;
+    }
+    // Takes effect now unless a client got the object since the List
+    VOVP_CHECK_ARROW(conn->client->Delete(candidate.object_id));
+    freed += candidate.size;
+    spilled_objects_++;
+    spilled_bytes_ += candidate.size;
+    std::lock_guard<std::mutex> lock(mutex);
+    last_access.erase(candidate.object_id);
+  }
+  return freed;
+}
+
+std::shared_future<void> SpillStore::RestoreAsync(const ObjectID &object_id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = pending_restores.find(object_id);
+  if (it != pending_restores.end()) {
+    return it->second;
+  }
+  if (!restore_worker) {
+    restore_worker.reset(new AsyncWorker(1));
+  }
+  std::shared_future<void> future =
+      restore_worker->Submit([this, object_id]() {
+        try {
+          Restore(object_id);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(mutex);
+          pending_restores.erase(object_id);
+          throw;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        pending_restores.erase(object_id);
+      }).share();
+  pending_restores[object_id] = future;
+  return future;
+}
+
+void SpillStore::Restore(const ObjectID &object_id) {
+  std::string path = PathOf(object_id);
+  SpillFile file;
+  if (!file.Open(path)) {
+    // Not spilled, or restored by another process meanwhile
+    return;
+  }
+  const auto &header = file.header;
+  auto conn = connections->Acquire();
+  std::shared_ptr<Buffer> buffer;
+  for (int attempt = 0;; attempt++) {
+    auto status = conn->client->Create(object_id, header.data_size,
+                                       file.metadata(), header.metadata_size,
+                                       &buffer);
+    if (status.ok()) {
+      break;
+    }
+    if (IsPlasmaObjectExists(status)) {
+      // Restored by another process, or put again: the file is stale
+      unlink(path.c_str());
+      return;
+    }
+    CHECK(IsPlasmaStoreFull(status) && attempt < 3)
+        << "Cannot restore " << object_id.hex() << ": " << status.ToString();
+    Evict(header.data_size + header.metadata_size);
+  }
+  CopyEngine::Global().Memcpy(buffer->mutable_data(), file.data(),
+                              header.data_size);
+  VOVP_CHECK_ARROW(conn->client->Seal(object_id));
+  VOVP_CHECK_ARROW(conn->client->Release(object_id));
+  unlink(path.c_str());
+  restored_objects_++;
+  restored_bytes_ += header.data_size + header.metadata_size;
+  Touch(object_id);
+}
+
+} // namespace vovp
@@ -0,0 +1,179 @@
+#include "vovp/store_router.h"
+#include "vovp/utils.h"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace vovp {
+
+namespace {
+
+thread_local int node_hint = -1;
+
+// From linux/mempolicy.h
+constexpr int kMpolPreferred = 1;
+constexpr int kMaxNodes = 1024;
+constexpr int kBitsPerWord = 8 * sizeof(unsigned long);
+
+// Directory entries kept before arbitrary ones are evicted. Entries are
+// only hints, checked against the store on every lookup.
+constexpr size_t kMaxDirectorySize = 1 << 20;
+
+} // namespace
+
+StoreRouter::StoreRouter(const std::vector<std::string> &socket_names,
+                         const std::vector<int> &nodes, int num_connections,
+                         const std::shared_ptr<Metrics> &metrics) {
+  CHECK(!socket_names.empty() &&
+        socket_names.size() <= static_cast<size_t>(kMaxStores))
+      << "Expected 1 to " << kMaxStores << " store sockets";
+  CHECK(nodes.empty() || nodes.size() == socket_names.size())
+      << "Expected one NUMA node per store socket";
+  for (size_t i = 0; i < socket_names.size(); i++) {
+    auto store = std::make_shared<ConnectionPool>(socket_names[i],
+                                                  num_connections, metrics);
+    // Stores default to one per node, in node order
+    int node = nodes.empty() ? static_cast<int>(i) : nodes[i];
+    CHECK(node >= 0 && node < kMaxNodes) << "Invalid NUMA node " << node;
+    store->set_node(node);
+    stores.push_back(store);
+  }
+}
+
+void StoreRouter::SetPlacement(Placement placement) {
+  policy.store(static_cast<int>(placement), std::memory_order_relaxed);
+}
+
+void StoreRouter::SetNodeHint(int node) { node_hint = node; }
+
+int StoreRouter::NodeHint() { return node_hint; }
+
+int StoreRouter::CurrentNode() {
+  unsigned cpu = 0;
+  unsigned node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+    return 0;
+  }
+  return static_cast<int>(node);
+}
+
+void StoreRouter::BindToNode(void *data, int64_t size, int node) {
+  if (node < 0 || node >= kMaxNodes || size < kNodeBindThreshold) {
+    return;
+  }
+  // Whole pages only: the pages cut by the range hold neighbours in the
+  // same store
+  uintptr_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t address = reinterpret_cast<uintptr_t>(data);
+  uintptr_t begin = (address + page - 1) / page * page;
+  uintptr_t end = (address + size) / page * page;
+  if (begin >= end) {
+    return;
+  }
+  unsigned long mask[kMaxNodes / kBitsPerWord] = {0};
+  mask[node / kBitsPerWord] = 1UL << (node % kBitsPerWord);
+  // Best effort: without the syscall pages stay where they are touched
+  syscall(SYS_mbind, begin, end - begin, kMpolPreferred, mask, kMaxNodes + 1,
+          0);
+}
+
+int StoreRouter::StoreOfNode(int node) const {
+  for (size_t i = 0; i < stores.size(); i++) {
+    if (stores[i]->node() == node) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+int StoreRouter::LocalStore() const {
+  int store = StoreOfNode(CurrentNode());
+  return store < 0 ? 0 : store;
+}
+
+int StoreRouter::Place() {
+  int hint = NodeHint();
+  if (hint >= 0) {
+    int store = StoreOfNode(hint);
+    CHECK_GE(store, 0) << "No store on NUMA node " << hint;
+    return store;
+  }
+  if (placement() == Placement::kInterleave) {
+    return next.fetch_add(1, std::memory_order_relaxed) % stores.size();
+  }
+  return LocalStore();
+}
+
+void StoreRouter::Assign(const ObjectID &object_id, int store) {
+  std::lock_guard<std::mutex> lock(mutex);
+  MakeRoom(object_id);
+  directory[object_id] = uint64_t(1) << store;
+}
+
+void StoreRouter::AddCopy(const ObjectID &object_id, int store) {
+  std::lock_guard<std::mutex> lock(mutex);
+  MakeRoom(object_id);
+  directory[object_id] |= uint64_t(1) << store;
+}
+
+void StoreRouter::RemoveCopy(const ObjectID &object_id, int store) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = directory.find(object_id);
+  if (it != directory.end() &&
+      (it->second &= ~(uint64_t(1) << store)) == 0) {
+    directory.erase(it);
+  }
+}
+
+void StoreRouter::MakeRoom(const ObjectID &object_id) {
+  if (directory.size() >= kMaxDirectorySize &&
+      directory.find(object_id) == directory.end()) {
+    directory.erase(directory.begin());
+  }
+}
+
+bool StoreRouter::Holds(int store, const ObjectID &object_id) {
+  bool sealed = false;
+  auto conn = stores[store]->Acquire();
+  VOVP_CHECK_ARROW(conn->client->Contains(object_id, &sealed));
+  return sealed;
+}
+
+uint64_t StoreRouter::Copies(const ObjectID &object_id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = directory.find(object_id);
+  return it == directory.end() ? 0 : it->second;
+}
+
+void StoreRouter::Forget(const ObjectID &object_id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  directory.erase(object_id);
+}
+
+int StoreRouter::Locate(const ObjectID &object_id) {
+  int local = LocalStore();
+  // Copies deleted by views, other processes or evictions are only noticed
+  // here, so every known copy is checked before it is returned
+  uint64_t copies = Copies(object_id);
+  uint64_t checked = copies;
+  while (copies != 0) {
+    int store = copies >> local & 1 ? local : __builtin_ctzll(copies);
+    if (Holds(store, object_id)) {
+      return store;
+    }
+    RemoveCopy(object_id, store);
+    copies &= ~(uint64_t(1) << store);
+  }
+  for (size_t i = 0; i < stores.size(); i++) {
+    // The local store first, then the others in order
+    int store = static_cast<int>(i == 0 ? local
+                                        : i <= size_t(local) ? i - 1 : i);
+    if (!(checked >> store & 1) && Holds(store, object_id)) {
+      AddCopy(object_id, store);
+      return store;
+    }
+  }
+  return -1;
+}
+
+} // namespace vovp
@@ -0,0 +1,263 @@
+#include "vovp/tensor_channel.h"
+#include "vovp/copy_engine.h"
+#include "vovp/copy_utils.h"
+#include "vovp/ndarray_utils.h"
+#include "vovp/utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <thread>
+
+namespace vovp {
+
+namespace {
+
+int64_t AlignUp(int64_t size) { return (size + 63) / 64 * 64; }
+
+// ChannelSlot::ndim of a position whose send failed after claiming it
+constexpr int32_t kEmptySlot = -1;
+
+// Spin, then yield, then sleep for up to 100us between polls until the
+// deadline. Polling keeps the fast path free of any syscall.
+class Backoff {
+public:
+  explicit Backoff(int64_t timeout_ms)
+      : timeout_ms(timeout_ms),
+        deadline(std::chrono::steady_clock::now() +
+                 std::chrono::milliseconds(std::max<int64_t>(timeout_ms, 0))) {
+  }
+
+  // Returns false once the timeout has passed
+  bool Wait() {
+    if (timeout_ms == 0) {
+      return false;
+    }
+    if (timeout_ms > 0 && std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+    if (rounds < 64) {
+      // Busy spin
+    } else if (rounds < 128) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(
+          std::min<int64_t>(1 << std::min<int64_t>(rounds - 128, 7), 100)));
+    }
+    rounds++;
+    return true;
+  }
+
+private:
+  int64_t timeout_ms;
+  std::chrono::steady_clock::time_point deadline;
+  int64_t rounds = 0;
+};
+
+} // namespace
+
+int64_t TensorChannel::BufferSize(int64_t num_slots, int64_t slot_bytes) {
+  return sizeof(ChannelHeader) +
+         num_slots * (sizeof(ChannelSlot) + AlignUp(slot_bytes));
+}
+
+void TensorChannel::Init(uint8_t *data, int64_t num_slots, int64_t slot_bytes) {
+  CHECK_GT(num_slots, 0);
+  CHECK_GT(slot_bytes, 0);
+  std::memset(data, 0, sizeof(ChannelHeader));
+  auto header = new (data) ChannelHeader();
+  header->magic = kChannelMagic;
+  header->num_slots = num_slots;
+  header->slot_bytes = slot_bytes;
+  header->slot_stride = sizeof(ChannelSlot) + AlignUp(slot_bytes);
+  header->head.store(0, std::memory_order_relaxed);
+  header->tail.store(0, std::memory_order_relaxed);
+  for (int64_t i = 0; i < num_slots; i++) {
+    uint8_t *ptr = data + sizeof(ChannelHeader) + i * header->slot_stride;
+    std::memset(ptr, 0, sizeof(ChannelSlot));
+    auto slot = new (ptr) ChannelSlot();
+    slot->sequence.store(i, std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+TensorChannel::TensorChannel(std::shared_ptr<Buffer> buffer,
+                             std::shared_ptr<Metrics> metrics)
+    : buffer(buffer), metrics(metrics) {
+  CHECK(buffer->is_cpu()) << "Channels live in CPU memory";
+  CHECK_GE(buffer->size(), static_cast<int64_t>(sizeof(ChannelHeader)));
+  // Store memory is mapped writable in every client
+  header = reinterpret_cast<ChannelHeader *>(
+      const_cast<uint8_t *>(buffer->data()));
+  CHECK_EQ(header->magic, kChannelMagic) << "Not a tensor channel";
+  CHECK_EQ(buffer->size(), BufferSize(header->num_slots, header->slot_bytes))
+      << "Truncated tensor channel";
+}
+
+ChannelSlot *TensorChannel::SlotAt(uint64_t position) const {
+  auto base = reinterpret_cast<uint8_t *>(header) + sizeof(ChannelHeader);
+  return reinterpret_cast<ChannelSlot *>(
+      base + (position % header->num_slots) * header->slot_stride);
+}
+
+int64_t TensorChannel::Size() const {
+  uint64_t tail = header->tail.load(std::memory_order_relaxed);
+  uint64_t head = header->head.load(std::memory_order_relaxed);
+  return head > tail ? head - tail : 0;
+}
+
+bool TensorChannel::Send(DLManagedTensor *tensor, int64_t timeout_ms) {
+  const DLTensor &dl_tensor = tensor->dl_tensor;
+  CHECK(dl_tensor.ctx.device_type == kDLCPU)
+      << "Channels only carry CPU tensors";
+  CHECK_LE(dl_tensor.ndim, kChannelMaxDims)
+      << "Channels carry tensors of at most " << kChannelMaxDims
+      << " dimensions";
+  int64_t data_size = GetDataSize(dl_tensor.dtype, dl_tensor.shape,
+                                  dl_tensor.ndim);
+  CHECK_LE(data_size, header->slot_bytes)
+      << "Tensor of " << data_size << " bytes does not fit in a slot of "
+      << header->slot_bytes;
+
+  // Claim a position whose slot has been drained
+  Backoff backoff(timeout_ms);
+  uint64_t position = header->head.load(std::memory_order_relaxed);
+  ChannelSlot *slot;
+  while (true) {
+    slot = SlotAt(position);
+    uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    int64_t diff = static_cast<int64_t>(sequence - position);
+    if (diff == 0) {
+      if (header->head.compare_exchange_weak(position, position + 1,
+                                             std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // Full
+      if (!backoff.Wait()) {
+        return false;
+      }
+      position = header->head.load(std::memory_order_relaxed);
+    } else {
+      // Another sender took this position
+      position = header->head.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->ndim = dl_tensor.ndim;
+  slot->dtype = dl_tensor.dtype;
+  slot->data_size = data_size;
+  std::copy(dl_tensor.shape, dl_tensor.shape + dl_tensor.ndim, slot->shape);
+  auto payload = reinterpret_cast<uint8_t *>(slot) + sizeof(ChannelSlot);
+  try {
+    VOVP_METRICS_SCOPE(metrics.get(), kCopy);
+    if (metrics) {
+      VOVP_METRICS_ADD_BYTES(metrics, kDLCPU, data_size);
+    }
+    if (IsContiguous(tensor)) {
+      CopyEngine::Global().Memcpy(
+          payload,
+          static_cast<const char *>(dl_tensor.data) + dl_tensor.byte_offset,
+          data_size);
+    } else {
+      StridedCopy(payload, dl_tensor);
+    }
+  } catch (...) {
+    // The position cannot be given back once later sends claimed theirs, so
+    // it is published empty and receivers skip it
+    slot->ndim = kEmptySlot;
+    slot->sequence.store(position + 1, std::memory_order_release);
+    throw;
+  }
+  slot->sequence.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+bool TensorChannel::Receive(int64_t timeout_ms, DLManagedTensor *out,
+                            DLManagedTensor **result) {
+  if (out != nullptr) {
+    CHECK(out->dl_tensor.ctx.device_type == kDLCPU && IsContiguous(out))
+        << "Output must be a contiguous CPU tensor";
+  }
+  // Claim the oldest filled position, skipping those of failed sends
+  Backoff backoff(timeout_ms);
+  uint64_t position = header->tail.load(std::memory_order_relaxed);
+  ChannelSlot *slot;
+  while (true) {
+    slot = SlotAt(position);
+    uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    int64_t diff = static_cast<int64_t>(sequence - (position + 1));
+    if (diff == 0) {
+      if (header->tail.compare_exchange_weak(position, position + 1,
+                                             std::memory_order_relaxed)) {
+        if (slot->ndim != kEmptySlot) {
+          break;
+        }
+        slot->sequence.store(position + header->num_slots,
+                             std::memory_order_release);
+        position++;
+      }
+    } else if (diff < 0) {
+      // Empty
+      if (!backoff.Wait()) {
+        return false;
+      }
+      position = header->tail.load(std::memory_order_relaxed);
+    } else {
+      // Another receiver took this position
+      position = header->tail.load(std::memory_order_relaxed);
+    }
+  }
+
+  // The slot is ours until its sequence moves on, so a bad output is only
+  // reported after the slot is handed back
+  const char *error = nullptr;
+  auto payload = reinterpret_cast<const uint8_t *>(slot) + sizeof(ChannelSlot);
+  void *dst = nullptr;
+  DLManagedTensor *received = nullptr;
+  if (out != nullptr) {
+    const DLTensor &out_tensor = out->dl_tensor;
+    if (out_tensor.dtype.code != slot->dtype.code ||
+        out_tensor.dtype.bits != slot->dtype.bits ||
+        out_tensor.dtype.lanes != slot->dtype.lanes ||
+        out_tensor.ndim != slot->ndim ||
+        !std::equal(slot->shape, slot->shape + slot->ndim, out_tensor.shape)) {
+      error = "Output does not match the received tensor";
+    } else {
+      dst = static_cast<char *>(out_tensor.data) + out_tensor.byte_offset;
+    }
+  }
+  try {
+    if (out == nullptr) {
+      received = NewHostTensor(slot->shape, slot->ndim, slot->dtype);
+      dst = received->dl_tensor.data;
+    }
+    if (dst != nullptr) {
+      VOVP_METRICS_SCOPE(metrics.get(), kCopy);
+      if (metrics) {
+        VOVP_METRICS_ADD_BYTES(metrics, kDLCPU, slot->data_size);
+      }
+      CopyEngine::Global().Memcpy(dst, payload, slot->data_size);
+    }
+  } catch (...) {
+    // Hand the slot back so later sends can reuse it; the tensor is lost
+    if (received != nullptr) {
+      received->deleter(received);
+    }
+    slot->sequence.store(position + header->num_slots,
+                         std::memory_order_release);
+    throw;
+  }
+  slot->sequence.store(position + header->num_slots,
+                       std::memory_order_release);
+  if (error != nullptr) {
+    LOG(FATAL) << error;
+  }
+  if (result != nullptr) {
+    *result = received;
+  }
+  return true;
+}
+
+} // namespace vovp
@@ -0,0 +1,58 @@
+#include "vovp/tensor_header.h"
+#include <cstring>
+
+namespace vovp {
+
+std::string EncodeTensorHeader(const DLContext &ctx, const DLDataType &dtype,
+                               int ndim, const int64_t *shape,
+                               const int64_t *strides, uint64_t byte_offset) {
+  std::string metadata(TensorHeaderSize(ndim), '\0');
+  TensorHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = kTensorHeaderMagic;
+  header.version = kTensorHeaderVersion;
+  header.ndim = static_cast<uint16_t>(ndim);
+  header.device_type = static_cast<int32_t>(ctx.device_type);
+  header.device_id = ctx.device_id;
+  header.dtype = dtype;
+  header.header_size = static_cast<uint32_t>(metadata.size());
+  header.byte_offset = byte_offset;
+
+  char *ptr = &metadata[0];
+  std::memcpy(ptr, &header, sizeof(header));
+  int64_t *shape_ptr = reinterpret_cast<int64_t *>(ptr + sizeof(header));
+  int64_t *strides_ptr = shape_ptr + ndim;
+  std::memcpy(shape_ptr, shape, ndim * sizeof(int64_t));
+  if (strides != nullptr) {
+    std::memcpy(strides_ptr, strides, ndim * sizeof(int64_t));
+  } else if (ndim > 0) {
+    strides_ptr[ndim - 1] = 1;
+    for (int i = ndim - 2; i >= 0; --i) {
+      strides_ptr[i] = shape[i + 1] * strides_ptr[i + 1];
+    }
+  }
+  return metadata;
+}
+
+bool DecodeTensorHeader(const uint8_t *data, int64_t size,
+                        TensorHeader *header) {
+  if (size < static_cast<int64_t>(sizeof(TensorHeader))) {
+    return false;
+  }
+  // Plasma places the metadata right after the data, so it is not aligned
+  std::memcpy(header, data, sizeof(TensorHeader));
+  return header->magic == kTensorHeaderMagic &&
+         header->version == kTensorHeaderVersion &&
+         header->header_size == TensorHeaderSize(header->ndim) &&
+         size >= header->header_size;
+}
+
+void DecodeTensorHeaderArrays(const uint8_t *data, int ndim, int64_t *shape,
+                              int64_t *strides) {
+  const uint8_t *arrays = data + sizeof(TensorHeader);
+  std::memcpy(shape, arrays, ndim * sizeof(int64_t));
+  std::memcpy(strides, arrays + ndim * sizeof(int64_t),
+              ndim * sizeof(int64_t));
+}
+
+} // namespace vovp
@@ -13,7 +13,585 @@ def test_basic_client():
     ret_a[0][0] = 999
     assert th.equal(ret_a, ret_b)
     del ret_b, ret_c, ret_a, a
+    client.flush()
     client.list()
 
 
+def test_batch_client():
+    client = vovp.init_client("/tmp/dgl_socket")
+    tensors = [th.arange(10), th.rand(3, 4), th.ones(2, 2, dtype=th.int32)]
+    ids = ["batch_a", "batch_b", "batch_c"]
+    client.reset_stats()
+    ret_put = client.put_tensors(ids, tensors)
+    stats = client.stats()
+    if stats["enabled"]:
+        # Small tensors are created and sealed in one request
+        assert stats["phases"]["create_batch"]["count"] == 1
+        assert "create" not in stats["phases"]
+        assert "seal" not in stats["phases"]
+    ret_get = client.get_tensors(ids)
+    for a, b, c in zip(tensors, ret_put, ret_get):
+        assert th.equal(a, b)
+        assert th.equal(a, c)
+    # A failed batch leaves none of its objects behind, including the large
+    # ones put before the small ones
+    client.flush()
+    from torch.utils.dlpack import to_dlpack
+    try:
+        client.plasma_client.put_tensors(
+            [to_dlpack(th.rand(512, 1024)), to_dlpack(th.rand(4))],
+            ["batch_d", "batch_a"], False, False)
+    except Exception:
+        pass
+    else:
+        assert False, "put over an existing object should fail"
+    assert not client.wait_tensor("batch_d", timeout=0)
+    # Batched gets wait up to the given timeout
+    import time
+    start = time.time()
+    try:
+        client.get_tensors(["batch_a", "batch_missing"], timeout=0.1)
+    except TimeoutError:
+        pass
+    else:
+        assert False, "get of a missing object should time out"
+    assert time.time() - start < 0.9
+    del ret_put, ret_get
+
+
+def test_strided_client():
+    client = vovp.init_client("/tmp/dgl_socket")
+    a = th.rand(64, 48)
+    tensors = [a.t(), a[:, 1::3], th.arange(4).expand(5, 4)]
+    for i, t in enumerate(tensors):
+        ret_put = client.put_tensor("strided_%d" % i, t)
+        ret_get = client.get_tensor("strided_%d" % i)
+        assert ret_put.is_contiguous()
+        assert th.equal(t, ret_put)
+        assert th.equal(t, ret_get)
+    del ret_put, ret_get
+
+
+def test_cache_client():
+    client = vovp.init_client("/tmp/dgl_socket")
+    a = th.arange(16).reshape(4, 4)
+    ret_put = client.put_tensor("cache_a", a)
+    client.reset_cache_stats()
+    ret_b = client.get_tensor("cache_a")
+    ret_c = client.get_tensor("cache_a")
+    stats = client.cache_stats()
+    assert stats["misses"] == 1 and stats["hits"] == 1
+    assert ret_b.data_ptr() == ret_c.data_ptr()
+    assert th.equal(a, ret_c)
+    del ret_b, ret_c, ret_put
+    ret_put = client.put_tensor("cache_a", a + 1)
+    assert th.equal(client.get_tensor("cache_a"), a + 1)
+    del ret_put
+
+
+def test_unsealed_client():
+    client = vovp.init_client("/tmp/dgl_socket")
+    out = client.create_tensor("unsealed_a", (3, 4), th.float32, seal=False)
+    th.rand(3, 4, out=out)
+    client.seal("unsealed_a")
+    assert th.equal(client.get_tensor("unsealed_a"), out)
+    aborted = client.create_tensor("unsealed_b", (8,), th.int64, seal=False)
+    del aborted
+    client.abort("unsealed_b")
+    del out
+    for i, dtype in enumerate((th.bool, th.bfloat16, th.complex64, th.int16)):
+        created = client.create_tensor("unsealed_c%d" % i, (4,), dtype)
+        assert created.dtype == dtype
+        del created
+
+
+def test_release_client():
+    from torch.utils.dlpack import to_dlpack
+    client = vovp.init_client("/tmp/dgl_socket")
+    client.put_tensor("release_a", th.rand(16))
+    # The view's own reference is released, and only once
+    dlp = client.plasma_client.get_tensor("release_a", 1000, False)
+    client.plasma_client.release(dlp)
+    try:
+        client.plasma_client.release(dlp)
+        assert False, "released twice"
+    except ValueError:
+        pass
+    try:
+        client.plasma_client.release(to_dlpack(th.rand(4)))
+        assert False, "released a tensor outside the store"
+    except ValueError:
+        pass
+    del dlp
+    client.delete("release_a")
+
+
+def test_async_client():
+    client = vovp.init_client("/tmp/dgl_socket")
+    tensors = [th.rand(256, 256) for _ in range(4)]
+    futures = [client.put_tensor_async("async_%d" % i, t)
+               for i, t in enumerate(tensors)]
+    for t, f in zip(tensors, futures):
+        assert th.equal(t, f.result())
+    ret = client.get_tensor_async("async_0").result()
+    assert th.equal(tensors[0], ret)
+    del futures, ret
+
+
+def test_gather_client():
+    client = vovp.init_client("/tmp/dgl_socket")
+    feat = th.rand(1000, 16)
+    ret_put = client.put_tensor("gather_feat", feat)
+    index = th.randint(0, 1000, (300,))
+    expected = th.index_select(feat, 0, index)
+    assert th.equal(client.gather_rows("gather_feat", index), expected)
+    assert th.equal(client.gather_rows("gather_feat", index.int()), expected)
+    out = th.empty(300, 16)
+    client.gather_rows("gather_feat", index, out=out)
+    assert th.equal(out, expected)
+    ret_store = client.gather_rows("gather_feat", index,
+                                   out_object_id="gather_out")
+    assert th.equal(ret_store, expected)
+    assert th.equal(client.get_tensor("gather_out"), expected)
+    del ret_put, ret_store
+
+
+def test_pickle_client():
+    from multiprocessing.reduction import ForkingPickler
+    from vovp.multiprocessing import init_reduction
+    client = vovp.init_client("/tmp/dgl_socket")
+    init_reduction()
+    ret_put = client.put_tensor("pickle_src", th.rand(256, 64))
+    view = ret_put[2:, 1::2]
+    buf = ForkingPickler.dumps(view)
+    # Store-backed tensors are pickled by ObjectID, not by value
+    assert len(buf) < view.numel() * view.element_size()
+    ret = ForkingPickler.loads(buf)
+    assert th.equal(ret, view)
+    ret_put[3][1] = -1
+    assert th.equal(ret, view)
+    # The receiver acked, and freeing its view leaves the sender's object
+    from vovp import multiprocessing as vovp_mp
+    vovp_mp._collect_leases(client)
+    assert not vovp_mp._leases
+    del ret
+    client.flush()
+    ret = client.get_tensor("pickle_src", delete_on_free=False)
+    assert th.equal(ret[2:, 1::2], view)
+    del ret, view, ret_put
+
+
+def test_stats_client():
+    client = vovp.init_client("/tmp/dgl_socket")
+    client.reset_stats()
+    ret_put = client.put_tensor("stats_a", th.rand(64, 64))
+    ret_get = client.get_tensor("stats_a")
+    stats = client.stats()
+    if stats["enabled"]:
+        for phase in ["create", "copy", "seal"]:
+            assert stats["phases"][phase]["count"] >= 1
+        assert stats["bytes_copied"]["cpu"] >= 64 * 64 * 4
+    assert stats["live_tensors"] >= 2
+    assert stats["store_bytes"] >= 64 * 64 * 4
+    client.flush()
+    client.reset_stats()
+    assert client.stats()["phases"] == {}
+    del ret_put, ret_get
+
+
+def test_threads_client():
+    from concurrent.futures import ThreadPoolExecutor
+    client = vovp.init_client("/tmp/dgl_socket", num_connections=4)
+    tensors = [th.rand(128, 128) for _ in range(16)]
+    ids = ["threads_%d" % i for i in range(16)]
+    with ThreadPoolExecutor(8) as pool:
+        ret_put = list(pool.map(client.put_tensor, ids, tensors))
+        ret_get = list(pool.map(client.get_tensor, ids))
+        # Views are freed on other threads than the ones that got them
+        list(pool.map(lambda t: t.sum(), ret_put))
+    for a, b, c in zip(tensors, ret_put, ret_get):
+        assert th.equal(a, b)
+        assert th.equal(a, c)
+    del ret_put, ret_get
+    client.flush()
+
+
+def test_spill_client():
+    import tempfile
+    client = vovp.init_client("/tmp/dgl_socket")
+    client.enable_spill(tempfile.mkdtemp())
+    a = th.rand(256, 256)
+    ret_put = client.put_tensor("spill_a", a)
+    client.pin("spill_a")
+    client.prefetch(["spill_a"])
+    assert th.equal(client.get_tensor("spill_a"), a)
+    client.unpin("spill_a")
+    del ret_put
+
+    # Put 1.5x the store capacity. Contents are regenerated from their seed
+    # for the comparison instead of being kept around.
+    def chunk(i):
+        gen = th.Generator().manual_seed(i)
+        return th.randint(0, 256, (chunk_size,), dtype=th.uint8, generator=gen)
+    chunk_size = client.stats()["store_capacity"] // 8
+    num_chunks = 12
+    for i in range(num_chunks):
+        ret = client.put_tensor("spill_chunk_%d" % i, chunk(i))
+        del ret
+        client.flush()
+    spill = client.stats()["spill"]
+    assert spill["enabled"]
+    assert spill["spilled_objects"] > 0
+    for i in range(num_chunks):
+        ret = client.get_tensor("spill_chunk_%d" % i, delete_on_free=False)
+        assert th.equal(ret, chunk(i))
+        del ret
+        client.flush()
+    assert client.stats()["spill"]["restored_objects"] > 0
+    # A deleted object does not come back from its spill file
+    client.delete("spill_chunk_0")
+    ret = client.put_tensor("spill_chunk_0", chunk(100))
+    assert th.equal(client.get_tensor("spill_chunk_0", delete_on_free=False),
+                    chunk(100))
+    del ret
+    for i in range(num_chunks):
+        client.delete("spill_chunk_%d" % i)
+
+
+def test_snapshot_client():
+    import os
+    import tempfile
+    client = vovp.init_client("/tmp/dgl_socket")
+    a = th.rand(128, 64)
+    ret_put = client.put_tensor("snapshot_a", a)
+    path = os.path.join(tempfile.mkdtemp(), "store.snapshot")
+    assert client.snapshot(path, ["snapshot_a"]) == 1
+    del ret_put
+    client.flush()
+    client.delete("snapshot_a")
+    assert client.restore(path, use_mmap=True) == 1
+    assert th.equal(client.get_tensor("snapshot_a"), a)
+    # Existing objects are skipped
+    assert client.restore(path) == 0
+
+
+def test_update_client():
+    client = vovp.init_client("/tmp/dgl_socket")
+    a = th.rand(64, 32)
+    ret_update = client.update_tensor("update_a", a)
+    assert th.equal(ret_update, a)
+    version = client.tensor_version("update_a")
+    assert version == 0
+    view = client.get_tensor("update_a")
+    b = th.rand(64, 32)
+    client.update_tensor("update_a", b)
+    # Same dtype and shape: overwritten in place, visible through the view
+    assert th.equal(view, b)
+    assert client.tensor_version("update_a") == version + 2
+    copy, read_version = client.read_tensor("update_a")
+    assert th.equal(copy, b) and read_version == version + 2
+    del view, ret_update
+    client.flush()
+    # A new shape reallocates
+    c = th.rand(16)
+    assert th.equal(client.update_tensor("update_a", c), c)
+    assert client.tensor_version("update_a") == 0
+    # Dropping the result of an in-place update keeps the object
+    d = th.rand(16)
+    client.update_tensor("update_a", d)
+    client.flush()
+    assert th.equal(client.get_tensor("update_a", delete_on_free=False), d)
+
+
+def test_channel_client():
+    import pickle
+    import threading
+    client = vovp.init_client("/tmp/dgl_socket")
+    channel = client.open_channel("channel_a", num_slots=4, slot_bytes=1 << 16)
+    assert channel.recv(block=False) is None
+    a = th.rand(32, 16)
+    assert channel.send(a)
+    assert channel.qsize() == 1
+    assert th.equal(channel.recv(), a)
+    out = th.empty(8, dtype=th.int64)
+    channel.send(th.arange(8))
+    assert th.equal(channel.recv(out=out), th.arange(8))
+    for i in range(4):
+        assert channel.send(th.full((4,), i))
+    # Full
+    assert not channel.send(th.zeros(4), timeout=0.01)
+    for i in range(4):
+        assert channel.recv()[0].item() == i
+
+    # A pickled channel attaches to the same slots
+    reopened = pickle.loads(pickle.dumps(channel))
+    received = []
+    consumer = threading.Thread(
+        target=lambda: received.extend(reopened.recv() for _ in range(100)))
+    consumer.start()
+    for i in range(100):
+        channel.send(th.full((64,), float(i)))
+    consumer.join()
+    assert [t[0].item() for t in received] == [float(i) for i in range(100)]
+
+
+def test_bundle_client():
+    client = vovp.init_client("/tmp/dgl_socket")
+    batch = {
+        "feat": th.rand(100, 16),
+        "label": th.randint(0, 10, (100,)),
+        "indptr": th.arange(0, 101, dtype=th.int32),
+        "eid": th.arange(300)[::3],
+        "empty": th.zeros(0),
+    }
+    client.put_bundle("bundle_a", batch)
+    ret = client.get_bundle("bundle_a")
+    assert list(ret.keys()) == list(batch.keys())
+    for name, tensor in batch.items():
+        assert ret[name].dtype == tensor.dtype
+        assert th.equal(ret[name], tensor)
+        if tensor.numel() > 0:
+            # Members are cache-line aligned
+            assert ret[name].data_ptr() % 64 == 0
+    del ret
+
+
+def test_wait_client():
+    import threading
+    import time
+    client = vovp.init_client("/tmp/dgl_socket")
+    try:
+        client.get_tensor("wait_missing", timeout=0.01)
+        assert False
+    except TimeoutError:
+        pass
+    assert not client.wait_tensor("wait_missing", timeout=0.01)
+    assert client.wait_any(["wait_missing", "wait_b"], timeout=0.01) is None
+
+    a = th.rand(16)
+    producer = threading.Timer(0.05, lambda: client.put_tensor("wait_b", a))
+    producer.start()
+    start = time.time()
+    assert client.wait_any(["wait_missing", "wait_b"], timeout=5) == "wait_b"
+    assert time.time() - start < 5
+    assert client.wait_tensor("wait_b", timeout=0)
+    assert th.equal(client.get_tensor("wait_b", timeout=None), a)
+    producer.join()
+
+
+def test_prefault_client():
+    client = vovp.init_client("/tmp/dgl_socket")
+    saved = client.copy_options()
+    client.set_copy_options(prefault_threshold=1 << 20,
+                            huge_page_align_threshold=1 << 20)
+    try:
+        client.reset_stats()
+        a = th.rand(1024, 1024)
+        ret_put = client.put_tensor("prefault_a", a)
+        assert ret_put.data_ptr() % (2 << 20) == 0
+        ret_get = client.get_tensor("prefault_a")
+        assert ret_get.data_ptr() == ret_put.data_ptr()
+        assert th.equal(ret_get, a)
+        out = client.create_tensor("prefault_b", (1024, 1024), th.float32,
+                                   seal=False)
+        assert out.data_ptr() % (2 << 20) == 0
+        out.fill_(2)
+        client.seal("prefault_b")
+        assert th.equal(client.get_tensor("prefault_b"), th.full((1024, 1024), 2.0))
+        stats = client.stats()
+        if stats["enabled"]:
+            assert stats["phases"]["prefault"]["count"] >= 2
+            assert stats["phases"]["prefault"]["page_faults"] >= 0
+        del ret_put, ret_get, out
+    finally:
+        client.set_copy_options(**saved)
+
+
+def test_compressed_client():
+    client = vovp.init_client("/tmp/dgl_socket")
+    a = th.zeros(1000, 64)
+    a[::7] = th.rand(143, 64)
+    client.put_compressed("compressed_a", a, block_size=4096)
+    info = client.compression_info("compressed_a")
+    assert info["codec"] == "lz4"
+    assert info["raw_size"] == a.numel() * 4
+    assert info["compressed_size"] < info["raw_size"]
+    assert th.equal(client.get_tensor("compressed_a"), a)
+    assert th.equal(client.get_tensor_rows("compressed_a", 123, 456), a[123:456])
+    assert client.get_tensor_rows("compressed_a", 5, 5).shape == (0, 64)
+    b = th.rand(64, 3).t()
+    client.put_compressed("compressed_b", b, codec="zstd")
+    assert th.equal(client.get_tensor("compressed_b"), b)
+    plain = client.put_tensor("compressed_c", th.arange(10))
+    assert client.compression_info("compressed_c") is None
+    assert th.equal(client.get_tensor_rows("compressed_c", 2, 4), th.arange(2, 4))
+    del plain
+
+
+def test_dedup_client():
+    client = vovp.init_client("/tmp/dgl_socket")
+    a = th.rand(512, 300)
+    ret_a = client.put_tensor("dedup_a", a, dedup=True)
+    ret_b = client.put_tensor("dedup_b", a.clone(), dedup=True)
+    # Both names share one copy of the data
+    assert ret_a.data_ptr() == ret_b.data_ptr()
+    get_b = client.get_tensor("dedup_b", delete_on_free=False)
+    assert get_b.data_ptr() == ret_a.data_ptr()
+    assert th.equal(get_b, a)
+    # Same bytes with another shape are a different tensor
+    ret_c = client.put_tensor("dedup_c", a.view(300, 512), dedup=True)
+    assert ret_c.data_ptr() != ret_a.data_ptr()
+    assert client.get_tensor("dedup_c").shape == (300, 512)
+    ret_d = client.put_tensor("dedup_d", a + 1, dedup=True)
+    assert ret_d.data_ptr() != ret_a.data_ptr()
+    # Deleting an alias keeps the data of the other one
+    del ret_a, ret_b, get_b
+    client.delete("dedup_a")
+    client.flush()
+    assert th.equal(client.get_tensor("dedup_b", delete_on_free=False), a)
+    # Re-putting an alias with other contents leaves the data to the rest
+    ret_e = client.put_tensor("dedup_e", a, dedup=True)
+    client.put_tensor("dedup_b", a + 2, dedup=True)
+    client.flush()
+    assert th.equal(client.get_tensor("dedup_e", delete_on_free=False), a)
+    assert th.equal(client.get_tensor("dedup_b", delete_on_free=False), a + 2)
+    del ret_c, ret_d, ret_e
+    # Huge page aligned objects are shared too
+    saved = client.copy_options()
+    client.set_copy_options(huge_page_align_threshold=1 << 20)
+    try:
+        big = th.rand(1024, 1024)
+        ret_f = client.put_tensor("dedup_f", big, dedup=True)
+        ret_g = client.put_tensor("dedup_g", big.clone(), dedup=True)
+        assert ret_f.data_ptr() == ret_g.data_ptr()
+        assert ret_f.data_ptr() % (2 << 20) == 0
+        assert th.equal(client.get_tensor("dedup_g", delete_on_free=False),
+                        big)
+        del ret_f, ret_g
+    finally:
+        client.set_copy_options(**saved)
+
+
+def test_sparse_client():
+    client = vovp.init_client("/tmp/dgl_socket")
+    dense = (th.rand(300, 200) < 0.05).float() * th.rand(300, 200)
+    csr = dense.to_sparse_csr()
+    indptr, indices, data = (csr.crow_indices(), csr.col_indices(),
+                             csr.values())
+    client.put_sparse("sparse_a", (300, 200), indptr=indptr, indices=indices,
+                      data=data)
+    got = client.get_sparse("sparse_a")
+    assert got["format"] == "csr" and got["shape"] == (300, 200)
+    assert got["nnz"] == data.numel()
+    # int64 indices are narrowed to int32
+    assert got["indptr"].dtype == th.int32 and got["indices"].dtype == th.int32
+    assert th.equal(got["indptr"].long(), indptr)
+    assert th.equal(got["indices"].long(), indices)
+    assert th.equal(got["data"], data)
+    client.put_sparse("sparse_b", (300, 200), indptr=indptr, indices=indices,
+                      delta=True)
+    got_b = client.get_sparse("sparse_b")
+    assert got_b["encodings"]["indices"] == "row_delta"
+    assert th.equal(got_b["indices"].long(), indices)
+    # CSC of A is the CSR of its transpose
+    for name in ("sparse_a", "sparse_b"):
+        client.transpose_sparse(name, "sparse_t")
+        t = client.get_sparse("sparse_t")
+        assert t["shape"] == (200, 300)
+        csc = dense.t().to_sparse_csr()
+        assert th.equal(t["indptr"].long(), csc.crow_indices())
+        assert th.equal(t["indices"].long(), csc.col_indices())
+        if name == "sparse_a":
+            assert th.equal(t["data"], csc.values())
+        else:
+            assert th.equal(data[t["data"].long()], csc.values())
+        del t
+    rows = th.tensor([5, 0, 299, 5])
+    for name in ("sparse_a", "sparse_b"):
+        sliced = client.slice_sparse_rows(name, rows)
+        expected = dense[rows].to_sparse_csr()
+        assert th.equal(sliced["indptr"], expected.crow_indices())
+        assert th.equal(sliced["indices"].long(), expected.col_indices())
+        if name == "sparse_a":
+            assert th.equal(sliced["data"], expected.values())
+    coo = dense.to_sparse().coalesce()
+    client.put_sparse("sparse_c", (300, 200), row=coo.indices()[0],
+                      col=coo.indices()[1])
+    got_c = client.get_sparse("sparse_c")
+    assert got_c["format"] == "coo" and "data" not in got_c
+    assert th.equal(got_c["row"].long(), coo.indices()[0])
+    assert th.equal(got_c["col"].long(), coo.indices()[1])
+    del got, got_b, got_c
+
+
+def test_numa_client():
+    # A second store stands in for the other node's
+    import shutil, subprocess, time
+    server = shutil.which("plasma-store-server")
+    if server is None:
+        print("SKIP test_numa_client: plasma-store-server is not on PATH")
+        return
+    store = subprocess.Popen([server, "-m", "100000000", "-s",
+                              "/tmp/dgl_socket_node1"])
+    try:
+        time.sleep(0.5)
+        client = vovp.init_client(["/tmp/dgl_socket", "/tmp/dgl_socket_node1"],
+                                  nodes=[0, 1])
+        assert client.num_stores() == 2
+        a = th.rand(256, 256)
+        ret_a = client.put_tensor("numa_a", a, node=1)
+        assert client.object_nodes("numa_a") == [1]
+        assert th.equal(client.get_tensor("numa_a", delete_on_free=False), a)
+        # Another process finds it by asking the stores
+        other = vovp.client.VovpClient(
+            ["/tmp/dgl_socket", "/tmp/dgl_socket_node1"], nodes=[0, 1])
+        assert th.equal(other.get_tensor("numa_a", delete_on_free=False), a)
+        assert other.object_nodes("numa_a") == [1]
+        # A put on another node replaces the old copy
+        ret_b = client.put_tensor("numa_a", a + 1, node=0)
+        assert client.object_nodes("numa_a") == [0]
+        assert th.equal(client.get_tensor("numa_a", delete_on_free=False),
+                        a + 1)
+        # A copy deleted behind the directory's back is looked up again
+        client.put_tensor("numa_f", a, node=1)
+        client.get_tensor("numa_f")
+        client.flush()
+        other.put_tensor("numa_f", a * 3, node=0)
+        assert th.equal(client.get_tensor("numa_f", delete_on_free=False),
+                        a * 3)
+        assert client.object_nodes("numa_f") == [0]
+        ret_c = client.put_tensor("numa_c", a, replicate=True)
+        assert sorted(client.object_nodes("numa_c")) == [0, 1]
+        assert th.equal(client.get_tensor("numa_c"), a)
+        client.set_placement("interleave")
+        rets = client.put_tensors(["numa_d", "numa_e"], [a, a * 2])
+        assert th.equal(client.get_tensors(["numa_d", "numa_e"])[1], a * 2)
+        del ret_a, ret_b, ret_c, rets, other, client
+    finally:
+        vovp.init_client("/tmp/dgl_socket")
+        store.terminate()
+        store.wait()
+
+
 test_basic_client()
+test_batch_client()
+test_strided_client()
+test_cache_client()
+test_unsealed_client()
+test_release_client()
+test_async_client()
+test_gather_client()
+test_pickle_client()
+test_stats_client()
+test_threads_client()
+test_spill_client()
+test_snapshot_client()
+test_update_client()
+test_channel_client()
+test_bundle_client()
+test_wait_client()
+test_prefault_client()
+test_compressed_client()
+test_dedup_client()
+test_sparse_client()
+test_numa_client()